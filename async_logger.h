@@ -0,0 +1,275 @@
+#pragma once
+
+// === Asynchronous binary logger ===
+// Writing to std::cout on a request path takes the iostream lock and blocks
+// on the terminal. Instead, each thread appends fixed-size binary records
+// (a pre-registered format ID plus raw arguments) to its own ring buffer, and
+// a background thread formats them and writes whole batches with one write().
+//
+// Formats are an enum ending in `Count` plus a table of printf formats indexed
+// by it. Every format receives (text length, text, number) in that order, so a
+// format may use "%.*s" and/or "%lu". Text longer than TEXT_CAPACITY is cut and
+// printed with a "..." marker, so a shortened line is never mistaken for a
+// whole one.
+//
+// Usage:
+//
+//     enum class Format : uint16_t { Hello, Count };
+//     constexpr const char *FORMATS[]{"Client: %.*s\n"};
+//     async_log::Logger<Format> logger{FORMATS, {}};
+//     logger.log(Format::Hello, "hello admin");
+//
+// The lock around the (rarely touched) ring registry is a template parameter,
+// so a profiling mutex that takes a name can be dropped in.
+
+#include <string>             // For std::string (batches)
+#include <string_view>        // For std::string_view (log text)
+#include <cstdint>            // For uint16_t, uint32_t, uint64_t, int64_t
+#include <cstdio>             // For std::snprintf()
+#include <algorithm>          // For std::min, std::copy_n
+#include <atomic>             // For the ring indices
+#include <chrono>             // For the flush interval
+#include <memory>             // For std::shared_ptr (rings outlive their threads)
+#include <mutex>              // For std::mutex, std::lock_guard (ring registry)
+#include <thread>             // For the writer thread
+#include <vector>             // For the ring registry
+#include <time.h>             // For clock_gettime(CLOCK_MONOTONIC_COARSE)
+#include <unistd.h>           // For write(), STDOUT_FILENO
+
+namespace async_log
+{
+    // Records per thread ring (power of two) and text bytes kept per record
+    constexpr size_t RING_CAPACITY{4096};
+    constexpr size_t TEXT_CAPACITY{48};
+    constexpr const char TRUNCATION_MARKER[]{"..."};
+
+    // Record flags
+    constexpr uint16_t RECORD_TRUNCATED{1}; // The text was longer than TEXT_CAPACITY
+
+    // One cache line per record: the writer thread copies the text argument verbatim
+    struct Record
+    {
+        uint16_t format{0};
+        uint16_t text_len{0};
+        uint16_t flags{0};
+        uint16_t reserved{0};
+        uint64_t number{0};
+        char text[TEXT_CAPACITY]{};
+    };
+    static_assert(sizeof(Record) == 64);
+
+    // Single-producer (owning thread) / single-consumer (writer thread) ring
+    struct Ring
+    {
+        alignas(64) std::atomic<size_t> head{0}; // Next slot the producer writes
+        alignas(64) std::atomic<size_t> tail{0}; // Next slot the consumer reads
+        std::atomic<uint64_t> dropped{0};        // Records lost to a full ring or the limiter
+        Record records[RING_CAPACITY]{};
+    };
+
+    // Where batches go and how much each thread may log
+    struct Options
+    {
+        int fd{STDOUT_FILENO};
+        uint32_t rate_limit_per_sec{10000}; // Per format, per thread
+        uint32_t sample_every{1};           // Keep 1 in N records of each format
+        std::chrono::milliseconds flush_interval{10};
+    };
+
+    // Default registry lock: a std::mutex that accepts (and ignores) a name
+    struct NamedMutex : std::mutex
+    {
+        explicit NamedMutex(const char *)
+        {
+        }
+    };
+
+    template <typename Format, typename Mutex = NamedMutex, typename Lock = std::lock_guard<Mutex>>
+    class Logger
+    {
+    public:
+        static constexpr size_t FORMAT_COUNT{static_cast<size_t>(Format::Count)};
+
+        Logger(const char *const (&formats)[FORMAT_COUNT], const Options &options)
+            : formats_{formats}, options_{options}, writer_{[this]
+                                                            { run(); }}
+        {
+        }
+
+        ~Logger()
+        {
+            stop_.store(true, std::memory_order_release);
+            writer_.join();
+        }
+
+        Logger(const Logger &) = delete;
+        Logger &operator=(const Logger &) = delete;
+
+        // Hot path: no locks, no formatting, no syscalls
+        void log(Format format, std::string_view text = {}, uint64_t number = 0)
+        {
+            ThreadState &state{thread_state()};
+            auto id{static_cast<size_t>(format)};
+
+            // Sampling: keep only every Nth occurrence of this format
+            if (options_.sample_every > 1 && state.seen[id]++ % options_.sample_every != 0)
+            {
+                return;
+            }
+
+            // Rate limiting: token bucket refilled once per second. The coarse clock
+            // (a few ms resolution) is plenty for that and costs a fraction of
+            // steady_clock::now(), which alone would eat most of the per-event budget
+            timespec coarse{};
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &coarse);
+            int64_t now{static_cast<int64_t>(coarse.tv_sec) * 1'000'000'000 + coarse.tv_nsec};
+            if (now - state.window_start[id] >= 1'000'000'000)
+            {
+                state.window_start[id] = now;
+                state.tokens[id] = options_.rate_limit_per_sec;
+            }
+            if (state.tokens[id] == 0)
+            {
+                state.ring->dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            --state.tokens[id];
+
+            Ring &ring{*state.ring};
+            size_t head{ring.head.load(std::memory_order_relaxed)};
+            if (head - ring.tail.load(std::memory_order_acquire) == RING_CAPACITY)
+            {
+                ring.dropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+
+            Record &record{ring.records[head & (RING_CAPACITY - 1)]};
+            record.format = static_cast<uint16_t>(format);
+            record.text_len = static_cast<uint16_t>(std::min(text.length(), TEXT_CAPACITY));
+            record.flags = text.length() > TEXT_CAPACITY ? RECORD_TRUNCATED : 0;
+            record.number = number;
+            std::copy_n(text.data(), record.text_len, record.text);
+            ring.head.store(head + 1, std::memory_order_release);
+        }
+
+        // Creates the calling thread's ring ahead of its first log call
+        void register_thread()
+        {
+            thread_state();
+        }
+
+        // Records logged but not yet formatted, across all threads
+        size_t pending()
+        {
+            size_t pending{0};
+            Lock lock{rings_mutex_};
+            for (const auto &ring : rings_)
+            {
+                pending += ring->head.load(std::memory_order_acquire) - ring->tail.load(std::memory_order_acquire);
+            }
+            return pending;
+        }
+
+    private:
+        struct ThreadState
+        {
+            uint64_t logger{0}; // instance_ of the logger the ring is registered with
+            std::shared_ptr<Ring> ring{};
+            uint64_t seen[FORMAT_COUNT]{};
+            uint32_t tokens[FORMAT_COUNT]{};
+            int64_t window_start[FORMAT_COUNT]{}; // CLOCK_MONOTONIC_COARSE, ns
+        };
+
+        // Registers the calling thread's ring on first use (the only locked step).
+        // The state is per thread and per logger type, so a thread that meets a
+        // new logger of the same type (a benchmark's second run) starts over.
+        ThreadState &thread_state()
+        {
+            thread_local ThreadState state{};
+            if (state.logger != instance_)
+            {
+                state = ThreadState{};
+                state.logger = instance_;
+                state.ring = std::make_shared<Ring>();
+                Lock lock{rings_mutex_};
+                rings_.push_back(state.ring);
+            }
+            return state;
+        }
+
+        // Writer thread: format everything pending and write it in one batch
+        void run()
+        {
+            std::string batch{};
+            bool stopping{false};
+            while (!stopping)
+            {
+                stopping = stop_.load(std::memory_order_acquire);
+                if (!stopping)
+                {
+                    std::this_thread::sleep_for(options_.flush_interval);
+                }
+
+                std::vector<std::shared_ptr<Ring>> rings{};
+                {
+                    Lock lock{rings_mutex_};
+                    rings = rings_;
+                }
+
+                batch.clear();
+                for (const auto &ring : rings)
+                {
+                    drain(*ring, batch);
+                }
+                if (!batch.empty())
+                {
+                    // Best effort: a short or failed write only loses log lines
+                    [[maybe_unused]] ssize_t written{write(options_.fd, batch.data(), batch.length())};
+                }
+            }
+        }
+
+        void drain(Ring &ring, std::string &batch)
+        {
+            size_t tail{ring.tail.load(std::memory_order_relaxed)};
+            size_t head{ring.head.load(std::memory_order_acquire)};
+            char line[256]{};
+            char marked[TEXT_CAPACITY + sizeof(TRUNCATION_MARKER)]{};
+            for (; tail != head; ++tail)
+            {
+                const Record &record{ring.records[tail & (RING_CAPACITY - 1)]};
+                const char *text{record.text};
+                size_t text_len{record.text_len};
+                if (record.flags & RECORD_TRUNCATED)
+                {
+                    std::copy_n(record.text, text_len, marked);
+                    std::copy_n(TRUNCATION_MARKER, sizeof(TRUNCATION_MARKER) - 1, marked + text_len);
+                    text = marked;
+                    text_len += sizeof(TRUNCATION_MARKER) - 1;
+                }
+                int len{std::snprintf(line, sizeof(line), formats_[record.format], static_cast<int>(text_len), text,
+                                      static_cast<unsigned long>(record.number))};
+                if (len > 0)
+                {
+                    batch.append(line, std::min(static_cast<size_t>(len), sizeof(line) - 1));
+                }
+            }
+            ring.tail.store(tail, std::memory_order_release);
+
+            if (uint64_t dropped{ring.dropped.exchange(0, std::memory_order_relaxed)}; dropped > 0)
+            {
+                batch += "[log] " + std::to_string(dropped) + " records dropped or rate limited\n";
+            }
+        }
+
+        static inline std::atomic<uint64_t> next_instance_{1};
+
+        const uint64_t instance_{next_instance_.fetch_add(1, std::memory_order_relaxed)};
+        const char *const *formats_;
+        const Options options_;
+        Mutex rings_mutex_{"log.rings"};
+        std::vector<std::shared_ptr<Ring>> rings_{};
+        std::atomic<bool> stop_{false};
+        std::thread writer_; // Declared last so it starts after the other members exist
+    };
+}
@@ -0,0 +1,141 @@
+#include <iostream>     // For std::cout, std::cerr
+#include <fstream>      // For std::ifstream
+#include <string>       // For std::string
+#include <iomanip>      // For std::setw, std::setfill
+#include <array>        // For std::array (CRC table)
+#include <cstdint>      // For fixed-width integer types
+#include <ctime>        // For gmtime_r(), strftime()
+#include <arpa/inet.h>  // For inet_ntop()
+
+// Replays the binary audit log written by server2 (auth_audit.log and its
+// rotated siblings auth_audit.log.<unix seconds>.<first sequence>).
+//
+// Usage: ./audit_reader auth_audit.log [more files...]
+
+constexpr uint32_t AUDIT_RECORD_MAGIC{0x41554431}; // "AUD1"
+
+// Must match AuditRecord in server2.cpp
+struct AuditRecord
+{
+    uint32_t magic{0};
+    uint32_t crc32{0};
+    uint64_t sequence{0};
+    uint64_t timestamp_ns{0};
+    uint8_t verdict{0};
+    uint8_t username_len{0};
+    uint16_t reserved{0};
+    uint32_t peer_ipv4{0};
+    char username[32]{};
+};
+static_assert(sizeof(AuditRecord) == 64);
+
+// === FUNCTION: CRC-32 (IEEE 802.3), same polynomial as the server ===
+uint32_t crc32(const unsigned char *data, size_t length)
+{
+    static const auto table{[]
+                            {
+                                std::array<uint32_t, 256> t{};
+                                for (uint32_t i{0}; i < 256; ++i)
+                                {
+                                    uint32_t c{i};
+                                    for (int k{0}; k < 8; ++k)
+                                    {
+                                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                                    }
+                                    t[i] = c;
+                                }
+                                return t;
+                            }()};
+
+    uint32_t crc{0xFFFFFFFFu};
+    for (size_t i{0}; i < length; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// === FUNCTION: Turn a verdict code into text ===
+std::string verdict_name(uint8_t verdict)
+{
+    switch (verdict)
+    {
+    case 1:
+        return "SUCCESS";
+    case 2:
+        return "FAILURE";
+    default:
+        return "UNKNOWN(" + std::to_string(verdict) + ")";
+    }
+}
+
+// === FUNCTION: Print one record as a single line ===
+void print_record(const AuditRecord &record)
+{
+    // Timestamp as UTC with microseconds
+    time_t seconds{static_cast<time_t>(record.timestamp_ns / 1000000000)};
+    tm utc{};
+    gmtime_r(&seconds, &utc);
+    char when[32]{};
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", &utc);
+
+    char peer[INET_ADDRSTRLEN]{};
+    inet_ntop(AF_INET, &record.peer_ipv4, peer, sizeof(peer));
+
+    size_t name_len{std::min<size_t>(record.username_len, sizeof(record.username))};
+    std::cout << record.sequence << "\t"
+              << when << "." << std::setw(6) << std::setfill('0') << (record.timestamp_ns % 1000000000) / 1000 << "Z\t"
+              << verdict_name(record.verdict) << "\t"
+              << std::string(record.username, name_len) << "\t"
+              << peer << "\n";
+}
+
+// === FUNCTION: Replay one log file ===
+// Returns false if a corrupt record was found. A short record at the end of
+// the file is a write torn by a crash and is reported but not an error.
+bool replay(const std::string &path)
+{
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+    {
+        std::cerr << path << ": cannot open\n";
+        return false;
+    }
+
+    AuditRecord record{};
+    size_t index{0};
+    while (in.read(reinterpret_cast<char *>(&record), sizeof(record)))
+    {
+        uint32_t expected{crc32(reinterpret_cast<const unsigned char *>(&record) + 8, sizeof(record) - 8)};
+        if (record.magic != AUDIT_RECORD_MAGIC || record.crc32 != expected)
+        {
+            std::cerr << path << ": corrupt record at offset " << index * sizeof(record) << "\n";
+            return false;
+        }
+        print_record(record);
+        index++;
+    }
+
+    if (in.gcount() > 0)
+    {
+        std::cerr << path << ": ignoring torn record of " << in.gcount() << " bytes at end of file\n";
+    }
+    return true;
+}
+
+// === Main Entry Point ===
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <audit log> [more logs...]\n";
+        return 1;
+    }
+
+    bool ok{true};
+    for (int i{1}; i < argc; ++i)
+    {
+        ok = replay(argv[i]) && ok;
+    }
+    return ok ? 0 : 1;
+}
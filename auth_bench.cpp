@@ -0,0 +1,637 @@
+#include <iostream>     // For std::cout, std::cerr
+#include <iomanip>      // For std::setw, std::fixed, std::setprecision
+#include <string>       // For std::string
+#include <vector>       // For std::vector
+#include <chrono>       // For std::chrono::steady_clock
+#include <memory>       // For std::unique_ptr (OpenSSL object ownership)
+#include <stdexcept>    // For std::runtime_error
+#include <functional>   // For std::function (benchmark bodies)
+#include <unordered_map> // For the per-user credential tables
+#include <memory_resource> // For std::pmr::unordered_map (arena-backed tables)
+#include <random>       // For std::mt19937 (lookup order)
+#include <fstream>      // For the std::ostream logging baseline
+#include <thread>       // For std::this_thread::sleep_for()
+#include <cstdint>      // For UINT32_MAX
+#include <fcntl.h>      // For open()
+#include <unistd.h>     // For write(), close(), fork(), execl(), pipe()
+#include <algorithm>    // For std::sort (latency percentiles)
+#include <climits>      // For PATH_MAX
+#include <csignal>      // For kill()
+#include <cstdlib>      // For mkdtemp(), realpath()
+#include <sys/wait.h>   // For waitpid()
+#include <sys/socket.h> // For socket(), connect()
+#include <netinet/in.h> // For sockaddr_in
+#include <arpa/inet.h>  // For inet_pton()
+#include <openssl/evp.h> // For EVP_MD_CTX (digest baselines), EVP_MAC, Ed25519 signing
+#include <openssl/core_names.h> // For OSSL_PARAM names
+#include <openssl/rand.h> // For RAND_bytes() – challenges
+#include <openssl/crypto.h> // For OpenSSL_version()
+#include "ed25519_batch.h"
+#include "hmac_midstate.h"  // server2's HMAC key schedules
+#include "async_logger.h"   // server2's logger
+#include "huge_page_arena.h" // server2's credential table arena
+#include "auth_token.h"     // server.cpp's bearer tokens
+
+// Micro-benchmarks for the verification paths in server2.cpp. Each prints the
+// mean cost per operation.
+//
+// Build: g++ -std=c++17 -O2 auth_bench.cpp -o auth_bench -lcrypto
+// Usage: ./auth_bench [hmac|openssl|logger|ed25519|token]
+//        ./auth_bench arena [users]         (builds three tables of that many users, default 10M)
+//        ./auth_bench startup [./server2]   (launches its own server2)
+
+using EvpMdPtr = std::unique_ptr<EVP_MD, decltype(&EVP_MD_free)>;
+using EvpMdCtxPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+using EvpPkeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+using EvpMacPtr = std::unique_ptr<EVP_MAC, decltype(&EVP_MAC_free)>;
+using EvpMacCtxPtr = std::unique_ptr<EVP_MAC_CTX, decltype(&EVP_MAC_CTX_free)>;
+
+constexpr size_t CHALLENGE_SIZE{16};
+constexpr size_t TABLE_USERS{200'000}; // Users in the credential-table benchmarks
+constexpr size_t ARENA_TABLE_USERS{10'000'000}; // Users in the huge-page arena benchmark (~1.3 GB per table)
+
+// Keeps results alive so the compiler can't drop the work
+volatile size_t sink{0};
+
+// === Function: Time `body` over `iterations` runs of `per_run` operations ===
+void report(const std::string &name, size_t iterations, size_t per_run, const std::function<void()> &body)
+{
+    body(); // Warm caches and lazy initialisation
+    auto start{std::chrono::steady_clock::now()};
+    for (size_t i{0}; i < iterations; ++i)
+    {
+        body();
+    }
+    auto elapsed{std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()};
+    std::cout << std::left << std::setw(44) << name << std::right << std::fixed << std::setprecision(0)
+              << std::setw(10) << elapsed / static_cast<double>(iterations * per_run) << " ns/op\n";
+}
+
+std::string random_bytes(size_t length)
+{
+    std::string bytes(length, '\0');
+    if (!RAND_bytes(reinterpret_cast<unsigned char *>(bytes.data()), static_cast<int>(length)))
+    {
+        throw std::runtime_error("RAND_bytes failed");
+    }
+    return bytes;
+}
+
+using hmac_midstate::compute_hmac;
+
+// === Function: HMAC from the raw secret vs. from precomputed midstates ===
+void bench_hmac()
+{
+    std::cout << "-- HMAC-SHA1: key schedule per call vs precomputed midstates --\n";
+    std::string challenge{random_bytes(CHALLENGE_SIZE)};
+    const std::string secret{"pass123"};
+
+    // The raw secret is keyed into a reused context on every call: the two
+    // padded key blocks are hashed each time
+    EvpMacPtr mac{EVP_MAC_fetch(nullptr, "HMAC", nullptr), &EVP_MAC_free};
+    EvpMacCtxPtr mac_ctx{mac ? EVP_MAC_CTX_new(mac.get()) : nullptr, &EVP_MAC_CTX_free};
+    if (!mac_ctx)
+    {
+        throw std::runtime_error("EVP_MAC setup failed");
+    }
+    char digest_name[]{"SHA1"};
+    OSSL_PARAM params[]{OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest_name, 0), OSSL_PARAM_construct_end()};
+    auto keyed_hmac{[&](const std::string &key)
+                    {
+                        unsigned char out[EVP_MAX_MD_SIZE];
+                        size_t len{0};
+                        if (!EVP_MAC_init(mac_ctx.get(), reinterpret_cast<const unsigned char *>(key.data()), key.length(), params) ||
+                            !EVP_MAC_update(mac_ctx.get(), reinterpret_cast<const unsigned char *>(challenge.data()), challenge.length()) ||
+                            !EVP_MAC_final(mac_ctx.get(), out, &len, sizeof(out)))
+                        {
+                            throw std::runtime_error("HMAC failed");
+                        }
+                        return std::string(reinterpret_cast<char *>(out), len);
+                    }};
+    hmac_midstate::KeyState state{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, secret)};
+    if (keyed_hmac(secret) != compute_hmac(challenge, state))
+    {
+        throw std::runtime_error("Midstate HMAC disagrees with EVP_MAC");
+    }
+    report("HMAC-SHA1, keyed from the secret", 200'000, 1, [&]
+           { sink = sink + keyed_hmac(secret).size(); });
+    report("HMAC-SHA1, precomputed midstates", 200'000, 1, [&]
+           { sink = sink + compute_hmac(challenge, state).size(); });
+
+    // The same, behind a username lookup in a table of TABLE_USERS accounts
+    std::unordered_map<std::string, std::string> secrets{};
+    std::unordered_map<std::string, hmac_midstate::KeyState> states{};
+    std::vector<std::string> usernames{};
+    for (size_t i{0}; i < TABLE_USERS; ++i)
+    {
+        usernames.push_back("user" + std::to_string(i));
+        std::string user_secret{random_bytes(16)};
+        states.emplace(usernames.back(), hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, user_secret));
+        secrets.emplace(usernames.back(), std::move(user_secret));
+    }
+    std::mt19937 order{42};
+    std::uniform_int_distribution<size_t> pick{0, TABLE_USERS - 1};
+    report("lookup + HMAC, " + std::to_string(TABLE_USERS) + " secrets", 200'000, 1, [&]
+           { sink = sink + keyed_hmac(secrets.find(usernames[pick(order)])->second).size(); });
+    report("lookup + HMAC, " + std::to_string(TABLE_USERS) + " midstates", 200'000, 1, [&]
+           { sink = sink + compute_hmac(challenge, states.find(usernames[pick(order)])->second).size(); });
+}
+
+// === Function: Random lookups (+ HMAC) in one large credential table ===
+template <typename Table>
+void bench_table_lookups(const std::string &name, Table &table, size_t users, const std::string &challenge)
+{
+    hmac_midstate::KeyState state{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, "pass123")};
+    table.reserve(users);
+    for (size_t i{0}; i < users; ++i)
+    {
+        // Distinct records without a key schedule per user; the MAC values don't matter here
+        state.inner[0] = static_cast<uint32_t>(i);
+        table.emplace("user" + std::to_string(i), state);
+    }
+
+    // Usernames are built per lookup ("userNNNNNNN" fits std::string's inline
+    // buffer), so no second 10M-entry array competes for the TLB
+    std::mt19937 order{42};
+    std::uniform_int_distribution<size_t> pick{0, users - 1};
+    report("lookup, " + name, 2'000'000, 1, [&]
+           { sink = sink + table.find("user" + std::to_string(pick(order)))->second.inner[1]; });
+    report("lookup + HMAC, " + name, 2'000'000, 1, [&]
+           { sink = sink + compute_hmac(challenge, table.find("user" + std::to_string(pick(order)))->second).size(); });
+}
+
+// === Function: Credential table on huge pages vs. regular pages ===
+// Each table holds what server2 keeps per HMAC user (name and midstates,
+// inline in the node). Tables are built one at a time so only one is resident.
+void bench_arena(size_t users)
+{
+    std::cout << "-- credential table of " << users << " users: huge-page arena vs regular pages --\n";
+    std::string challenge{random_bytes(CHALLENGE_SIZE)};
+    {
+        std::unordered_map<std::string, hmac_midstate::KeyState> table{};
+        bench_table_lookups("malloc heap", table, users, challenge);
+    }
+    for (auto backing : {huge_page_arena::Backing::RegularPages, huge_page_arena::Backing::ExplicitHugePages})
+    {
+        huge_page_arena::Arena arena{backing};
+        std::pmr::unordered_map<std::string, hmac_midstate::KeyState> table{&arena};
+        bench_table_lookups(backing == huge_page_arena::Backing::RegularPages ? "arena, regular pages" : "arena, huge pages",
+                            table, users, challenge);
+        std::cout << "   arena: " << huge_page_arena::BACKING_NAMES[static_cast<size_t>(arena.backing())] << ", "
+                  << arena.used_bytes() / (1024 * 1024) << " MiB used, " << arena.huge_page_coverage_percent()
+                  << "% huge page coverage\n";
+    }
+}
+
+// === Function: Per-call algorithm fetch and context setup vs. fetched once and reused ===
+void bench_openssl()
+{
+    std::cout << "-- " << OpenSSL_version(OPENSSL_VERSION) << ": fetch and context reuse --\n";
+    std::string challenge{random_bytes(CHALLENGE_SIZE)};
+    const std::string secret{"pass123"};
+    auto data{reinterpret_cast<const unsigned char *>(challenge.data())};
+    auto key{reinterpret_cast<const unsigned char *>(secret.data())};
+    unsigned char out[EVP_MAX_MD_SIZE];
+    size_t out_len{0};
+    char digest_name[]{"SHA1"};
+    OSSL_PARAM params[]{OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest_name, 0), OSSL_PARAM_construct_end()};
+
+    // Client side: what the legacy HMAC() call does under OpenSSL 3 (fetch,
+    // new context, key, MAC, free) vs. client2's fetched EVP_MAC with a keyed
+    // per-thread template duplicated per message
+    report("HMAC, fetch + new context per call", 100'000, 1, [&]
+           {
+               if (!EVP_Q_mac(nullptr, "HMAC", nullptr, "SHA1", nullptr, key, secret.length(), data, challenge.length(),
+                              out, sizeof(out), &out_len))
+               {
+                   throw std::runtime_error("EVP_Q_mac failed");
+               }
+               sink = sink + out_len; });
+    EvpMacPtr mac{EVP_MAC_fetch(nullptr, "HMAC", nullptr), &EVP_MAC_free};
+    EvpMacCtxPtr keyed{mac ? EVP_MAC_CTX_new(mac.get()) : nullptr, &EVP_MAC_CTX_free};
+    if (!keyed || !EVP_MAC_init(keyed.get(), key, secret.length(), params))
+    {
+        throw std::runtime_error("EVP_MAC setup failed");
+    }
+    report("HMAC, fetched once, new context per call", 100'000, 1, [&]
+           {
+               EvpMacCtxPtr ctx{EVP_MAC_CTX_new(mac.get()), &EVP_MAC_CTX_free};
+               if (!ctx || !EVP_MAC_init(ctx.get(), key, secret.length(), params) ||
+                   !EVP_MAC_update(ctx.get(), data, challenge.length()) || !EVP_MAC_final(ctx.get(), out, &out_len, sizeof(out)))
+               {
+                   throw std::runtime_error("EVP_MAC failed");
+               }
+               sink = sink + out_len; });
+    report("HMAC, fetched once, keyed context dup'd", 100'000, 1, [&]
+           {
+               EvpMacCtxPtr ctx{EVP_MAC_CTX_dup(keyed.get()), &EVP_MAC_CTX_free};
+               if (!ctx || !EVP_MAC_update(ctx.get(), data, challenge.length()) ||
+                   !EVP_MAC_final(ctx.get(), out, &out_len, sizeof(out)))
+               {
+                   throw std::runtime_error("EVP_MAC failed");
+               }
+               sink = sink + out_len; });
+
+    // Server side: digest contexts initialised through the implicit-fetch
+    // EVP_sha1() vs. an explicitly fetched EVP_MD, in a new vs. reused context
+    EvpMdPtr md{EVP_MD_fetch(nullptr, "SHA1", nullptr), &EVP_MD_free};
+    EvpMdCtxPtr reused{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+    if (!md || !reused)
+    {
+        throw std::runtime_error("EVP_MD setup failed");
+    }
+    auto digest{[&](EVP_MD_CTX *ctx, const EVP_MD *type)
+                {
+                    unsigned int len{0};
+                    if (!EVP_DigestInit_ex(ctx, type, nullptr) || !EVP_DigestUpdate(ctx, data, challenge.length()) ||
+                        !EVP_DigestFinal_ex(ctx, out, &len))
+                    {
+                        throw std::runtime_error("Digest failed");
+                    }
+                    sink = sink + len;
+                }};
+    report("SHA1, EVP_sha1(), new context per call", 200'000, 1, [&]
+           {
+               EvpMdCtxPtr ctx{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+               digest(ctx.get(), EVP_sha1()); });
+    report("SHA1, fetched once, new context per call", 200'000, 1, [&]
+           {
+               EvpMdCtxPtr ctx{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+               digest(ctx.get(), md.get()); });
+    report("SHA1, fetched once, reused context", 200'000, 1, [&]
+           { digest(reused.get(), md.get()); });
+
+    hmac_midstate::KeyState state{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, secret)};
+    report("HMAC, server2 midstates (hmac_midstate.h)", 200'000, 1, [&]
+           { sink = sink + compute_hmac(challenge, state).size(); });
+}
+
+// The async logger from server2 (async_logger.h) with one client-hello format
+enum class BenchLogFormat : uint16_t
+{
+    ClientHello,
+    Count
+};
+constexpr const char *BENCH_LOG_FORMATS[]{"Client: %.*s\n"};
+using BenchLogger = async_log::Logger<BenchLogFormat>;
+
+// === Function: Async logger hot path vs. std::cout-style logging ===
+void bench_logger()
+{
+    std::cout << "-- logging one client hello per handshake (target < 50 ns/event) --\n";
+    const std::string hello{"hello admin deadline=250"};
+    int null_fd{open("/dev/null", O_WRONLY)};
+    if (null_fd < 0)
+    {
+        throw std::runtime_error("Cannot open /dev/null");
+    }
+
+    // What handle_client() did before: a locked, flushed iostream write per hello
+    std::ofstream stream{"/dev/null"};
+    report("std::ostream << hello << std::endl", 200'000, 1, [&]
+           { stream << "Client: " << hello << std::endl; });
+
+    // Records that are kept: log a ring's worth, then let the writer drain it
+    // (untimed), as a burst of handshakes between two flushes would
+    {
+        BenchLogger logger{BENCH_LOG_FORMATS, {null_fd, UINT32_MAX, 1, std::chrono::milliseconds(10)}};
+        constexpr size_t BURST{async_log::RING_CAPACITY - 64};
+        constexpr size_t BURSTS{100};
+        double elapsed{0};
+        for (size_t burst{0}; burst <= BURSTS; ++burst)
+        {
+            while (logger.pending() > 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            auto start{std::chrono::steady_clock::now()};
+            for (size_t i{0}; i < BURST; ++i)
+            {
+                logger.log(BenchLogFormat::ClientHello, hello, i);
+            }
+            auto burst_ns{std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()};
+            elapsed += burst == 0 ? 0 : burst_ns; // First burst warms the ring
+        }
+        std::cout << std::left << std::setw(44) << "async logger, record kept" << std::right << std::fixed
+                  << std::setprecision(0) << std::setw(10) << elapsed / static_cast<double>(BURST * BURSTS) << " ns/op\n";
+    }
+
+    // Sustained 500k+/s from one thread: past the per-second limit records are
+    // counted as dropped instead of queued
+    {
+        BenchLogger logger{BENCH_LOG_FORMATS, {null_fd, 10'000, 1, std::chrono::milliseconds(10)}};
+        report("async logger, over the rate limit", 2'000'000, 1, [&]
+               { logger.log(BenchLogFormat::ClientHello, hello); });
+    }
+    close(null_fd);
+}
+
+// === Function: Bearer token verification (auth_token.h) ===
+void bench_token()
+{
+    std::cout << "-- bearer token verification (target: a few hundred ns) --\n";
+    char directory[]{"/tmp/auth_bench.XXXXXX"};
+    if (!mkdtemp(directory))
+    {
+        throw std::runtime_error("Cannot create a working directory");
+    }
+    std::string key_file{std::string(directory) + "/token_keys"};
+    auth_token::ensure_key_file(key_file);
+    auth_token::TokenIssuer issuer{key_file};
+    auth_token::TokenVerifier verifier{key_file};
+    unlink(key_file.c_str());
+    rmdir(directory);
+
+    std::string token{issuer.issue("admin", "read write", 3600)};
+    std::string forged{token};
+    forged[forged.length() - 2] = forged[forged.length() - 2] == 'A' ? 'B' : 'A';
+    if (!verifier.verify(token) || verifier.verify(forged))
+    {
+        throw std::runtime_error("Token verification is broken");
+    }
+    report("verify, valid token (" + std::to_string(token.length()) + " bytes)", 1'000'000, 1, [&]
+           { sink = sink + verifier.verify(token)->subject().length(); });
+    report("verify, forged MAC", 1'000'000, 1, [&]
+           { sink = sink + verifier.verify(forged).has_value(); });
+}
+
+// === Function: HMAC-SHA1 verification vs. Ed25519, one at a time and batched ===
+void bench_ed25519()
+{
+    std::cout << "-- verification: HMAC-SHA1 vs Ed25519 (per signature) --\n";
+    std::string challenge{random_bytes(CHALLENGE_SIZE)};
+
+    hmac_midstate::KeyState hmac{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, "pass123")};
+    std::string expected{compute_hmac(challenge, hmac)};
+    report("HMAC-SHA1, precomputed midstates", 200'000, 1, [&]
+           { sink = sink + (compute_hmac(challenge, hmac) == expected); });
+
+    // One key per signer, as with concurrent handshakes from different users
+    constexpr size_t MAX_BATCH{64};
+    std::vector<ed25519_batch::PublicKey> keys{};
+    std::vector<std::string> challenges{};
+    std::vector<std::string> signatures{};
+    for (size_t i{0}; i < MAX_BATCH; ++i)
+    {
+        EvpPkeyPtr key{EVP_PKEY_Q_keygen(nullptr, nullptr, "ED25519"), &EVP_PKEY_free};
+        unsigned char raw[ed25519_batch::KEY_SIZE];
+        size_t raw_len{sizeof(raw)};
+        EvpMdCtxPtr ctx{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+        unsigned char signature[ed25519_batch::SIGNATURE_SIZE];
+        size_t signature_len{sizeof(signature)};
+        challenges.push_back(random_bytes(CHALLENGE_SIZE));
+        if (!key || !EVP_PKEY_get_raw_public_key(key.get(), raw, &raw_len) || !ctx ||
+            !EVP_DigestSignInit(ctx.get(), nullptr, nullptr, nullptr, key.get()) ||
+            !EVP_DigestSign(ctx.get(), signature, &signature_len,
+                            reinterpret_cast<const unsigned char *>(challenges.back().data()), challenges.back().length()))
+        {
+            throw std::runtime_error("Ed25519 setup failed");
+        }
+        keys.push_back(std::move(*ed25519_batch::parse_public_key(raw)));
+        signatures.emplace_back(reinterpret_cast<char *>(signature), signature_len);
+    }
+
+    report("Ed25519, OpenSSL (cofactorless)", 2'000, 1, [&]
+           { sink = sink + ed25519_batch::verify_one(challenges[0], signatures[0], keys[0]); });
+    report("Ed25519, cofactored one at a time", 2'000, 1, [&]
+           { sink = sink + ed25519_batch::verify_single(challenges[0], signatures[0], keys[0]); });
+
+    for (size_t batch : {2, 4, 8, 16, 32, 64})
+    {
+        std::vector<ed25519_batch::Item> items{};
+        for (size_t i{0}; i < batch; ++i)
+        {
+            items.push_back({&challenges[i], &signatures[i], &keys[i]});
+        }
+        report("Ed25519, batch of " + std::to_string(batch), 2'000 / batch + 10, batch, [&]
+               {
+                   std::vector<char> valid{ed25519_batch::verify_batch(items)};
+                   sink = sink + valid.back(); });
+    }
+
+    // One forged signature: the equation fails and every member is checked alone.
+    // Flip a bit of S, not R: a corrupted R often fails to decode and is
+    // rejected before the batch, which would time the clean path instead.
+    std::string forged{signatures[0]};
+    forged[32] = static_cast<char>(forged[32] ^ 1);
+    std::vector<ed25519_batch::Item> items{{&challenges[0], &forged, &keys[0]}};
+    for (size_t i{1}; i < 16; ++i)
+    {
+        items.push_back({&challenges[i], &signatures[i], &keys[i]});
+    }
+    report("Ed25519, batch of 16 with one forgery", 100, 16, [&]
+           {
+               std::vector<char> valid{ed25519_batch::verify_batch(items)};
+               sink = sink + valid.back(); });
+}
+
+// === Function: One HMAC handshake against server2; returns its latency in ns ===
+double timed_handshake(const int port)
+{
+    auto start{std::chrono::steady_clock::now()};
+    int sock{socket(AF_INET, SOCK_STREAM, 0)};
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    auto exchange{[&](const std::string &message)
+                  {
+                      char buffer[1024];
+                      ssize_t n{send(sock, message.data(), message.length(), MSG_NOSIGNAL) < 0 ? -1 : read(sock, buffer, sizeof(buffer))};
+                      return n > 0 ? std::string(buffer, static_cast<size_t>(n)) : std::string{};
+                  }};
+
+    std::string verdict{};
+    if (sock >= 0 && connect(sock, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+    {
+        std::string challenge{exchange("hello admin")};
+        unsigned char proof[EVP_MAX_MD_SIZE];
+        size_t proof_len{0};
+        const std::string secret{"pass123"};
+        if (challenge.length() == CHALLENGE_SIZE &&
+            EVP_Q_mac(nullptr, "HMAC", nullptr, "SHA1", nullptr, secret.data(), secret.length(),
+                      reinterpret_cast<const unsigned char *>(challenge.data()), challenge.length(), proof, sizeof(proof), &proof_len))
+        {
+            verdict = exchange(std::string(reinterpret_cast<char *>(proof), proof_len));
+        }
+    }
+    if (sock >= 0)
+    {
+        close(sock);
+    }
+    if (verdict.rfind("Authentication successful", 0) != 0)
+    {
+        return -1;
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// === Function: Print mean and percentiles of a run of handshake latencies ===
+void report_latencies(const std::string &name, std::vector<double> latencies)
+{
+    std::sort(latencies.begin(), latencies.end());
+    double total{0};
+    for (double latency : latencies)
+    {
+        total += latency;
+    }
+    auto percentile{[&](double p)
+                    { return latencies[std::min(latencies.size() - 1, static_cast<size_t>(p * static_cast<double>(latencies.size())))] / 1000.0; }};
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(1)
+              << " mean " << std::setw(8) << total / static_cast<double>(latencies.size()) / 1000.0
+              << " p50 " << std::setw(8) << percentile(0.50) << " p99 " << std::setw(8) << percentile(0.99)
+              << " max " << std::setw(8) << latencies.back() / 1000.0 << " us\n";
+}
+
+// === Function: First 1000 handshakes after boot vs. steady state ===
+// Starts a fresh server2 in a temporary directory and times handshakes from
+// the moment it accepts connections. Handshakes are paced below server2's
+// puzzle threshold (PUZZLE_LOAD_THRESHOLD hellos/s), so none is asked for work.
+void bench_startup(const std::string &server)
+{
+    constexpr size_t MEASURED{1000};
+    constexpr size_t SETTLING{4000}; // Untimed handshakes between the two runs
+    constexpr int BENCH_PORT{23556};
+    constexpr auto SPACING{std::chrono::microseconds(1000)};
+    std::cout << "-- handshake latency after boot (" << MEASURED << " handshakes, 1 per "
+              << SPACING.count() << " us) --\n";
+
+    // Load the client's own providers now, so only server2's cold start is
+    // timed, and make sure no other server answers on the port
+    if (timed_handshake(BENCH_PORT) >= 0)
+    {
+        throw std::runtime_error("Something already serves port " + std::to_string(BENCH_PORT));
+    }
+    unsigned char warm[EVP_MAX_MD_SIZE];
+    size_t warm_len{0};
+    EVP_Q_mac(nullptr, "HMAC", nullptr, "SHA1", nullptr, "k", 1, warm, 1, warm, sizeof(warm), &warm_len);
+
+    char resolved[PATH_MAX];
+    char directory[]{"/tmp/auth_bench.XXXXXX"};
+    if (!realpath(server.c_str(), resolved) || !mkdtemp(directory))
+    {
+        throw std::runtime_error("Cannot find " + server + " or create a working directory");
+    }
+    // A fresh server2 provisions its credentials from a password on stdin
+    int password_pipe[2]{-1, -1};
+    if (pipe(password_pipe) != 0)
+    {
+        throw std::runtime_error("pipe failed");
+    }
+    auto launched{std::chrono::steady_clock::now()};
+    pid_t child{fork()};
+    if (child == 0)
+    {
+        std::string port{std::to_string(BENCH_PORT)};
+        int log{-1};
+        if (chdir(directory) != 0 || (log = open("server2.log", O_WRONLY | O_CREAT | O_TRUNC, 0600)) < 0 ||
+            dup2(log, STDOUT_FILENO) < 0 || dup2(log, STDERR_FILENO) < 0 || dup2(password_pipe[0], STDIN_FILENO) < 0)
+        {
+            _exit(127);
+        }
+        close(password_pipe[0]);
+        close(password_pipe[1]);
+        execl(resolved, resolved, port.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(password_pipe[0]);
+    if (child < 0)
+    {
+        close(password_pipe[1]);
+        throw std::runtime_error("fork failed");
+    }
+    const std::string password_line{"pass123\n"};
+    [[maybe_unused]] ssize_t sent{write(password_pipe[1], password_line.data(), password_line.length())};
+    close(password_pipe[1]);
+
+    // The first handshake is attempted as soon as the port accepts connections.
+    // Poll rather than spin: on a small machine a spinning client is scheduled
+    // behind server2's threads and its connect() alone can take a time slice.
+    double first{-1};
+    while (first < 0 && std::chrono::steady_clock::now() - launched < std::chrono::seconds(10))
+    {
+        first = timed_handshake(BENCH_PORT);
+        if (first < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    }
+    double to_first{std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - launched).count()};
+
+    auto run{[&](size_t count, std::vector<double> *latencies)
+             {
+                 auto next{std::chrono::steady_clock::now()};
+                 for (size_t i{0}; i < count; ++i)
+                 {
+                     next += SPACING;
+                     std::this_thread::sleep_until(next);
+                     double latency{timed_handshake(BENCH_PORT)};
+                     if (latency < 0)
+                     {
+                         return false;
+                     }
+                     if (latencies)
+                     {
+                         latencies->push_back(latency);
+                     }
+                 }
+                 return true;
+             }};
+    std::vector<double> cold{first};
+    std::vector<double> steady{};
+    bool ok{first >= 0 && run(MEASURED - 1, &cold) && run(SETTLING, nullptr) && run(MEASURED, &steady)};
+    kill(child, SIGTERM);
+    waitpid(child, nullptr, 0);
+    if (!ok)
+    {
+        throw std::runtime_error(std::string{"Handshakes failed; see "} + directory + "/server2.log");
+    }
+
+    std::cout << "launch to first verdict: " << std::fixed << std::setprecision(0) << to_first
+              << " us (first handshake " << first / 1000.0 << " us)\n";
+    report_latencies("first " + std::to_string(MEASURED) + " after boot", cold);
+    report_latencies("after " + std::to_string(MEASURED + SETTLING), steady);
+    std::cout << "server2 log: " << directory << "/server2.log\n";
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        std::string which{argc > 1 ? argv[1] : "all"};
+        if (which == "all" || which == "hmac")
+        {
+            bench_hmac();
+        }
+        if (which == "all" || which == "openssl")
+        {
+            bench_openssl();
+        }
+        if (which == "all" || which == "logger")
+        {
+            bench_logger();
+        }
+        if (which == "all" || which == "ed25519")
+        {
+            bench_ed25519();
+        }
+        if (which == "all" || which == "token")
+        {
+            bench_token();
+        }
+        if (which == "arena")
+        {
+            bench_arena(argc > 2 ? std::stoul(argv[2]) : ARENA_TABLE_USERS);
+        }
+        if (which == "startup")
+        {
+            bench_startup(argc > 2 ? argv[2] : "./server2");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Benchmark error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
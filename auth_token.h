@@ -0,0 +1,490 @@
+#pragma once
+
+// === Bearer tokens ===
+// After a successful login, server.cpp mints a token that other services can
+// check locally, without calling back into the auth server:
+//
+//     v1.<key id>.<base64url(claims)>.<base64url(HMAC-SHA256(key, "v1.<key id>.<base64url(claims)>"))>
+//
+// where claims is "sub=<user>;exp=<unix seconds>;scp=<scopes>".
+//
+// Keys live in a small text file, one "<key id> <hex key>" per line, readable by
+// its owner only (mode 0600; other modes are refused). The newest
+// (last) key signs; every listed key verifies, so keys can be rotated by
+// appending a new one and dropping the old one once its tokens have expired.
+//
+// Usage in another process:
+//
+//     TokenVerifier verifier{"token_keys"};
+//     if (auto claims{verifier.verify(token)}) { ... claims->subject() ... }
+//
+// Link with -lcrypto.
+
+#include <string>             // For std::string
+#include <string_view>        // For std::string_view (tokens are verified in place)
+#include <cstdint>            // For uint32_t, uint16_t
+#include <algorithm>          // For std::copy
+#include <array>              // For std::array (base64url decoding table)
+#include <vector>             // For std::vector
+#include <sstream>            // For std::istringstream
+#include <optional>           // For std::optional (verification result)
+#include <ctime>              // For std::time()
+#include <charconv>           // For std::from_chars() – the expiry claim
+#include <stdexcept>          // For std::runtime_error
+#include <openssl/crypto.h>   // For CRYPTO_memcmp(), OPENSSL_cleanse()
+#include <openssl/rand.h>     // For RAND_bytes() – new signing keys
+#include <cerrno>             // For errno (EEXIST)
+#include <fcntl.h>            // For open() – create the key file 0600
+#include <sys/stat.h>         // For fstat() – check the key file's mode
+#include <unistd.h>           // For read(), write(), close(), unlink()
+#include "hmac_midstate.h"    // For the precomputed HMAC-SHA256 key schedules
+
+namespace auth_token
+{
+    constexpr size_t SHA256_DIGEST_SIZE{32};
+    constexpr size_t KEY_SIZE{32};
+
+    // Longest claims text a token may carry (issuers refuse longer ones). The
+    // verifier decodes claims into a buffer of this size on the stack.
+    constexpr size_t MAX_CLAIMS_SIZE{256};
+
+    // What a valid token says about its holder. The decoded claims are held
+    // inline, so verifying allocates nothing; the accessors point into them.
+    class Claims
+    {
+    public:
+        std::string_view subject() const
+        {
+            return {text_ + subject_offset_, subject_length_};
+        }
+        long long expires_at() const // Unix seconds
+        {
+            return expires_at_;
+        }
+        std::string_view scopes() const // Space separated
+        {
+            return {text_ + scopes_offset_, scopes_length_};
+        }
+
+    private:
+        friend class TokenVerifier;
+
+        char text_[MAX_CLAIMS_SIZE];
+        uint16_t subject_offset_{0};
+        uint16_t subject_length_{0};
+        uint16_t scopes_offset_{0};
+        uint16_t scopes_length_{0};
+        long long expires_at_{0};
+    };
+
+    // === Base64url without padding ===
+    inline std::string base64url_encode(const std::string &data)
+    {
+        static constexpr char ALPHABET[]{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"};
+        std::string out{};
+        out.reserve((data.length() * 4 + 2) / 3);
+        size_t i{0};
+        for (; i + 2 < data.length(); i += 3)
+        {
+            uint32_t n{(static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << 16) |
+                       (static_cast<uint32_t>(static_cast<unsigned char>(data[i + 1])) << 8) |
+                       static_cast<unsigned char>(data[i + 2])};
+            out += ALPHABET[(n >> 18) & 63];
+            out += ALPHABET[(n >> 12) & 63];
+            out += ALPHABET[(n >> 6) & 63];
+            out += ALPHABET[n & 63];
+        }
+        if (size_t rest{data.length() - i}; rest > 0)
+        {
+            uint32_t n{static_cast<uint32_t>(static_cast<unsigned char>(data[i])) << 16};
+            if (rest == 2)
+            {
+                n |= static_cast<uint32_t>(static_cast<unsigned char>(data[i + 1])) << 8;
+            }
+            out += ALPHABET[(n >> 18) & 63];
+            out += ALPHABET[(n >> 12) & 63];
+            if (rest == 2)
+            {
+                out += ALPHABET[(n >> 6) & 63];
+            }
+        }
+        return out;
+    }
+
+    // === Function: Decode base64url into `out` ===
+    // Returns the decoded length, or std::nullopt for characters outside the
+    // alphabet, a length no encoder produces, more than `capacity` bytes, or
+    // nonzero bits left over in the last character. The last check makes the
+    // encoding canonical: otherwise one MAC would have several valid spellings.
+    inline std::optional<size_t> base64url_decode(std::string_view text, unsigned char *out, size_t capacity)
+    {
+        // Value of each character, or 64 outside the alphabet
+        static constexpr auto VALUES{[]
+                                     {
+                                         std::array<uint8_t, 256> values{};
+                                         constexpr char ALPHABET[]{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"};
+                                         for (auto &v : values)
+                                         {
+                                             v = 64;
+                                         }
+                                         for (uint8_t i{0}; i < 64; ++i)
+                                         {
+                                             values[static_cast<unsigned char>(ALPHABET[i])] = i;
+                                         }
+                                         return values;
+                                     }()};
+
+        if (text.length() % 4 == 1 || text.length() / 4 * 3 + (text.length() % 4 == 0 ? 0 : text.length() % 4 - 1) > capacity)
+        {
+            return std::nullopt;
+        }
+        // Four characters (24 bits) at a time; the 64 marker survives the OR
+        auto value{[&](size_t i) -> uint32_t
+                   { return i < text.length() ? VALUES[static_cast<unsigned char>(text[i])] : 0; }};
+        size_t length{0};
+        for (size_t i{0}; i < text.length(); i += 4)
+        {
+            uint32_t a{value(i)};
+            uint32_t b{value(i + 1)};
+            uint32_t c{value(i + 2)};
+            uint32_t d{value(i + 3)};
+            if (((a | b | c | d) & 64) != 0)
+            {
+                return std::nullopt;
+            }
+            uint32_t n{a << 18 | b << 12 | c << 6 | d};
+            size_t rest{std::min<size_t>(text.length() - i, 4)};
+            // A short final group of 2 or 3 characters holds 1 or 2 bytes; its unused bits must be zero
+            if (rest < 4 && (n & (rest == 2 ? 0xFFFF : 0xFF)) != 0)
+            {
+                return std::nullopt;
+            }
+            out[length++] = static_cast<unsigned char>(n >> 16);
+            if (rest > 2)
+            {
+                out[length++] = static_cast<unsigned char>(n >> 8);
+            }
+            if (rest > 3)
+            {
+                out[length++] = static_cast<unsigned char>(n);
+            }
+        }
+        return length;
+    }
+
+    // === Hex helpers for the key file ===
+    inline std::string to_hex(const std::string &bytes)
+    {
+        static constexpr char DIGITS[]{"0123456789abcdef"};
+        std::string out{};
+        for (unsigned char b : bytes)
+        {
+            out += DIGITS[b >> 4];
+            out += DIGITS[b & 15];
+        }
+        return out;
+    }
+
+    // Value of one hex digit, or -1
+    inline int hex_digit(const char c)
+    {
+        if (c >= '0' && c <= '9')
+        {
+            return c - '0';
+        }
+        if (c >= 'a' && c <= 'f')
+        {
+            return c - 'a' + 10;
+        }
+        if (c >= 'A' && c <= 'F')
+        {
+            return c - 'A' + 10;
+        }
+        return -1;
+    }
+
+    inline std::string from_hex(const std::string &hex)
+    {
+        if (hex.empty() || hex.length() % 2 != 0)
+        {
+            throw std::runtime_error("Bad hex key");
+        }
+        std::string out{};
+        for (size_t i{0}; i < hex.length(); i += 2)
+        {
+            int high{hex_digit(hex[i])};
+            int low{hex_digit(hex[i + 1])};
+            if (high < 0 || low < 0)
+            {
+                throw std::runtime_error("Bad hex key");
+            }
+            out += static_cast<char>(high << 4 | low);
+        }
+        return out;
+    }
+
+    // === One HMAC-SHA256 key, with its key schedule done up front ===
+    // Like server2's credential records: the SHA256 midstates after absorbing
+    // key ^ ipad and key ^ opad are kept instead of the key (hmac_midstate.h),
+    // so a MAC costs only the message blocks plus one block for the outer hash.
+    class HmacKey
+    {
+    public:
+        HmacKey(std::string id, const std::string &key)
+            : id_{std::move(id)}, state_{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha256, key)}
+        {
+        }
+
+        const std::string &id() const
+        {
+            return id_;
+        }
+
+        // Raw 32-byte HMAC-SHA256 of `data` into `out`
+        void mac(std::string_view data, unsigned char *out) const
+        {
+            hmac_midstate::compute(state_, data, out);
+        }
+
+        std::string mac(std::string_view data) const
+        {
+            return hmac_midstate::compute_hmac(data, state_);
+        }
+
+    private:
+        std::string id_{};
+        hmac_midstate::KeyState state_{};
+    };
+
+    // === Function: Load every key from a key file ===
+    // Refuses a file that group or others can access: anyone who can read a
+    // key can forge tokens.
+    inline std::vector<HmacKey> load_keys(const std::string &path)
+    {
+        int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot open token key file " + path);
+        }
+        struct stat st{};
+        if (fstat(fd, &st) < 0 || (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        {
+            close(fd);
+            throw std::runtime_error("Token key file " + path + " must not be accessible by group or others (chmod 600)");
+        }
+        std::string contents{};
+        char chunk[4096]{};
+        for (ssize_t n{}; (n = read(fd, chunk, sizeof(chunk))) != 0;)
+        {
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n < 0)
+            {
+                close(fd);
+                throw std::runtime_error("Cannot read token key file " + path);
+            }
+            contents.append(chunk, static_cast<size_t>(n));
+        }
+        close(fd);
+        std::istringstream in{contents};
+        OPENSSL_cleanse(contents.data(), contents.size());
+        OPENSSL_cleanse(chunk, sizeof(chunk));
+
+        std::vector<HmacKey> keys{};
+        std::string line{};
+        while (std::getline(in, line))
+        {
+            std::istringstream fields{line};
+            std::string id{};
+            std::string hex{};
+            if (fields >> id >> hex)
+            {
+                std::string key{from_hex(hex)};
+                keys.emplace_back(id, key);
+                OPENSSL_cleanse(key.data(), key.size());
+            }
+        }
+        if (keys.empty())
+        {
+            throw std::runtime_error("No keys in token key file " + path);
+        }
+        return keys;
+    }
+
+    // === Function: Make sure a signing key exists ===
+    // Creates the key file (mode 0600, never replacing an existing file) with
+    // one random key if it doesn't exist yet.
+    inline void ensure_key_file(const std::string &path)
+    {
+        int fd{open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0600)};
+        if (fd < 0 && errno == EEXIST)
+        {
+            return;
+        }
+        if (fd < 0)
+        {
+            throw std::runtime_error("Cannot create token key file " + path);
+        }
+
+        unsigned char key[KEY_SIZE]{};
+        if (!RAND_bytes(key, sizeof(key)))
+        {
+            close(fd);
+            unlink(path.c_str());
+            throw std::runtime_error("Failed to generate token key");
+        }
+        std::string line{"1 " + to_hex(std::string(reinterpret_cast<char *>(key), sizeof(key))) + "\n"};
+        OPENSSL_cleanse(key, sizeof(key));
+        size_t done{0};
+        while (done < line.size())
+        {
+            ssize_t n{write(fd, line.data() + done, line.size() - done)};
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n <= 0)
+            {
+                break;
+            }
+            done += static_cast<size_t>(n);
+        }
+        OPENSSL_cleanse(line.data(), line.size());
+        bool closed{close(fd) == 0};
+        if (done < line.size() || !closed)
+        {
+            unlink(path.c_str());
+            throw std::runtime_error("Cannot write token key file " + path);
+        }
+    }
+
+    // === Token issuer (auth server side) ===
+    class TokenIssuer
+    {
+    public:
+        explicit TokenIssuer(const std::string &key_file) : keys_{load_keys(key_file)}
+        {
+        }
+
+        std::string issue(const std::string &subject, const std::string &scopes, long long ttl_seconds) const
+        {
+            // ';' and '=' delimit claims, so they can't appear inside one
+            if (subject.find_first_of(";=") != std::string::npos || scopes.find_first_of(";=") != std::string::npos)
+            {
+                throw std::runtime_error("Token claims must not contain ';' or '='");
+            }
+
+            const HmacKey &key{keys_.back()};
+            long long expires_at{static_cast<long long>(std::time(nullptr)) + ttl_seconds};
+            std::string claims{"sub=" + subject + ";exp=" + std::to_string(expires_at) + ";scp=" + scopes};
+            if (claims.length() > MAX_CLAIMS_SIZE)
+            {
+                throw std::runtime_error("Token claims longer than " + std::to_string(MAX_CLAIMS_SIZE) + " bytes");
+            }
+            std::string signed_part{"v1." + key.id() + "." + base64url_encode(claims)};
+            return signed_part + "." + base64url_encode(key.mac(signed_part));
+        }
+
+    private:
+        std::vector<HmacKey> keys_{};
+    };
+
+    // === Token verifier (any service) ===
+    // Keys are read and prepared once; verify() is pure computation over the
+    // token in place: one split, one HMAC over ~100 bytes, a constant-time
+    // compare against the MAC decoded on the stack, and a claims parse into
+    // Claims' inline buffer. Nothing is copied to the heap.
+    class TokenVerifier
+    {
+    public:
+        explicit TokenVerifier(const std::string &key_file) : keys_{load_keys(key_file)}
+        {
+        }
+
+        std::optional<Claims> verify(std::string_view token) const
+        {
+            // Split "v1.<kid>.<claims>.<mac>"
+            size_t first{token.find('.')};
+            size_t second{first == std::string_view::npos ? first : token.find('.', first + 1)};
+            size_t third{second == std::string_view::npos ? second : token.find('.', second + 1)};
+            if (third == std::string_view::npos || token.substr(0, first) != "v1")
+            {
+                return std::nullopt;
+            }
+
+            const HmacKey *key{find_key(token.substr(first + 1, second - first - 1))};
+            unsigned char mac[SHA256_DIGEST_SIZE];
+            std::optional<size_t> mac_length{base64url_decode(token.substr(third + 1), mac, sizeof(mac))};
+            if (!key || mac_length != SHA256_DIGEST_SIZE)
+            {
+                return std::nullopt;
+            }
+
+            unsigned char expected[SHA256_DIGEST_SIZE];
+            key->mac(token.substr(0, third), expected);
+            if (CRYPTO_memcmp(expected, mac, SHA256_DIGEST_SIZE) != 0)
+            {
+                return std::nullopt;
+            }
+
+            std::optional<Claims> claims{Claims{}};
+            std::optional<size_t> claims_length{base64url_decode(token.substr(second + 1, third - second - 1),
+                                                                 reinterpret_cast<unsigned char *>(claims->text_),
+                                                                 sizeof(claims->text_))};
+            if (!claims_length || !parse_claims(std::string_view(claims->text_, *claims_length), *claims) ||
+                claims->expires_at_ <= static_cast<long long>(std::time(nullptr)))
+            {
+                return std::nullopt;
+            }
+            return claims;
+        }
+
+    private:
+        const HmacKey *find_key(std::string_view id) const
+        {
+            for (const HmacKey &key : keys_)
+            {
+                if (key.id() == id)
+                {
+                    return &key;
+                }
+            }
+            return nullptr;
+        }
+
+        // Fills in the claims' offsets; `text` is the claims' own buffer
+        static bool parse_claims(std::string_view text, Claims &claims)
+        {
+            bool has_expiry{false};
+            for (size_t start{0}; start < text.length();)
+            {
+                size_t end{std::min(text.find(';', start), text.length())};
+                std::string_view name{text.substr(start, 4)};
+                auto offset{static_cast<uint16_t>(start + 4)};
+                auto length{static_cast<uint16_t>(end - std::min<size_t>(end, start + 4))};
+                if (name == "sub=")
+                {
+                    claims.subject_offset_ = offset;
+                    claims.subject_length_ = length;
+                }
+                else if (name == "exp=")
+                {
+                    const char *digits{text.data() + offset};
+                    auto [parsed, error]{std::from_chars(digits, digits + length, claims.expires_at_)};
+                    has_expiry = error == std::errc{} && parsed == digits + length;
+                }
+                else if (name == "scp=")
+                {
+                    claims.scopes_offset_ = offset;
+                    claims.scopes_length_ = length;
+                }
+                start = end + 1;
+            }
+            return has_expiry && claims.subject_length_ > 0;
+        }
+
+        std::vector<HmacKey> keys_{};
+    };
+}
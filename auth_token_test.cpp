@@ -0,0 +1,182 @@
+#include <iostream>     // For std::cout, std::cerr
+#include <string>       // For std::string
+#include <string_view>  // For std::string_view
+#include <stdexcept>    // For std::runtime_error
+#include <ctime>        // For std::time()
+#include <cstdlib>      // For mkdtemp()
+#include <fcntl.h>      // For open()
+#include <unistd.h>     // For write(), close(), unlink(), rmdir()
+#include "auth_token.h"
+
+// Checks for auth_token.h: valid tokens verify, and tampered, expired,
+// unknown-key, non-canonical and malformed tokens don't.
+//
+// Build: g++ -std=c++17 -O2 auth_token_test.cpp -o auth_token_test -lcrypto
+// Usage: ./auth_token_test   (exits non-zero if any check fails)
+
+size_t failures{0};
+
+// === Function: Record one check ===
+void check(const std::string &name, bool passed)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << name << "\n";
+    failures += passed ? 0 : 1;
+}
+
+// === Function: Write a key file with the given lines (mode 0600 unless told otherwise) ===
+void write_key_file(const std::string &path, const std::string &lines, mode_t mode = 0600)
+{
+    unlink(path.c_str());
+    int fd{open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY, mode)};
+    if (fd < 0 || write(fd, lines.data(), lines.size()) != static_cast<ssize_t>(lines.size()))
+    {
+        throw std::runtime_error("Cannot write " + path);
+    }
+    close(fd);
+}
+
+// === Function: Base64url round trips and canonical-encoding rejects ===
+void test_base64url()
+{
+    bool round_trips{true};
+    std::string data{};
+    for (size_t length{0}; length < 40; ++length)
+    {
+        std::string encoded{auth_token::base64url_encode(data)};
+        unsigned char decoded[40]{};
+        std::optional<size_t> decoded_length{auth_token::base64url_decode(encoded, decoded, sizeof(decoded))};
+        round_trips = round_trips && decoded_length == data.length() &&
+                      std::string(reinterpret_cast<char *>(decoded), *decoded_length) == data;
+        data += static_cast<char>(length * 37 + 11);
+    }
+    check("base64url: encode/decode round trips for 0..39 bytes", round_trips);
+
+    unsigned char out[8]{};
+    check("base64url: one leftover character is rejected", !auth_token::base64url_decode("QUJDR", out, sizeof(out)));
+    check("base64url: characters outside the alphabet are rejected", !auth_token::base64url_decode("QU+D", out, sizeof(out)));
+    check("base64url: output longer than the buffer is rejected", !auth_token::base64url_decode("QUJDREVGR0hJ", out, sizeof(out)));
+    // "QQ" and "QUI" are the canonical encodings of "A" and "AB"; "QR" and "QUJ"
+    // differ from them only in the unused trailing bits
+    check("base64url: canonical trailing bits accepted", auth_token::base64url_decode("QQ", out, sizeof(out)) == size_t{1});
+    check("base64url: nonzero trailing bits rejected (2 chars)", !auth_token::base64url_decode("QR", out, sizeof(out)));
+    check("base64url: nonzero trailing bits rejected (3 chars)", !auth_token::base64url_decode("QUJ", out, sizeof(out)));
+}
+
+// === Function: Tokens issued and verified with real key files ===
+void test_tokens(const std::string &directory)
+{
+    const std::string keys{directory + "/token_keys"};
+    const std::string rotated{directory + "/rotated_keys"};
+    const std::string other{directory + "/other_keys"};
+    const std::string open_keys{directory + "/open_keys"};
+    auth_token::ensure_key_file(keys);
+    write_key_file(other, "1 00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\n"
+                          "7 ffeeddccbbaa99887766554433221100ffeeddccbbaa99887766554433221100\n");
+
+    auth_token::TokenIssuer issuer{keys};
+    auth_token::TokenVerifier verifier{keys};
+    long long before{static_cast<long long>(std::time(nullptr))};
+    std::string token{issuer.issue("alice", "read write", 300)};
+
+    std::optional<auth_token::Claims> claims{verifier.verify(token)};
+    check("valid token verifies", claims.has_value());
+    check("valid token carries its claims", claims && claims->subject() == "alice" && claims->scopes() == "read write" &&
+                                                claims->expires_at() >= before + 300 &&
+                                                claims->expires_at() <= static_cast<long long>(std::time(nullptr)) + 300);
+    std::optional<auth_token::Claims> copied{claims};
+    claims.reset();
+    check("claims stay valid when copied", copied && copied->subject() == "alice");
+
+    // Expiry
+    check("expired token is rejected", !verifier.verify(issuer.issue("alice", "read", -1)));
+    check("token expiring now is rejected", !verifier.verify(issuer.issue("alice", "read", 0)));
+
+    // Unknown keys: an id the verifier doesn't list, and a listed id with another key
+    auth_token::TokenIssuer other_issuer{other}; // Signs with key 7
+    check("token signed with an unknown key id is rejected", !verifier.verify(other_issuer.issue("alice", "read", 300)));
+    write_key_file(rotated, "1 00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\n");
+    check("token signed with another key under a known id is rejected",
+          !verifier.verify(auth_token::TokenIssuer{rotated}.issue("alice", "read", 300)));
+    check("every listed key verifies (rotation)", auth_token::TokenVerifier{other}.verify(
+                                                      auth_token::TokenIssuer{rotated}.issue("alice", "read", 300))
+                                                      .has_value());
+
+    // Tampering: any single changed character, in any part, must be caught
+    bool all_rejected{true};
+    for (size_t i{0}; i < token.length(); ++i)
+    {
+        std::string tampered{token};
+        tampered[i] = tampered[i] == 'A' ? 'B' : 'A';
+        all_rejected = all_rejected && !verifier.verify(tampered);
+    }
+    check("every single-character change is rejected", all_rejected);
+    check("truncated token is rejected", !verifier.verify(token.substr(0, token.length() - 1)));
+    check("token with trailing data is rejected", !verifier.verify(token + "A"));
+    check("token with an extra segment is rejected", !verifier.verify(token + ".x"));
+
+    // The MAC's last character carries 4 bits of the MAC and 2 unused bits;
+    // setting the unused bits must not give a second valid spelling
+    std::string non_canonical{token};
+    constexpr std::string_view ALPHABET{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_"};
+    non_canonical.back() = ALPHABET[ALPHABET.find(token.back()) | 1];
+    check("MAC with nonzero trailing bits is rejected", !verifier.verify(non_canonical));
+
+    // Malformed input
+    check("empty token is rejected", !verifier.verify(""));
+    check("wrong version is rejected", !verifier.verify("v2" + token.substr(2)));
+    check("missing segments are rejected", !verifier.verify("v1.1.abc"));
+
+    // Claims the verifier couldn't hold are refused at issue time
+    bool refused{false};
+    try
+    {
+        issuer.issue(std::string(auth_token::MAX_CLAIMS_SIZE, 'a'), "read", 300);
+    }
+    catch (const std::runtime_error &)
+    {
+        refused = true;
+    }
+    check("claims longer than MAX_CLAIMS_SIZE are refused", refused);
+
+    // Key files others can read are refused
+    write_key_file(open_keys, "1 00112233445566778899aabbccddeeff00112233445566778899aabbccddeeff\n", 0644);
+    bool load_refused{false};
+    try
+    {
+        auth_token::TokenVerifier open_verifier{open_keys};
+    }
+    catch (const std::runtime_error &)
+    {
+        load_refused = true;
+    }
+    check("key file readable by others is refused", load_refused);
+
+    for (const std::string &path : {keys, rotated, other, open_keys})
+    {
+        unlink(path.c_str());
+    }
+}
+
+int main()
+{
+    char directory[]{"/tmp/auth_token_test.XXXXXX"};
+    if (!mkdtemp(directory))
+    {
+        std::cerr << "Cannot create a temporary directory\n";
+        return 1;
+    }
+    try
+    {
+        test_base64url();
+        test_tokens(directory);
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Test error: " << e.what() << "\n";
+        failures += 1;
+    }
+    rmdir(directory);
+
+    std::cout << (failures == 0 ? "All checks passed\n" : std::to_string(failures) + " check(s) failed\n");
+    return failures == 0 ? 0 : 1;
+}
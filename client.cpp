@@ -1,5 +1,12 @@
 #include <iostream>    // For std::cin, std::cout, std::cerr
 #include <string>      // For std::string
+#include <fstream>     // For std::ifstream (batch credential files)
+#include <vector>      // For std::vector
+#include <thread>      // For std::thread (concurrent batch sessions)
+#include <atomic>      // For std::atomic (shared batch cursor)
+#include <mutex>       // For std::mutex (ordered result output)
+#include <chrono>      // For latency measurement
+#include <algorithm>   // For std::sort
 #include <unistd.h>    // For read(), write(), close()
 #include <arpa/inet.h> // For inet_pton(), sockaddr_in
 
@@ -92,11 +99,23 @@ std::string read_message(const int sock)
 }
 
 // Function to send a message to the server
+// MSG_NOSIGNAL: a server that already closed the session must not SIGPIPE a batch run
 void send_message(const int sock, const std::string &msg)
 {
-    send(sock, msg.c_str(), msg.length(), 0);
+    send(sock, msg.c_str(), msg.length(), MSG_NOSIGNAL);
 }
 
+// Closes a socket when it goes out of scope, however the session ends
+struct SocketGuard
+{
+    int fd;
+
+    ~SocketGuard()
+    {
+        close(fd);
+    }
+};
+
 // Function to handle the client interaction workflow
 void client_interaction(const int sock)
 {
@@ -127,14 +146,222 @@ void client_interaction(const int sock)
     std::cout << msg << "\n";
 }
 
+// ============================================================================
+// Batch mode: check many credentials without user interaction
+//
+//   ./client --batch <file|-> [--concurrency N]
+//
+// Each input line is "username:password". Every entry uses its own
+// connection (the protocol has one login per connection and no message
+// framing, so requests can't be pipelined inside one session); N worker
+// threads keep N sessions in flight at once.
+//
+// Limits when checking against server.cpp:
+// - server.cpp serves one connection at a time, so N > 1 only queues
+//   sessions in its accept backlog; it doesn't make the batch faster.
+// - Every wrong password counts toward the account's lockout, as for an
+//   interactive login. After 5 recent failures for an account, its later
+//   entries report LOCKED rather than their own verdict. Spread entries for
+//   one account over time (the score halves every 5 minutes) if every
+//   verdict matters.
+//
+// Output: one line per entry on stdout, "line<TAB>username<TAB>result<TAB>latency_us",
+// followed by an aggregate summary on stderr.
+// ============================================================================
+
+// One credential to check and what happened to it
+struct BatchEntry
+{
+    size_t line{0};
+    std::string username{};
+    std::string password{};
+    std::string result{};
+    long long latency_us{0};
+};
+
+// Function to run one non-interactive login and classify the outcome
+std::string authenticate(const std::string &username, const std::string &password)
+{
+    int sock{create_client_socket()};
+    SocketGuard guard{sock};
+
+    read_message(sock); // Greeting
+    send_message(sock, "hello");
+    read_message(sock); // Username prompt
+    send_message(sock, username);
+
+    // A locked account gets a refusal instead of the password prompt
+    std::string msg{read_message(sock)};
+    if (msg.rfind("Enter password", 0) != 0)
+    {
+        return msg.empty() ? "ERROR" : "LOCKED";
+    }
+    send_message(sock, password);
+
+    msg = read_message(sock);
+
+    if (msg.rfind("Authentication successful", 0) == 0)
+    {
+        return "OK";
+    }
+    return msg.empty() ? "ERROR" : "FAILED";
+}
+
+// Function to read "username:password" lines from a stream
+std::vector<BatchEntry> read_batch(std::istream &in)
+{
+    std::vector<BatchEntry> entries{};
+    std::string line{};
+    size_t line_number{0};
+    while (std::getline(in, line))
+    {
+        line_number++;
+        size_t colon{line.find(':')};
+        if (line.empty() || colon == std::string::npos)
+        {
+            std::cerr << "Skipping line " << line_number << ": expected username:password\n";
+            continue;
+        }
+        entries.push_back({line_number, line.substr(0, colon), line.substr(colon + 1), {}, 0});
+    }
+    return entries;
+}
+
+// Function to check every entry using `concurrency` parallel sessions
+void run_batch(std::vector<BatchEntry> &entries, const size_t concurrency)
+{
+    std::atomic<size_t> next{0};
+    std::mutex output_mutex{};
+
+    auto worker{[&]
+                {
+                    for (size_t i{next++}; i < entries.size(); i = next++)
+                    {
+                        BatchEntry &entry{entries[i]};
+                        auto start{std::chrono::steady_clock::now()};
+                        try
+                        {
+                            entry.result = authenticate(entry.username, entry.password);
+                        }
+                        catch (const std::exception &e)
+                        {
+                            entry.result = "ERROR";
+                        }
+                        entry.latency_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                                               std::chrono::steady_clock::now() - start)
+                                               .count();
+
+                        std::lock_guard<std::mutex> lock{output_mutex};
+                        std::cout << entry.line << "\t" << entry.username << "\t"
+                                  << entry.result << "\t" << entry.latency_us << "\n";
+                    }
+                }};
+
+    std::vector<std::thread> workers{};
+    for (size_t i{0}; i < concurrency; ++i)
+    {
+        workers.emplace_back(worker);
+    }
+    for (std::thread &t : workers)
+    {
+        t.join();
+    }
+}
+
+// Function to print totals, throughput and latency percentiles
+void print_summary(const std::vector<BatchEntry> &entries, const double elapsed_seconds)
+{
+    size_t ok{0};
+    size_t failed{0};
+    size_t locked{0};
+    size_t errors{0};
+    std::vector<long long> latencies{};
+    for (const BatchEntry &entry : entries)
+    {
+        ok += entry.result == "OK";
+        failed += entry.result == "FAILED";
+        locked += entry.result == "LOCKED";
+        errors += entry.result == "ERROR";
+        latencies.push_back(entry.latency_us);
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    auto percentile{[&](const double p)
+                    {
+                        if (latencies.empty())
+                        {
+                            return 0LL;
+                        }
+                        return latencies[static_cast<size_t>(p * static_cast<double>(latencies.size() - 1))];
+                    }};
+
+    std::cerr << "Checked " << entries.size() << " credentials in " << elapsed_seconds << " s ("
+              << (elapsed_seconds > 0 ? static_cast<double>(entries.size()) / elapsed_seconds : 0.0) << " per second)\n"
+              << "  ok: " << ok << "  failed: " << failed << "  locked: " << locked << "  errors: " << errors << "\n"
+              << "  latency us  p50: " << percentile(0.50) << "  p90: " << percentile(0.90)
+              << "  p99: " << percentile(0.99) << "  max: " << percentile(1.0) << "\n";
+}
+
 // Main function with error handling
-int main()
+int main(int argc, char *argv[])
 {
     try
     {
-        int sock{create_client_socket()};
-        client_interaction(sock);
-        close(sock); // Always close the socket after use
+        // Interactive mode (default): one login typed by the user
+        if (argc == 1)
+        {
+            int sock{create_client_socket()};
+            client_interaction(sock);
+            close(sock); // Always close the socket after use
+            return 0;
+        }
+
+        // Batch mode: parse --batch <file|-> [--concurrency N]
+        std::string source{};
+        size_t concurrency{1};
+        for (int i{1}; i < argc; ++i)
+        {
+            std::string arg{argv[i]};
+            if (arg == "--batch" && i + 1 < argc)
+            {
+                source = argv[++i];
+            }
+            else if (arg == "--concurrency" && i + 1 < argc)
+            {
+                concurrency = std::max(1UL, std::stoul(argv[++i]));
+            }
+            else
+            {
+                throw std::runtime_error("Usage: client [--batch <file|-> [--concurrency N]]\n"
+                                         "  --concurrency has no effect against server.cpp, which serves one connection at a time.\n"
+                                         "  Wrong passwords count toward the account lockout: after 5 recent failures an\n"
+                                         "  account's later entries report LOCKED instead of their own verdict.");
+            }
+        }
+        if (source.empty())
+        {
+            throw std::runtime_error("--batch <file|-> is required");
+        }
+
+        std::vector<BatchEntry> entries{};
+        if (source == "-")
+        {
+            entries = read_batch(std::cin);
+        }
+        else
+        {
+            std::ifstream file{source};
+            if (!file)
+            {
+                throw std::runtime_error("Cannot open " + source);
+            }
+            entries = read_batch(file);
+        }
+
+        auto start{std::chrono::steady_clock::now()};
+        run_batch(entries, concurrency);
+        std::chrono::duration<double> elapsed{std::chrono::steady_clock::now() - start};
+        print_summary(entries, elapsed.count());
     }
     catch (const std::exception &e)
     {
@@ -2,42 +2,169 @@
 #include <string>         // For std::string
 #include <unistd.h>       // For POSIX system calls: read(), write(), close()
 #include <arpa/inet.h>    // For sockaddr_in, inet_pton, htons
-#include <openssl/hmac.h> // For HMAC() using SHA1
+#include <memory>         // For std::unique_ptr (OpenSSL object ownership)
+#include <openssl/evp.h>  // For EVP_MAC – HMAC through the OpenSSL 3 provider API
+#include <openssl/core_names.h> // For OSSL_MAC_PARAM_DIGEST
+#include <cstdint>        // For fixed-width integers (puzzle nonce)
+#include <cstdio>         // For FILE (PEM key files)
+#include <fcntl.h>        // For open() – create the private key 0600
+#include <sys/stat.h>     // For fstat() – check the private key's mode
+#include <openssl/pem.h>  // For reading/writing Ed25519 keys as PEM
+#include <map>            // For the SCRAM key derivation cache
+#include <tuple>          // For the cache key
+#include <mutex>          // For guarding the cache
+#include <openssl/crypto.h> // For CRYPTO_memcmp(), OPENSSL_cleanse()
+#include <openssl/rand.h>   // For RAND_bytes() (SCRAM cache fingerprint key)
+#include <chrono>         // For the session deadline and hedge delays
+#include <sys/time.h>     // For timeval (SO_RCVTIMEO)
+#include <sys/socket.h>   // For shutdown() (cancelling a losing hedge)
+#include <vector>         // For the replica list and latency history
+#include <thread>         // For racing hedged attempts
+#include <condition_variable> // For waiting on the first verdict
+#include <algorithm>      // For std::nth_element, std::sort
+#include <iomanip>        // For std::setprecision
+#include <atomic>         // For the request counter shared by --concurrency threads
+#include <random>         // For picking two replicas at random
+#include <sstream>        // For the per-replica report
 
 // === Constants ===
 constexpr int PORT{12345};                  // Server port to connect to
 const std::string SHARED_SECRET{"pass123"}; // Shared key known to both client and server
+const std::string USERNAME{"admin"};        // Account the shared key belongs to
+
+// Ed25519 mode (--ed25519) logs in to a separate, key-only account: our private
+// key, and the public key file the server loads at startup (copy it next to
+// server2 and restart it to provision)
+const std::string ED25519_USERNAME{"operator"};
+const std::string ED25519_PRIVATE_KEY_FILE{"client_ed25519.pem"};
+const std::string ED25519_PUBLIC_KEY_FILE{ED25519_USERNAME + ".ed25519.pub"};
+
+// Puzzle frame sent by an overloaded server: "PUZZLE" | difficulty | 16-byte seed
+const std::string PUZZLE_TAG{"PUZZLE"};
+constexpr size_t PUZZLE_SEED_SIZE{16};
+
+// Reply from a server that dropped our session because our deadline passed
+const std::string DEADLINE_EXCEEDED{"Deadline exceeded."};
+
+// Reply when our puzzle solution was wrong or too late
+const std::string PUZZLE_NOT_SOLVED{"Puzzle not solved."};
+
+// The server's verdicts; success may carry more text (e.g. the SCRAM server signature)
+const std::string AUTH_SUCCESS_PREFIX{"Authentication successful"};
+const std::string AUTH_FAILURE{"Authentication failed."};
+
+// Hedged requests (--replica): once an attempt has run longer than this
+// percentile of recent attempts, a second one goes to another replica
+constexpr double HEDGE_PERCENTILE{0.95};
+constexpr size_t HEDGE_HISTORY{256};    // Recent attempt latencies the percentile is taken over
+constexpr size_t HEDGE_MIN_SAMPLES{20}; // Below this, wait HEDGE_INITIAL_DELAY instead
+constexpr std::chrono::microseconds HEDGE_INITIAL_DELAY{50'000};
+constexpr std::chrono::microseconds HEDGE_MIN_DELAY{500}; // Never hedge sooner than this
+
+// Hedges may add at most this percent of extra attempts (--hedge-budget);
+// unused budget accumulates up to HEDGE_BUDGET_BURST hedges
+constexpr double DEFAULT_HEDGE_BUDGET_PERCENT{5.0};
+constexpr double HEDGE_BUDGET_BURST{10.0};
+
+// Load balancing across replicas: weight of the newest sample in each
+// replica's latency EWMA
+constexpr double BALANCER_EWMA_WEIGHT{0.2};
+
+// Outlier ejection: a replica is taken out of rotation after this many failures
+// in a row, or when its latency EWMA is EJECT_SLOW_FACTOR times the median of
+// the others (and above EJECT_SLOW_MIN_LATENCY). Each ejection in a row doubles
+// its length, up to EJECT_MAX_BACKOFF; EJECT_RESET_SUCCESSES successes in a row
+// forgive past ejections. At most MAX_EJECTED_FRACTION of replicas are out.
+constexpr size_t EJECT_AFTER_FAILURES{3};
+constexpr double EJECT_SLOW_FACTOR{5.0};
+constexpr std::chrono::microseconds EJECT_SLOW_MIN_LATENCY{5'000};
+constexpr size_t EJECT_MIN_SAMPLES{5};
+constexpr std::chrono::milliseconds EJECT_BASE_BACKOFF{1'000};
+constexpr std::chrono::milliseconds EJECT_MAX_BACKOFF{30'000};
+constexpr size_t EJECT_RESET_SUCCESSES{20};
+constexpr double MAX_EJECTED_FRACTION{0.5};
+
+// Owning pointers for OpenSSL MAC algorithms and contexts
+using EvpMacPtr = std::unique_ptr<EVP_MAC, decltype(&EVP_MAC_free)>;
+using EvpMacCtxPtr = std::unique_ptr<EVP_MAC_CTX, decltype(&EVP_MAC_CTX_free)>;
+
+// === Function: Fetch the HMAC implementation once ===
+// The legacy HMAC() call fetches the algorithm and builds a fresh context on
+// every invocation. We fetch EVP_MAC "HMAC" a single time and share it.
+EVP_MAC *hmac_mac()
+{
+    static const EvpMacPtr mac{EVP_MAC_fetch(nullptr, "HMAC", nullptr), &EVP_MAC_free};
+    if (!mac)
+    {
+        throw std::runtime_error("Failed to fetch HMAC implementation");
+    }
+    return mac.get();
+}
 
 // === Function: Compute HMAC ===
-// Computes a HMAC-SHA1 of the input data using the shared key.
-// Used to respond to server's challenge in challenge-response auth.
+// Computes a HMAC (SHA1 unless another digest is named) of the input data
+// using the given key. Used to respond to server's challenge in challenge-response auth.
 //
-// Note: OpenSSL's HMAC() returns a static buffer. We must copy it immediately.
-// We convert the raw binary result to std::string (which may contain nulls).
-std::string compute_hmac(const std::string &data, const std::string &key)
+// Each thread keeps a context with the digest already looked up, but no key:
+// a call duplicates it and keys the copy, which is freed (and wiped by
+// OpenSSL) on return. Keys here are the shared secret and SCRAM keys, so no
+// keyed context outlives the call.
+std::string compute_hmac(const std::string &data, const std::string &key, const std::string &digest = "SHA1")
 {
-    unsigned int len{20}; // SHA1 = 160-bit = 20 bytes
+    thread_local std::string cached_digest{};
+    thread_local EvpMacCtxPtr unkeyed{nullptr, &EVP_MAC_CTX_free};
+
+    if (!unkeyed || cached_digest != digest)
+    {
+        std::string digest_name{digest};
+        OSSL_PARAM params[]{
+            OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest_name.data(), 0),
+            OSSL_PARAM_construct_end()};
 
-    // Get raw pointer to 20-byte HMAC digest (computed by OpenSSL)
-    unsigned char *raw_result = HMAC(
-        EVP_sha1(),                                                           // Hash function (SHA1)
-        key.c_str(), static_cast<int>(key.length()),                          // Key buffer + length
-        reinterpret_cast<const unsigned char *>(data.c_str()), data.length(), // Message
-        nullptr, nullptr                                                      // Not using output len pointer
-    );
+        EvpMacCtxPtr fresh{EVP_MAC_CTX_new(hmac_mac()), &EVP_MAC_CTX_free};
+        if (!fresh || !EVP_MAC_CTX_set_params(fresh.get(), params))
+        {
+            throw std::runtime_error("HMAC initialisation failed");
+        }
+        unkeyed = std::move(fresh);
+        cached_digest = digest;
+    }
 
-    if (!raw_result)
+    EvpMacCtxPtr ctx{EVP_MAC_CTX_dup(unkeyed.get()), &EVP_MAC_CTX_free};
+    unsigned char result[EVP_MAX_MD_SIZE]{};
+    size_t len{0};
+    if (!ctx || !EVP_MAC_init(ctx.get(), reinterpret_cast<const unsigned char *>(key.data()), key.length(), nullptr) ||
+        !EVP_MAC_update(ctx.get(), reinterpret_cast<const unsigned char *>(data.data()), data.length()) ||
+        !EVP_MAC_final(ctx.get(), result, &len, sizeof(result)))
     {
         throw std::runtime_error("HMAC computation failed");
     }
 
     // reinterpret_cast is needed to treat raw bytes as char array
     // Safe here because we copy `len` bytes explicitly into the string
-    return std::string(reinterpret_cast<char *>(raw_result), len);
+    return std::string(reinterpret_cast<char *>(result), len);
+}
+
+// A server to connect to, given on the command line as "host:port"
+struct Endpoint
+{
+    std::string host{"127.0.0.1"};
+    int port{PORT};
+};
+
+// === Function: Parse "host:port" ===
+Endpoint parse_endpoint(const std::string &text)
+{
+    size_t colon{text.rfind(':')};
+    if (colon == std::string::npos || colon == 0 || colon + 1 == text.length())
+    {
+        throw std::runtime_error("Expected host:port, got \"" + text + "\"");
+    }
+    return {text.substr(0, colon), std::stoi(text.substr(colon + 1))};
 }
 
 // === Function: Create and connect TCP socket to server ===
-int create_client_socket()
+int create_client_socket(const Endpoint &endpoint = {})
 {
     // Step 1: Create TCP socket (IPv4)
     int sock{socket(AF_INET, SOCK_STREAM, 0)};
@@ -49,20 +176,21 @@ int create_client_socket()
     // Step 2: Configure server address structure
     sockaddr_in server_address{};
     server_address.sin_family = AF_INET;   // IPv4
-    server_address.sin_port = htons(PORT); // Convert port to network byte order
+    server_address.sin_port = htons(endpoint.port); // Convert port to network byte order
 
     // Convert IP string ("127.0.0.1") to binary form for socket API
     // inet_pton returns 1 on success, 0 for invalid format, -1 on error
-    std::string ip{"127.0.0.1"};
-    int result = inet_pton(AF_INET, ip.c_str(), &server_address.sin_addr);
+    int result = inet_pton(AF_INET, endpoint.host.c_str(), &server_address.sin_addr);
     if (result <= 0)
     {
+        close(sock);
         throw std::runtime_error("Invalid or unsupported IP address");
     }
 
     // Step 3: Connect to the server
     if (connect(sock, reinterpret_cast<sockaddr *>(&server_address), sizeof(server_address)) < 0)
     {
+        close(sock);
         throw std::runtime_error("Connection failed");
     }
 
@@ -88,40 +216,1051 @@ std::string read_message(const int sock)
 // === Function: Send string message to socket ===
 void send_message(const int sock, const std::string &msg)
 {
-    send(sock, msg.c_str(), msg.length(), 0); // Standard POSIX send()
+    send(sock, msg.c_str(), msg.length(), MSG_NOSIGNAL); // A cancelled hedge may already be shut down
+}
+
+// === Function: Fetch SHA256 once (puzzles, SCRAM) ===
+const EVP_MD *sha256_md()
+{
+    using EvpMdPtr = std::unique_ptr<EVP_MD, decltype(&EVP_MD_free)>;
+    static const EvpMdPtr md{EVP_MD_fetch(nullptr, "SHA256", nullptr), &EVP_MD_free};
+    if (!md)
+    {
+        throw std::runtime_error("Failed to fetch SHA256 implementation");
+    }
+    return md.get();
+}
+
+// === Function: Solve a server puzzle ===
+// Finds an 8-byte nonce such that SHA256(seed || nonce) starts with
+// `difficulty` zero bits. The seed is hashed once; each attempt only copies
+// that midstate and hashes the nonce, and the zero-bit test looks at the
+// first four digest bytes as one word.
+std::string solve_puzzle(const std::string &seed, const unsigned int difficulty)
+{
+    using EvpMdCtxPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+
+    EvpMdCtxPtr base{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+    EvpMdCtxPtr attempt{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+    if (!base || !attempt || difficulty > 32 ||
+        !EVP_DigestInit_ex(base.get(), sha256_md(), nullptr) ||
+        !EVP_DigestUpdate(base.get(), seed.data(), seed.length()))
+    {
+        throw std::runtime_error("Cannot solve puzzle");
+    }
+
+    const uint32_t mask{difficulty == 0 ? 0u : ~0u << (32 - difficulty)};
+    unsigned char digest[EVP_MAX_MD_SIZE]{};
+    unsigned char nonce[8]{};
+    for (uint64_t counter{0};; ++counter)
+    {
+        for (size_t i{0}; i < sizeof(nonce); ++i)
+        {
+            nonce[i] = static_cast<unsigned char>(counter >> (8 * i));
+        }
+        if (!EVP_MD_CTX_copy_ex(attempt.get(), base.get()) ||
+            !EVP_DigestUpdate(attempt.get(), nonce, sizeof(nonce)) ||
+            !EVP_DigestFinal_ex(attempt.get(), digest, nullptr))
+        {
+            throw std::runtime_error("Cannot solve puzzle");
+        }
+
+        uint32_t prefix{(static_cast<uint32_t>(digest[0]) << 24) | (static_cast<uint32_t>(digest[1]) << 16) |
+                        (static_cast<uint32_t>(digest[2]) << 8) | digest[3]};
+        if ((prefix & mask) == 0)
+        {
+            return std::string(reinterpret_cast<char *>(nonce), sizeof(nonce));
+        }
+    }
+}
+
+// Owning pointers for Ed25519 keys and signing contexts
+using EvpPkeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+using EvpMdCtxPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+
+// === Function: Load our Ed25519 key, creating it on first use ===
+EvpPkeyPtr load_or_create_ed25519_key()
+{
+    if (FILE *file{fopen(ED25519_PRIVATE_KEY_FILE.c_str(), "r")})
+    {
+        // Like ssh, refuse a private key that other users could have copied
+        struct stat st{};
+        if (fstat(fileno(file), &st) < 0 || (st.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+        {
+            fclose(file);
+            throw std::runtime_error(ED25519_PRIVATE_KEY_FILE + " must not be accessible by group or others (chmod 600)");
+        }
+        EvpPkeyPtr key{PEM_read_PrivateKey(file, nullptr, nullptr, nullptr), &EVP_PKEY_free};
+        fclose(file);
+        if (!key)
+        {
+            throw std::runtime_error("Cannot parse " + ED25519_PRIVATE_KEY_FILE);
+        }
+        return key;
+    }
+
+    EvpPkeyPtr key{EVP_PKEY_Q_keygen(nullptr, nullptr, "ED25519"), &EVP_PKEY_free};
+    if (!key)
+    {
+        throw std::runtime_error("Ed25519 key generation failed");
+    }
+
+    // The private key is created owner-only, and never over an existing file
+    int private_fd{open(ED25519_PRIVATE_KEY_FILE.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0600)};
+    FILE *private_file{private_fd < 0 ? nullptr : fdopen(private_fd, "w")};
+    if (private_fd >= 0 && !private_file)
+    {
+        close(private_fd);
+    }
+    FILE *public_file{fopen(ED25519_PUBLIC_KEY_FILE.c_str(), "w")};
+    bool ok{private_file && public_file &&
+            PEM_write_PrivateKey(private_file, key.get(), nullptr, nullptr, 0, nullptr, nullptr) &&
+            PEM_write_PUBKEY(public_file, key.get())};
+    if (private_file && fclose(private_file) != 0)
+    {
+        ok = false;
+    }
+    if (public_file)
+    {
+        fclose(public_file);
+    }
+    if (!ok)
+    {
+        throw std::runtime_error("Cannot save Ed25519 key files");
+    }
+
+    std::cout << "Created " << ED25519_PRIVATE_KEY_FILE << "; provision the server with " << ED25519_PUBLIC_KEY_FILE << "\n";
+    return key;
+}
+
+// === Function: Sign the challenge with Ed25519 ===
+std::string sign_ed25519(const std::string &challenge, EVP_PKEY *key)
+{
+    EvpMdCtxPtr ctx{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+    unsigned char signature[64]{};
+    size_t signature_len{sizeof(signature)};
+    if (!ctx ||
+        !EVP_DigestSignInit(ctx.get(), nullptr, nullptr, nullptr, key) ||
+        !EVP_DigestSign(ctx.get(), signature, &signature_len,
+                        reinterpret_cast<const unsigned char *>(challenge.data()), challenge.length()))
+    {
+        throw std::runtime_error("Ed25519 signing failed");
+    }
+    return std::string(reinterpret_cast<char *>(signature), signature_len);
+}
+
+// === SCRAM mode ===
+// The server keeps only StoredKey/ServerKey derived from the password. The
+// client re-derives them from the password with PBKDF2, which is deliberately
+// slow, so derived keys are cached per (password, salt, iterations) for the life
+// of the process: only the first login against a given salt pays for PBKDF2.
+constexpr size_t SCRAM_SALT_SIZE{16};
+constexpr size_t SCRAM_CHALLENGE_SIZE{16};
+constexpr size_t SCRAM_KEY_SIZE{32}; // SHA-256
+
+// Iteration counts we accept from the server. The count arrives unauthenticated,
+// so a bogus or hostile server could otherwise make PBKDF2 run for minutes (or
+// hand it a count that overflows int).
+constexpr uint32_t SCRAM_MIN_ITERATIONS{4096};
+constexpr uint32_t SCRAM_MAX_ITERATIONS{1'000'000};
+
+struct ScramKeys
+{
+    std::string client_key{};
+    std::string stored_key{};
+    std::string server_key{};
+};
+
+// === Function: Fingerprint a password for the SCRAM cache ===
+// HMAC-SHA256 under a random key drawn once per process, so the cache holds
+// neither the password nor a hash of it that could be attacked offline.
+std::string password_fingerprint(const std::string &password)
+{
+    static const std::string pepper{[]
+                                    {
+                                        unsigned char bytes[SCRAM_KEY_SIZE]{};
+                                        if (!RAND_bytes(bytes, sizeof(bytes)))
+                                        {
+                                            throw std::runtime_error("RAND_bytes failed");
+                                        }
+                                        return std::string(reinterpret_cast<char *>(bytes), sizeof(bytes));
+                                    }()};
+    return compute_hmac(password, pepper, "SHA256");
+}
+
+// === Function: Derive SCRAM keys, or return the cached ones ===
+// Cached per (salt, iterations, password fingerprint).
+ScramKeys scram_keys(const std::string &password, const std::string &salt, const uint32_t iterations)
+{
+    static std::mutex cache_mutex{};
+    static std::map<std::tuple<std::string, uint32_t, std::string>, ScramKeys> cache{};
+
+    auto cache_key{std::make_tuple(salt, iterations, password_fingerprint(password))};
+    {
+        std::lock_guard<std::mutex> lock{cache_mutex};
+        if (auto hit{cache.find(cache_key)}; hit != cache.end())
+        {
+            return hit->second;
+        }
+    }
+
+    // Cache miss: run PBKDF2 outside the lock so other logins aren't held up
+    unsigned char salted[SCRAM_KEY_SIZE]{};
+    if (!PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.length()),
+                           reinterpret_cast<const unsigned char *>(salt.data()), static_cast<int>(salt.length()),
+                           static_cast<int>(iterations), sha256_md(), sizeof(salted), salted))
+    {
+        throw std::runtime_error("PBKDF2 failed");
+    }
+    std::string salted_password(reinterpret_cast<char *>(salted), sizeof(salted));
+    OPENSSL_cleanse(salted, sizeof(salted));
+
+    ScramKeys keys{};
+    keys.client_key = compute_hmac("Client Key", salted_password, "SHA256");
+    keys.server_key = compute_hmac("Server Key", salted_password, "SHA256");
+    OPENSSL_cleanse(salted_password.data(), salted_password.size());
+
+    unsigned char stored[SCRAM_KEY_SIZE]{};
+    if (!EVP_Digest(keys.client_key.data(), keys.client_key.length(), stored, nullptr, sha256_md(), nullptr))
+    {
+        throw std::runtime_error("SCRAM StoredKey derivation failed");
+    }
+    keys.stored_key.assign(reinterpret_cast<char *>(stored), sizeof(stored));
+
+    std::lock_guard<std::mutex> lock{cache_mutex};
+    cache.emplace(cache_key, keys);
+    return keys;
+}
+
+// === Function: Build the SCRAM client proof ===
+// Frame from the server: salt (16) | iterations (4, big endian) | challenge (16).
+// Returns the proof and fills `expected_server_signature`.
+std::string scram_proof(const std::string &frame, std::string &challenge, std::string &expected_server_signature)
+{
+    if (frame.length() != SCRAM_SALT_SIZE + 4 + SCRAM_CHALLENGE_SIZE)
+    {
+        throw std::runtime_error("Malformed SCRAM challenge");
+    }
+    std::string salt{frame.substr(0, SCRAM_SALT_SIZE)};
+    uint32_t iterations{0};
+    for (size_t i{0}; i < 4; ++i)
+    {
+        iterations = (iterations << 8) | static_cast<unsigned char>(frame[SCRAM_SALT_SIZE + i]);
+    }
+    if (iterations < SCRAM_MIN_ITERATIONS || iterations > SCRAM_MAX_ITERATIONS)
+    {
+        throw std::runtime_error("SCRAM iteration count " + std::to_string(iterations) + " out of range");
+    }
+    challenge = frame.substr(SCRAM_SALT_SIZE + 4);
+
+    ScramKeys keys{scram_keys(SHARED_SECRET, salt, iterations)};
+    std::string auth_message{USERNAME + "," + challenge};
+
+    // ClientProof = ClientKey XOR HMAC(StoredKey, AuthMessage)
+    std::string proof{compute_hmac(auth_message, keys.stored_key, "SHA256")};
+    for (size_t i{0}; i < proof.length(); ++i)
+    {
+        proof[i] ^= keys.client_key[i];
+    }
+
+    // The server proves itself with HMAC(ServerKey, AuthMessage), sent as hex
+    static constexpr char HEX[]{"0123456789abcdef"};
+    expected_server_signature.clear();
+    for (unsigned char b : compute_hmac(auth_message, keys.server_key, "SHA256"))
+    {
+        expected_server_signature += HEX[b >> 4];
+        expected_server_signature += HEX[b & 15];
+    }
+    return proof;
+}
+
+// How this client proves its identity
+enum class AuthMode
+{
+    Hmac,    // HMAC-SHA1 of the challenge with the shared secret (default)
+    Ed25519, // Ed25519 signature of the challenge
+    Scram,   // SCRAM-SHA-256 style salted proof
+};
+
+// Command-line options
+struct ClientOptions
+{
+    AuthMode mode{AuthMode::Hmac};
+    EvpPkeyPtr ed25519_key{nullptr, &EVP_PKEY_free};
+    uint32_t deadline_ms{0};          // --deadline-ms: give up after this long (0 = wait forever)
+    bool verbose{true};               // Print each step (off when running many requests)
+    std::vector<Endpoint> replicas{}; // --replica host:port[,host:port...] (repeatable)
+    size_t count{1};                  // --count: authentications to run
+    size_t concurrency{1};            // --concurrency: authentications in flight at once
+    double hedge_budget_percent{DEFAULT_HEDGE_BUDGET_PERCENT}; // --hedge-budget: max extra attempts, in percent
+};
+
+// === Function: Bound the next read by what is left of the deadline ===
+// Throws once the deadline has passed; a read that times out returns "".
+void wait_at_most_until(const int sock, std::chrono::steady_clock::time_point deadline)
+{
+    auto left{std::chrono::duration_cast<std::chrono::microseconds>(deadline - std::chrono::steady_clock::now())};
+    if (left.count() <= 0)
+    {
+        throw std::runtime_error("Deadline exceeded");
+    }
+    timeval timeout{static_cast<time_t>(left.count() / 1000000), static_cast<suseconds_t>(left.count() % 1000000)};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 }
 
 // === Function: Perform challenge-response protocol with server ===
-void client_interaction(const int sock)
+// Returns the server's verdict, or "" if the connection ended without one.
+std::string client_interaction(const int sock, const ClientOptions &options)
 {
-    // Step 1: Send initial hello to initiate conversation
-    send_message(sock, "hello");
+    // Step 1: Send initial hello (naming our account, mode and deadline) to initiate conversation
+    auto deadline{std::chrono::steady_clock::now() + std::chrono::milliseconds(options.deadline_ms)};
+    auto read_reply{[&]()
+                    {
+                        if (options.deadline_ms == 0)
+                        {
+                            return read_message(sock);
+                        }
+                        wait_at_most_until(sock, deadline);
+                        std::string reply{read_message(sock)};
+                        if (reply.empty() && std::chrono::steady_clock::now() >= deadline)
+                        {
+                            throw std::runtime_error("Deadline exceeded (no reply in " +
+                                                     std::to_string(options.deadline_ms) + " ms)");
+                        }
+                        return reply;
+                    }};
+    std::string mode_name{};
+    if (options.mode == AuthMode::Ed25519)
+    {
+        mode_name = " ed25519";
+    }
+    else if (options.mode == AuthMode::Scram)
+    {
+        mode_name = " scram";
+    }
+    std::string deadline_option{options.deadline_ms == 0 ? "" : " deadline=" + std::to_string(options.deadline_ms)};
+    const std::string &username{options.mode == AuthMode::Ed25519 ? ED25519_USERNAME : USERNAME};
+    send_message(sock, "hello " + username + mode_name + deadline_option);
 
     // Step 2: Receive challenge string from server
-    std::string challenge{read_message(sock)};
-    std::cout << "Received challenge: " << challenge << "\n";
+    std::string challenge{read_reply()};
 
-    // Step 3: Compute HMAC of challenge using shared secret
-    std::string digest{compute_hmac(challenge, SHARED_SECRET)};
+    // Step 2b: An overloaded server asks for proof of work first
+    if (challenge.length() == PUZZLE_TAG.length() + 1 + PUZZLE_SEED_SIZE &&
+        challenge.compare(0, PUZZLE_TAG.length(), PUZZLE_TAG) == 0)
+    {
+        auto difficulty{static_cast<unsigned char>(challenge[PUZZLE_TAG.length()])};
+        if (options.verbose)
+        {
+            std::cout << "Server is busy, solving puzzle of difficulty " << static_cast<int>(difficulty) << "\n";
+        }
+        send_message(sock, solve_puzzle(challenge.substr(PUZZLE_TAG.length() + 1), difficulty));
+        challenge = read_reply();
+    }
+
+    // Step 2c: The server gives up on sessions whose deadline has already passed
+    // (or whose puzzle solution it did not accept)
+    if (challenge == DEADLINE_EXCEEDED || challenge == PUZZLE_NOT_SOLVED || challenge.empty())
+    {
+        if (options.verbose)
+        {
+            std::cout << "Server: " << challenge << "\n";
+        }
+        return challenge;
+    }
+
+    // Step 3: Prove we hold the credential: HMAC with the shared secret, a signature or a SCRAM proof
+    std::string proof{};
+    std::string expected_server_signature{};
+    if (options.mode == AuthMode::Scram)
+    {
+        std::string frame{challenge};
+        proof = scram_proof(frame, challenge, expected_server_signature);
+    }
+    else if (options.mode == AuthMode::Ed25519)
+    {
+        proof = sign_ed25519(challenge, options.ed25519_key.get());
+    }
+    else
+    {
+        proof = compute_hmac(challenge, SHARED_SECRET);
+    }
+    if (options.verbose)
+    {
+        std::cout << "Received challenge: " << challenge << "\n";
+    }
 
-    // Step 4: Send computed digest back to server
-    send_message(sock, digest);
+    // Step 4: Send the proof back to server
+    send_message(sock, proof);
 
     // Step 5: Receive authentication result (success or failure)
-    std::string response{read_message(sock)};
-    std::cout << "Server: " << response << "\n";
+    std::string response{read_reply()};
+    if (options.verbose)
+    {
+        std::cout << "Server: " << response << "\n";
+    }
+
+    // Step 6 (SCRAM): make sure the server knew our verifier too; a server that
+    // can't prove it is not the one we enrolled with, so its "success" doesn't count
+    if (options.mode == AuthMode::Scram && response.rfind(AUTH_SUCCESS_PREFIX, 0) == 0)
+    {
+        size_t v{response.find(" v=")};
+        std::string server_signature{v == std::string::npos ? std::string{} : response.substr(v + 3)};
+        bool server_ok{server_signature.length() == expected_server_signature.length() &&
+                       CRYPTO_memcmp(server_signature.data(), expected_server_signature.data(), server_signature.length()) == 0};
+        if (!server_ok)
+        {
+            throw std::runtime_error("Server signature mismatch");
+        }
+        if (options.verbose)
+        {
+            std::cout << "Server signature verified.\n";
+        }
+    }
+    return response;
+}
+
+// === Load balancing ===
+// Each authentication goes to the cheaper of two replicas picked at random
+// ("power of two choices"), where cost is the latency EWMA scaled by the
+// attempts already in flight there. Two random choices avoid both the herd
+// that always picking the best replica causes and the blindness of round
+// robin. Replicas that keep failing or turn slow are ejected for a while.
+
+// How an attempt on a replica ended
+enum class AttemptOutcome
+{
+    Verdict,   // The server answered
+    Failed,    // Connection failed, timed out or ended without a verdict
+    Cancelled, // Lost a hedge race; counts as "at least this slow"
+};
+
+class LoadBalancer
+{
+public:
+    explicit LoadBalancer(const std::vector<Endpoint> &replicas) : replicas_(replicas.size()), endpoints_{replicas} {}
+
+    // Choose a replica for the next attempt, other than `exclude` if possible
+    size_t pick(const size_t exclude = SIZE_MAX)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        auto now{std::chrono::steady_clock::now()};
+
+        // Step 1: Readmit replicas whose ejection has run out. They start with
+        // no latency history so they get traffic and are measured again.
+        std::vector<size_t> candidates{};
+        for (size_t i{0}; i < replicas_.size(); ++i)
+        {
+            Replica &replica{replicas_[i]};
+            if (replica.ejected && now >= replica.ejected_until)
+            {
+                replica.ejected = false;
+                replica.ewma_us = 0;
+                replica.samples = 0;
+                replica.failures = 0;
+            }
+            if (!replica.ejected && i != exclude)
+            {
+                candidates.push_back(i);
+            }
+        }
+
+        // Step 2: Everything else ejected: fail open rather than fail the request
+        if (candidates.empty())
+        {
+            for (size_t i{0}; i < replicas_.size(); ++i)
+            {
+                if (i != exclude)
+                {
+                    candidates.push_back(i);
+                }
+            }
+        }
+        if (candidates.empty())
+        {
+            return exclude; // Only one replica
+        }
+
+        // Step 3: Power of two choices
+        size_t chosen{candidates[0]};
+        if (candidates.size() > 1)
+        {
+            std::uniform_int_distribution<size_t> first_of(0, candidates.size() - 1);
+            std::uniform_int_distribution<size_t> second_of(0, candidates.size() - 2);
+            size_t a{first_of(random_)};
+            size_t b{second_of(random_)};
+            b += b >= a;
+            chosen = cost(candidates[a]) <= cost(candidates[b]) ? candidates[a] : candidates[b];
+        }
+        ++replicas_[chosen].picks;
+        return chosen;
+    }
+
+    // An attempt on `index` is starting
+    void begin(const size_t index)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        ++replicas_[index].in_flight;
+    }
+
+    // An attempt on `index` ended after `latency`
+    void end(const size_t index, const AttemptOutcome outcome, const std::chrono::microseconds latency)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        Replica &replica{replicas_[index]};
+        --replica.in_flight;
+        if (outcome == AttemptOutcome::Failed)
+        {
+            ++replica.failed;
+            replica.successes = 0;
+            if (++replica.failures >= EJECT_AFTER_FAILURES)
+            {
+                eject(replica);
+            }
+            return;
+        }
+
+        double sample{static_cast<double>(latency.count())};
+        replica.ewma_us = replica.samples == 0 ? sample : replica.ewma_us + BALANCER_EWMA_WEIGHT * (sample - replica.ewma_us);
+        ++replica.samples;
+        if (outcome == AttemptOutcome::Verdict)
+        {
+            replica.failures = 0;
+            if (++replica.successes >= EJECT_RESET_SUCCESSES)
+            {
+                replica.ejections = 0;
+            }
+        }
+        if (is_slow_outlier(index))
+        {
+            eject(replica);
+        }
+    }
+
+    // One line per replica: traffic, latency and ejection state
+    std::string report()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        std::ostringstream out{};
+        out << std::fixed << std::setprecision(2);
+        auto now{std::chrono::steady_clock::now()};
+        for (size_t i{0}; i < replicas_.size(); ++i)
+        {
+            const Replica &replica{replicas_[i]};
+            out << "replica " << endpoints_[i].host << ":" << endpoints_[i].port << " picks=" << replica.picks
+                << " failed=" << replica.failed << " ewma_ms=" << replica.ewma_us / 1000.0
+                << " ejected_times=" << replica.times_ejected;
+            if (replica.ejected && now < replica.ejected_until)
+            {
+                out << " ejected_for_ms="
+                    << std::chrono::duration_cast<std::chrono::milliseconds>(replica.ejected_until - now).count();
+            }
+            out << "\n";
+        }
+        return out.str();
+    }
+
+private:
+    struct Replica
+    {
+        size_t in_flight{0};
+        double ewma_us{0}; // 0 until measured
+        size_t samples{0};
+        size_t failures{0};  // In a row
+        size_t successes{0}; // In a row
+        size_t ejections{0}; // In a row, for the backoff
+        bool ejected{false};
+        std::chrono::steady_clock::time_point ejected_until{};
+        size_t picks{0};
+        size_t failed{0};
+        size_t times_ejected{0};
+    };
+
+    double cost(const size_t index) const
+    {
+        const Replica &replica{replicas_[index]};
+        return (replica.ewma_us + 1.0) * static_cast<double>(replica.in_flight + 1);
+    }
+
+    // Slow compared with the median of the other replicas in rotation
+    bool is_slow_outlier(const size_t index) const
+    {
+        const Replica &replica{replicas_[index]};
+        if (replica.ejected || replica.samples < EJECT_MIN_SAMPLES ||
+            replica.ewma_us < static_cast<double>(EJECT_SLOW_MIN_LATENCY.count()))
+        {
+            return false;
+        }
+        std::vector<double> others{};
+        for (size_t i{0}; i < replicas_.size(); ++i)
+        {
+            if (i != index && !replicas_[i].ejected && replicas_[i].samples > 0)
+            {
+                others.push_back(replicas_[i].ewma_us);
+            }
+        }
+        if (others.empty())
+        {
+            return false;
+        }
+        std::nth_element(others.begin(), others.begin() + static_cast<std::ptrdiff_t>(others.size() / 2), others.end());
+        return replica.ewma_us > EJECT_SLOW_FACTOR * others[others.size() / 2];
+    }
+
+    // Take a replica out of rotation, unless too many already are
+    void eject(Replica &replica)
+    {
+        size_t ejected{0};
+        for (const Replica &other : replicas_)
+        {
+            ejected += other.ejected;
+        }
+        if (replica.ejected ||
+            static_cast<double>(ejected + 1) > MAX_EJECTED_FRACTION * static_cast<double>(replicas_.size()))
+        {
+            return;
+        }
+        auto backoff{std::min<std::chrono::milliseconds>(EJECT_BASE_BACKOFF * (1 << std::min<size_t>(replica.ejections, 16)),
+                                                         EJECT_MAX_BACKOFF)};
+        replica.ejected = true;
+        replica.ejected_until = std::chrono::steady_clock::now() + backoff;
+        ++replica.ejections;
+        ++replica.times_ejected;
+        replica.successes = 0;
+    }
+
+    std::mutex mutex_{};
+    std::vector<Replica> replicas_{};
+    std::vector<Endpoint> endpoints_{};
+    std::mt19937 random_{std::random_device{}()};
+};
+
+// === Hedged requests ===
+// With several replicas, one slow server sets the client's tail latency. Each
+// authentication starts on one replica; if no verdict arrives within the
+// hedge delay (HEDGE_PERCENTILE of recent attempt latencies), a second attempt
+// starts on another replica. The first verdict wins and the other attempt is
+// cancelled by shutting down its socket. Every attempt feeds the percentile:
+// one that was cancelled or failed contributes the time it ran without a
+// verdict, a lower bound on its latency. Recording only winners would leave
+// out exactly the slow attempts, and the delay would keep shrinking. A token budget keeps hedges under
+// --hedge-budget percent of requests, so a slow fleet is not hit twice as hard.
+
+// Adapts the hedge delay and enforces the hedge budget (shared by --concurrency threads)
+class HedgePolicy
+{
+public:
+    explicit HedgePolicy(const double budget_percent) : budget_percent_{budget_percent} {}
+
+    // How long to wait for the first attempt before hedging
+    std::chrono::microseconds delay() const
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (history_.size() < HEDGE_MIN_SAMPLES)
+        {
+            return HEDGE_INITIAL_DELAY;
+        }
+        std::vector<std::chrono::microseconds> sorted{history_};
+        auto rank{sorted.begin() + static_cast<std::ptrdiff_t>(HEDGE_PERCENTILE * static_cast<double>(sorted.size() - 1))};
+        std::nth_element(sorted.begin(), rank, sorted.end());
+        return std::max(*rank, HEDGE_MIN_DELAY);
+    }
+
+    // Record how long an attempt took, or ran before it was cancelled or failed
+    void record(const std::chrono::microseconds latency)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (history_.size() < HEDGE_HISTORY)
+        {
+            history_.push_back(latency);
+        }
+        else
+        {
+            history_[next_++ % HEDGE_HISTORY] = latency;
+        }
+    }
+
+    // Every request earns budget_percent / 100 of a hedge
+    void note_request()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        tokens_ = std::min(tokens_ + budget_percent_ / 100.0, HEDGE_BUDGET_BURST);
+    }
+
+    // Spend one hedge if the budget allows it
+    bool try_hedge()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        if (tokens_ < 1.0)
+        {
+            ++hedges_denied;
+            return false;
+        }
+        tokens_ -= 1.0;
+        ++hedges;
+        return true;
+    }
+
+    // Read once all requests are done
+    size_t hedges{0};
+    size_t hedges_denied{0};
+
+private:
+    mutable std::mutex mutex_{};
+    double budget_percent_{0};
+    double tokens_{1.0}; // Allow one hedge before any budget has been earned
+    std::vector<std::chrono::microseconds> history_{};
+    size_t next_{0};
+};
+
+// === Function: Is this reply an authentication verdict? ===
+// Only a verdict settles a hedge race. Anything else ("Deadline exceeded.",
+// "Puzzle not solved.", a dropped connection) is a failed attempt.
+bool is_verdict(const std::string &reply)
+{
+    return reply.rfind(AUTH_SUCCESS_PREFIX, 0) == 0 || reply == AUTH_FAILURE;
+}
+
+// Shared state of one authentication's attempts; owned jointly by the
+// attempts and the caller, since a losing attempt may outlive the call
+struct HedgeRace
+{
+    std::mutex mutex{};
+    std::condition_variable settled{};
+    int sockets[2]{-1, -1}; // Open attempt sockets, so the loser can be cancelled
+    bool cancelled[2]{};    // Shut down while still running
+    std::chrono::steady_clock::time_point cancelled_at[2]{};
+    size_t started{0};
+    size_t finished{0};
+    bool decided{false};
+    size_t winner{0};
+    std::string verdict{};
+    std::string error{};
+};
+
+// What one hedged authentication ended with
+struct HedgeResult
+{
+    bool answered{false};
+    size_t winner{0}; // 1 if the hedge won
+    std::string verdict{};
+    std::string error{};
+};
+
+// Losing attempts that are still winding down. shutdown() cannot interrupt
+// one blocked in connect() or solving a puzzle, so instead of making the
+// caller wait for them they are parked here and joined later.
+class Stragglers
+{
+public:
+    void adopt(std::shared_ptr<HedgeRace> race, std::vector<std::thread> &threads)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+
+        // Join any earlier stragglers that have finished since
+        for (auto it{stragglers_.begin()}; it != stragglers_.end();)
+        {
+            bool done{false};
+            {
+                std::lock_guard<std::mutex> race_lock{it->race->mutex};
+                done = it->race->finished == it->race->started;
+            }
+            if (done)
+            {
+                it->thread.join();
+                it = stragglers_.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+        for (std::thread &thread : threads)
+        {
+            stragglers_.push_back({race, std::move(thread)});
+        }
+    }
+
+    void join_all()
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        for (Straggler &straggler : stragglers_)
+        {
+            straggler.thread.join();
+        }
+        stragglers_.clear();
+    }
+
+private:
+    struct Straggler
+    {
+        std::shared_ptr<HedgeRace> race{};
+        std::thread thread{};
+    };
+
+    std::mutex mutex_{};
+    std::vector<Straggler> stragglers_{};
+};
+
+// === Function: Run one attempt of a hedged authentication ===
+void run_attempt(const std::shared_ptr<HedgeRace> race, const size_t index, HedgePolicy &policy, LoadBalancer &balancer,
+                 const size_t replica, const ClientOptions &options)
+{
+    const Endpoint &endpoint{options.replicas[replica]};
+    balancer.begin(replica);
+    auto begin{std::chrono::steady_clock::now()};
+    int sock{-1};
+    std::string reply{};
+    std::string error{};
+    try
+    {
+        sock = create_client_socket(endpoint);
+        {
+            std::lock_guard<std::mutex> lock{race->mutex};
+            race->sockets[index] = sock;
+            if (race->decided)
+            {
+                shutdown(sock, SHUT_RDWR); // Lost before it connected
+                race->cancelled[index] = true;
+                race->cancelled_at[index] = std::chrono::steady_clock::now();
+            }
+        }
+        reply = client_interaction(sock, options);
+        if (!is_verdict(reply))
+        {
+            error = endpoint.host + ":" + std::to_string(endpoint.port) + ": " +
+                    (reply.empty() ? std::string{"no verdict"} : "\"" + reply + "\"");
+        }
+    }
+    catch (const std::exception &e)
+    {
+        error = endpoint.host + ":" + std::to_string(endpoint.port) + ": " + e.what();
+    }
+    bool verdict{error.empty()};
+
+    // Close under the lock so a cancel never shuts down a reused descriptor
+    auto latency{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - begin)};
+    std::lock_guard<std::mutex> lock{race->mutex};
+    if (sock >= 0)
+    {
+        race->sockets[index] = -1;
+        close(sock);
+    }
+    // A failure after the race was decided is still a failure (e.g. connection
+    // refused) unless it was this attempt that got shut down
+    AttemptOutcome outcome{verdict ? AttemptOutcome::Verdict : AttemptOutcome::Failed};
+    if (!verdict && race->cancelled[index])
+    {
+        outcome = AttemptOutcome::Cancelled;
+    }
+    balancer.end(replica, outcome, latency);
+
+    // A cancelled attempt's wind-down isn't latency: it counts up to the cancel
+    if (outcome == AttemptOutcome::Cancelled)
+    {
+        latency = std::chrono::duration_cast<std::chrono::microseconds>(race->cancelled_at[index] - begin);
+    }
+    policy.record(latency);
+    if (!race->decided && verdict)
+    {
+        race->decided = true;
+        race->winner = index;
+        race->verdict = reply;
+    }
+    else if (race->error.empty())
+    {
+        race->error = error;
+    }
+    ++race->finished;
+    race->settled.notify_all();
+}
+
+// === Function: Authenticate once, hedging to a second replica if slow ===
+// Returns as soon as one attempt has a verdict (or all have failed); a losing
+// attempt still running is cancelled and handed to `stragglers`.
+HedgeResult hedged_authenticate(const ClientOptions &options, HedgePolicy &policy, LoadBalancer &balancer,
+                                Stragglers &stragglers)
+{
+    auto race{std::make_shared<HedgeRace>()};
+    size_t primary{balancer.pick()};
+    policy.note_request();
+
+    // Step 1: Start on the balancer's choice and give it the hedge delay
+    std::vector<std::thread> attempts{};
+    std::unique_lock<std::mutex> lock{race->mutex};
+    attempts.emplace_back(run_attempt, race, 0, std::ref(policy), std::ref(balancer), primary, std::cref(options));
+    race->started = 1;
+    race->settled.wait_for(lock, policy.delay(), [&]
+                           { return race->finished == race->started; });
+
+    // Step 2: Still waiting, or failed without a verdict: hedge to another
+    // replica if the budget allows
+    if (!race->decided && options.replicas.size() > 1 && policy.try_hedge())
+    {
+        attempts.emplace_back(run_attempt, race, 1, std::ref(policy), std::ref(balancer), balancer.pick(primary),
+                              std::cref(options));
+        race->started = 2;
+    }
+
+    // Step 3: The first verdict wins; cancel whatever is still running
+    race->settled.wait(lock, [&]
+                       { return race->decided || race->finished == race->started; });
+    for (size_t i{0}; i < race->started; ++i)
+    {
+        if (race->sockets[i] >= 0)
+        {
+            shutdown(race->sockets[i], SHUT_RDWR);
+            race->cancelled[i] = true;
+            race->cancelled_at[i] = std::chrono::steady_clock::now();
+        }
+    }
+    HedgeResult result{race->decided, race->winner, race->verdict, race->error};
+    lock.unlock();
+    stragglers.adopt(race, attempts);
+    return result;
+}
+
+// === Function: Run --count authentications against the replicas ===
+// --concurrency threads share the requests, the hedge policy and the balancer.
+void run_replicated(const ClientOptions &options)
+{
+    HedgePolicy policy{options.hedge_budget_percent};
+    LoadBalancer balancer{options.replicas};
+    Stragglers stragglers{};
+    std::atomic<size_t> next_request{0};
+    std::mutex results_mutex{};
+    std::vector<double> latencies_ms{};
+    size_t failed{0};
+    size_t hedge_wins{0};
+    auto run_requests{[&]()
+                      {
+                          while (next_request.fetch_add(1) < options.count)
+                          {
+                              auto begin{std::chrono::steady_clock::now()};
+                              HedgeResult race{hedged_authenticate(options, policy, balancer, stragglers)};
+                              double latency_ms{std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count()};
+
+                              std::lock_guard<std::mutex> lock{results_mutex};
+                              if (!race.answered)
+                              {
+                                  ++failed;
+                                  std::cerr << "Client error: " << race.error << "\n";
+                                  continue;
+                              }
+                              latencies_ms.push_back(latency_ms);
+                              hedge_wins += race.winner == 1;
+                              if (options.count == 1)
+                              {
+                                  std::cout << "Server: " << race.verdict << (race.winner == 1 ? " (hedged)" : "") << "\n";
+                              }
+                          }
+                      }};
+    std::vector<std::thread> clients{};
+    for (size_t i{0}; i < std::max<size_t>(options.concurrency, 1); ++i)
+    {
+        clients.emplace_back(run_requests);
+    }
+    for (std::thread &client : clients)
+    {
+        client.join();
+    }
+    stragglers.join_all();
+
+    // Summary: end-to-end latency per authentication and what hedging cost
+    std::sort(latencies_ms.begin(), latencies_ms.end());
+    auto at{[&](double fraction)
+            { return latencies_ms.empty() ? 0.0 : latencies_ms[static_cast<size_t>(fraction * static_cast<double>(latencies_ms.size() - 1))]; }};
+    std::cout << std::fixed << std::setprecision(2) << "requests=" << options.count << " verdicts=" << latencies_ms.size()
+              << " failed=" << failed << " p50_ms=" << at(0.5) << " p99_ms=" << at(0.99) << " max_ms=" << at(1.0)
+              << " hedges=" << policy.hedges << " hedge_wins=" << hedge_wins << " hedges_over_budget=" << policy.hedges_denied
+              << " hedge_delay_ms=" << static_cast<double>(policy.delay().count()) / 1000.0 << "\n"
+              << balancer.report();
+}
+
+// === Function: Parse command-line options ===
+ClientOptions parse_options(int argc, char *argv[])
+{
+    ClientOptions options{};
+    for (int i{1}; i < argc; ++i)
+    {
+        std::string arg{argv[i]};
+        if (arg == "--ed25519")
+        {
+            options.mode = AuthMode::Ed25519;
+            options.ed25519_key = load_or_create_ed25519_key();
+        }
+        else if (arg == "--scram")
+        {
+            options.mode = AuthMode::Scram;
+        }
+        else if (arg == "--deadline-ms" && i + 1 < argc)
+        {
+            options.deadline_ms = static_cast<uint32_t>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--replica" && i + 1 < argc)
+        {
+            // One endpoint, or a comma-separated list
+            std::string list{argv[++i]};
+            for (size_t start{0}; start <= list.length();)
+            {
+                size_t comma{std::min(list.find(',', start), list.length())};
+                options.replicas.push_back(parse_endpoint(list.substr(start, comma - start)));
+                start = comma + 1;
+            }
+        }
+        else if (arg == "--count" && i + 1 < argc)
+        {
+            options.count = std::stoul(argv[++i]);
+        }
+        else if (arg == "--concurrency" && i + 1 < argc)
+        {
+            options.concurrency = std::stoul(argv[++i]);
+        }
+        else if (arg == "--hedge-budget" && i + 1 < argc)
+        {
+            options.hedge_budget_percent = std::stod(argv[++i]);
+        }
+        else
+        {
+            throw std::runtime_error("Usage: client2 [--ed25519 | --scram] [--deadline-ms <ms>] "
+                                     "[--replica <host:port>[,<host:port>...]]... [--count <n>] "
+                                     "[--concurrency <n>] [--hedge-budget <percent>]");
+        }
+    }
+
+    // Several requests or replicas: hedge, and print a summary instead of each step
+    if (!options.replicas.empty() || options.count > 1 || options.concurrency > 1)
+    {
+        options.verbose = false;
+        if (options.replicas.empty())
+        {
+            options.replicas.push_back({});
+        }
+    }
+    return options;
 }
 
 // === Main Entry Point ===
-int main()
+// Usage: ./client2 [--ed25519 | --scram] [--deadline-ms <ms>]
+//                  [--replica <host:port>[,<host:port>...]]... [--count <n>]
+//                  [--concurrency <n>] [--hedge-budget <percent>]
+int main(int argc, char *argv[])
 {
     try
     {
+        // Pick the authentication mode
+        ClientOptions options{parse_options(argc, argv)};
+        if (!options.replicas.empty())
+        {
+            run_replicated(options);
+            return 0;
+        }
+
         // Connect to the server
         int sock{create_client_socket()};
 
         // Run the client-side interaction
-        client_interaction(sock);
+        client_interaction(sock, options);
 
         // Cleanly close the socket
         close(sock);
@@ -0,0 +1,701 @@
+#pragma once
+
+// === Batched Ed25519 verification ===
+// Checks many Ed25519 signatures with one multi-scalar multiplication instead of
+// one double-scalar multiplication each. For signatures (R_i, s_i) by keys A_i
+// over messages M_i, with h_i = SHA512(R_i || A_i || M_i) mod L and random
+// 128-bit z_i, the whole batch is valid (up to a 2^-128 chance) iff
+//
+//     [8]( -[sum z_i s_i] B + sum [z_i] R_i + sum [z_i h_i] A_i ) == identity
+//
+// The 252 doublings of the multiplication are shared by the whole batch and the
+// R_i scalars are only 128 bits long, which is where the saving comes from.
+//
+// Why batch and single verdicts can't disagree
+// --------------------------------------------
+// RFC 8032 (5.1.7) allows two single checks: the cofactored
+// [8][s]B == [8]R + [8][h]A, and the cofactorless [s]B == R + [h]A. They
+// differ only when R or A has a small-order (torsion) component, e.g.
+// A = aB + T with [8]T = 0. The key's owner can build such signatures, and
+// the cofactored check accepts them while the cofactorless one (OpenSSL's)
+// may not.
+//
+// A batch has to be cofactored. Without the [8], the random z_i scale each
+// torsion component differently and no longer cancel, so the batch verdict
+// would depend on the z_i drawn. So every verdict here, batched or single,
+// comes from the same cofactored equation, evaluated by equation_holds().
+// verify_single() is that equation for one signature with z = 1.
+//
+// Let P_i = [8](R_i + [h_i]A_i - [s_i]B). Multiplying by 8 removes the
+// torsion, so P_i lies in the prime-order subgroup, and P_i is the identity
+// exactly when signature i passes verify_single(). The batch checks
+// sum [z_i]P_i == identity:
+//   - If every P_i is the identity, so is the sum, whatever the z_i. A batch
+//     of individually valid signatures never fails.
+//   - If some P_j is not, P_j generates the subgroup. For any fixed other
+//     terms, exactly one z_j mod L cancels the sum, so a random 128-bit z_j
+//     hits it with probability at most 2^-128.
+// When the batch fails, each signature is re-checked with verify_single(), so
+// the verdicts are exactly the single ones and a forged signature never fails
+// its neighbours.
+//
+// verify_one() is OpenSSL's cofactorless check. It is kept as a reference for
+// tests and benchmarks and makes no server verdicts. Public keys of small
+// order (eight encodings, for which anyone can forge) are refused at parse
+// time. Non-canonical encodings of R or A (y >= p, or x = 0 with the sign bit
+// set) and s >= L are rejected, as RFC 8032 requires.
+//
+// Usage:
+//
+//     auto key{ed25519_batch::parse_public_key(raw_32_bytes)};   // once, at load
+//     std::vector<ed25519_batch::Item> items{{&message, &signature, &*key}, ...};
+//     std::vector<char> valid{ed25519_batch::verify_batch(items)};
+//
+// Needs unsigned __int128 (GCC/Clang on 64-bit targets). Link with -lcrypto.
+
+#include <string>             // For std::string
+#include <cstdint>            // For uint64_t, int8_t
+#include <cstring>            // For std::memcmp(), std::memcpy()
+#include <array>              // For std::array (points, digits, tables)
+#include <vector>             // For std::vector (batches)
+#include <memory>             // For std::unique_ptr (OpenSSL object ownership)
+#include <optional>           // For std::optional (key parsing)
+#include <stdexcept>          // For std::runtime_error
+#include <openssl/evp.h>      // For EVP_DigestVerify() and SHA-512
+#include <openssl/bn.h>       // For BIGNUM – scalar arithmetic mod L
+#include <openssl/rand.h>     // For RAND_bytes() – the batch's random z_i
+
+namespace ed25519_batch
+{
+    constexpr size_t KEY_SIZE{32};
+    constexpr size_t SIGNATURE_SIZE{64};
+
+    using EvpPkeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+    using EvpMdPtr = std::unique_ptr<EVP_MD, decltype(&EVP_MD_free)>;
+    using EvpMdCtxPtr = std::unique_ptr<EVP_MD_CTX, decltype(&EVP_MD_CTX_free)>;
+    using BnPtr = std::unique_ptr<BIGNUM, decltype(&BN_free)>;
+    using BnCtxPtr = std::unique_ptr<BN_CTX, decltype(&BN_CTX_free)>;
+
+    // === Field arithmetic mod p = 2^255 - 19 ===
+    // Five 51-bit limbs. add/sub/mul/sq return limbs below 2^52, which every
+    // operation accepts as input.
+    struct Fe
+    {
+        uint64_t v[5]{};
+    };
+
+    using u128 = unsigned __int128;
+    constexpr uint64_t MASK51{(uint64_t{1} << 51) - 1};
+
+    inline Fe fe_from_u64(uint64_t n)
+    {
+        Fe f{};
+        f.v[0] = n & MASK51;
+        f.v[1] = n >> 51;
+        return f;
+    }
+
+    inline Fe fe_carry(Fe f)
+    {
+        uint64_t c{};
+        c = f.v[0] >> 51, f.v[0] &= MASK51, f.v[1] += c;
+        c = f.v[1] >> 51, f.v[1] &= MASK51, f.v[2] += c;
+        c = f.v[2] >> 51, f.v[2] &= MASK51, f.v[3] += c;
+        c = f.v[3] >> 51, f.v[3] &= MASK51, f.v[4] += c;
+        c = f.v[4] >> 51, f.v[4] &= MASK51, f.v[0] += 19 * c;
+        return f;
+    }
+
+    inline Fe fe_add(const Fe &f, const Fe &g)
+    {
+        Fe h{};
+        for (int i{0}; i < 5; ++i)
+        {
+            h.v[i] = f.v[i] + g.v[i];
+        }
+        return fe_carry(h);
+    }
+
+    // f + 4p - g, so limbs never go negative for inputs below 2^53
+    inline Fe fe_sub(const Fe &f, const Fe &g)
+    {
+        Fe h{};
+        h.v[0] = f.v[0] + 0x1FFFFFFFFFFFB4 - g.v[0];
+        for (int i{1}; i < 5; ++i)
+        {
+            h.v[i] = f.v[i] + 0x1FFFFFFFFFFFFC - g.v[i];
+        }
+        return fe_carry(h);
+    }
+
+    inline Fe fe_neg(const Fe &f)
+    {
+        return fe_sub(Fe{}, f);
+    }
+
+    // Folds the five 128-bit column sums back into limbs
+    inline Fe fe_reduce(u128 r0, u128 r1, u128 r2, u128 r3, u128 r4)
+    {
+        Fe h{};
+        r1 += r0 >> 51, h.v[0] = static_cast<uint64_t>(r0) & MASK51;
+        r2 += r1 >> 51, h.v[1] = static_cast<uint64_t>(r1) & MASK51;
+        r3 += r2 >> 51, h.v[2] = static_cast<uint64_t>(r2) & MASK51;
+        r4 += r3 >> 51, h.v[3] = static_cast<uint64_t>(r3) & MASK51;
+        h.v[4] = static_cast<uint64_t>(r4) & MASK51;
+        u128 low{static_cast<u128>(h.v[0]) + (r4 >> 51) * 19};
+        h.v[0] = static_cast<uint64_t>(low) & MASK51;
+        h.v[1] += static_cast<uint64_t>(low >> 51);
+        return h;
+    }
+
+    inline Fe fe_mul(const Fe &f, const Fe &g)
+    {
+        const uint64_t f0{f.v[0]}, f1{f.v[1]}, f2{f.v[2]}, f3{f.v[3]}, f4{f.v[4]};
+        const uint64_t g0{g.v[0]}, g1{g.v[1]}, g2{g.v[2]}, g3{g.v[3]}, g4{g.v[4]};
+        const uint64_t g1_19{19 * g1}, g2_19{19 * g2}, g3_19{19 * g3}, g4_19{19 * g4};
+        u128 r0{(u128)f0 * g0 + (u128)f1 * g4_19 + (u128)f2 * g3_19 + (u128)f3 * g2_19 + (u128)f4 * g1_19};
+        u128 r1{(u128)f0 * g1 + (u128)f1 * g0 + (u128)f2 * g4_19 + (u128)f3 * g3_19 + (u128)f4 * g2_19};
+        u128 r2{(u128)f0 * g2 + (u128)f1 * g1 + (u128)f2 * g0 + (u128)f3 * g4_19 + (u128)f4 * g3_19};
+        u128 r3{(u128)f0 * g3 + (u128)f1 * g2 + (u128)f2 * g1 + (u128)f3 * g0 + (u128)f4 * g4_19};
+        u128 r4{(u128)f0 * g4 + (u128)f1 * g3 + (u128)f2 * g2 + (u128)f3 * g1 + (u128)f4 * g0};
+        return fe_reduce(r0, r1, r2, r3, r4);
+    }
+
+    inline Fe fe_sq(const Fe &f)
+    {
+        const uint64_t f0{f.v[0]}, f1{f.v[1]}, f2{f.v[2]}, f3{f.v[3]}, f4{f.v[4]};
+        const uint64_t f0_2{2 * f0}, f1_2{2 * f1}, f3_19{19 * f3}, f4_19{19 * f4};
+        u128 r0{(u128)f0 * f0 + (u128)f1_2 * f4_19 + (u128)(2 * f2) * f3_19};
+        u128 r1{(u128)f0_2 * f1 + (u128)(2 * f2) * f4_19 + (u128)f3 * f3_19};
+        u128 r2{(u128)f0_2 * f2 + (u128)f1 * f1 + (u128)(2 * f3) * f4_19};
+        u128 r3{(u128)f0_2 * f3 + (u128)f1_2 * f2 + (u128)f4 * f4_19};
+        u128 r4{(u128)f0_2 * f4 + (u128)f1_2 * f3 + (u128)f2 * f2};
+        return fe_reduce(r0, r1, r2, r3, r4);
+    }
+
+    inline Fe fe_sq_n(Fe f, int n)
+    {
+        while (n-- > 0)
+        {
+            f = fe_sq(f);
+        }
+        return f;
+    }
+
+    // Reads 255 bits, little endian; the top bit (the x sign in a point) is ignored
+    inline Fe fe_from_bytes(const unsigned char *s)
+    {
+        uint64_t w[4]{};
+        std::memcpy(w, s, 32); // Little-endian host assumed, as everywhere else in the server
+        Fe f{};
+        f.v[0] = w[0] & MASK51;
+        f.v[1] = ((w[0] >> 51) | (w[1] << 13)) & MASK51;
+        f.v[2] = ((w[1] >> 38) | (w[2] << 26)) & MASK51;
+        f.v[3] = ((w[2] >> 25) | (w[3] << 39)) & MASK51;
+        f.v[4] = (w[3] >> 12) & MASK51;
+        return f;
+    }
+
+    // Canonical (fully reduced) little-endian encoding
+    inline std::array<unsigned char, 32> fe_to_bytes(const Fe &input)
+    {
+        Fe f{fe_carry(fe_carry(input))};
+        uint64_t q{(f.v[0] + 19) >> 51};
+        q = (f.v[1] + q) >> 51;
+        q = (f.v[2] + q) >> 51;
+        q = (f.v[3] + q) >> 51;
+        q = (f.v[4] + q) >> 51; // 1 iff f >= p
+        f.v[0] += 19 * q;
+        f.v[1] += f.v[0] >> 51, f.v[0] &= MASK51;
+        f.v[2] += f.v[1] >> 51, f.v[1] &= MASK51;
+        f.v[3] += f.v[2] >> 51, f.v[2] &= MASK51;
+        f.v[4] += f.v[3] >> 51, f.v[3] &= MASK51;
+        f.v[4] &= MASK51; // Drops the 2^255 that q stood for
+
+        uint64_t w[4]{f.v[0] | (f.v[1] << 51), (f.v[1] >> 13) | (f.v[2] << 38),
+                      (f.v[2] >> 26) | (f.v[3] << 25), (f.v[3] >> 39) | (f.v[4] << 12)};
+        std::array<unsigned char, 32> s{};
+        std::memcpy(s.data(), w, 32);
+        return s;
+    }
+
+    inline bool fe_is_zero(const Fe &f)
+    {
+        static const std::array<unsigned char, 32> zero{};
+        return fe_to_bytes(f) == zero;
+    }
+
+    inline bool fe_equal(const Fe &f, const Fe &g)
+    {
+        return fe_is_zero(fe_sub(f, g));
+    }
+
+    inline bool fe_is_negative(const Fe &f)
+    {
+        return fe_to_bytes(f)[0] & 1;
+    }
+
+    // z^(2^252 - 3), for square roots; also returns z^11 and z^(2^250 - 1) for fe_invert()
+    inline Fe fe_pow22523(const Fe &z, Fe *z11 = nullptr, Fe *z2_250_1 = nullptr)
+    {
+        Fe t0{fe_sq(z)};                   // z^2
+        Fe t1{fe_mul(z, fe_sq_n(t0, 2))};  // z^9
+        t0 = fe_mul(t0, t1);               // z^11
+        if (z11)
+        {
+            *z11 = t0;
+        }
+        t0 = fe_mul(t1, fe_sq(t0));        // z^(2^5 - 1)
+        t0 = fe_mul(fe_sq_n(t0, 5), t0);   // z^(2^10 - 1)
+        t1 = fe_mul(fe_sq_n(t0, 10), t0);  // z^(2^20 - 1)
+        t1 = fe_mul(fe_sq_n(t1, 20), t1);  // z^(2^40 - 1)
+        t0 = fe_mul(fe_sq_n(t1, 10), t0);  // z^(2^50 - 1)
+        t1 = fe_mul(fe_sq_n(t0, 50), t0);  // z^(2^100 - 1)
+        t1 = fe_mul(fe_sq_n(t1, 100), t1); // z^(2^200 - 1)
+        t0 = fe_mul(fe_sq_n(t1, 50), t0);  // z^(2^250 - 1)
+        if (z2_250_1)
+        {
+            *z2_250_1 = t0;
+        }
+        return fe_mul(fe_sq_n(t0, 2), z);  // z^(2^252 - 3)
+    }
+
+    // z^(p - 2) = z^(2^255 - 21)
+    inline Fe fe_invert(const Fe &z)
+    {
+        Fe z11{};
+        Fe z2_250_1{};
+        fe_pow22523(z, &z11, &z2_250_1);
+        return fe_mul(fe_sq_n(z2_250_1, 5), z11);
+    }
+
+    // === Points on -x^2 + y^2 = 1 + d x^2 y^2 ===
+    // Extended coordinates: x = X/Z, y = Y/Z, x*y = T/Z
+    struct Point
+    {
+        Fe X{};
+        Fe Y{fe_from_u64(1)};
+        Fe Z{fe_from_u64(1)};
+        Fe T{};
+    };
+
+    // A point prepared for repeated addition
+    struct Cached
+    {
+        Fe y_plus_x{};
+        Fe y_minus_x{};
+        Fe z2{};  // 2Z
+        Fe t2d{}; // 2dT
+    };
+
+    // Odd multiples are not enough for signed radix-16 digits; this holds 1P..8P
+    using Multiples = std::array<Cached, 8>;
+
+    struct Constants
+    {
+        Fe d{};
+        Fe d2{};
+        Fe sqrt_m1{};
+    };
+
+    // === Function: Curve constants, computed once ===
+    inline const Constants &constants()
+    {
+        static const Constants c{[]
+                                 {
+                                     Constants k{};
+                                     k.d = fe_mul(fe_neg(fe_from_u64(121665)), fe_invert(fe_from_u64(121666)));
+                                     k.d2 = fe_add(k.d, k.d);
+                                     k.sqrt_m1 = fe_mul(fe_sq(fe_pow22523(fe_from_u64(2))), fe_from_u64(2)); // 2^((p-1)/4)
+                                     return k;
+                                 }()};
+        return c;
+    }
+
+    inline Point point_double(const Point &p)
+    {
+        Fe a{fe_sq(p.X)};
+        Fe b{fe_sq(p.Y)};
+        Fe c{fe_add(fe_sq(p.Z), fe_sq(p.Z))};
+        Fe e{fe_sub(fe_sub(fe_sq(fe_add(p.X, p.Y)), a), b)};
+        Fe g{fe_sub(b, a)};
+        Fe f{fe_sub(g, c)};
+        Fe h{fe_neg(fe_add(a, b))};
+        return Point{fe_mul(e, f), fe_mul(g, h), fe_mul(f, g), fe_mul(e, h)};
+    }
+
+    inline Cached to_cached(const Point &p)
+    {
+        return Cached{fe_add(p.Y, p.X), fe_sub(p.Y, p.X), fe_add(p.Z, p.Z), fe_mul(p.T, constants().d2)};
+    }
+
+    // p + q, or p - q when `negate` is set (-(x, y) = (-x, y))
+    inline Point point_add(const Point &p, const Cached &q, bool negate = false)
+    {
+        Fe a{fe_mul(fe_sub(p.Y, p.X), negate ? q.y_plus_x : q.y_minus_x)};
+        Fe b{fe_mul(fe_add(p.Y, p.X), negate ? q.y_minus_x : q.y_plus_x)};
+        Fe c{fe_mul(p.T, q.t2d)};
+        Fe d{fe_mul(p.Z, q.z2)};
+        Fe e{fe_sub(b, a)};
+        Fe f{negate ? fe_add(d, c) : fe_sub(d, c)};
+        Fe g{negate ? fe_sub(d, c) : fe_add(d, c)};
+        Fe h{fe_add(b, a)};
+        return Point{fe_mul(e, f), fe_mul(g, h), fe_mul(f, g), fe_mul(e, h)};
+    }
+
+    inline bool is_identity(const Point &p)
+    {
+        return fe_is_zero(p.X) && fe_equal(p.Y, p.Z);
+    }
+
+    inline Multiples make_multiples(const Point &p)
+    {
+        Multiples table{};
+        Cached one{to_cached(p)};
+        table[0] = one;
+        Point sum{point_double(p)};
+        table[1] = to_cached(sum);
+        for (size_t i{2}; i < table.size(); ++i)
+        {
+            sum = point_add(sum, one);
+            table[i] = to_cached(sum);
+        }
+        return table;
+    }
+
+    // === Function: Decode a point (RFC 8032, 5.1.3) ===
+    // Rejects non-canonical y and encodings with no point behind them.
+    inline std::optional<Point> decode_point(const unsigned char *s)
+    {
+        const Constants &c{constants()};
+        Fe y{fe_from_bytes(s)};
+        std::array<unsigned char, 32> canonical{fe_to_bytes(y)};
+        canonical[31] |= s[31] & 0x80;
+        if (std::memcmp(canonical.data(), s, 32) != 0)
+        {
+            return std::nullopt;
+        }
+        bool sign{(s[31] >> 7) != 0};
+
+        Fe one{fe_from_u64(1)};
+        Fe y2{fe_sq(y)};
+        Fe u{fe_sub(y2, one)};
+        Fe v{fe_add(fe_mul(c.d, y2), one)};
+        Fe v3{fe_mul(fe_sq(v), v)};
+        Fe v7{fe_mul(fe_sq(v3), v)};
+        Fe x{fe_mul(fe_mul(u, v3), fe_pow22523(fe_mul(u, v7)))}; // (u/v)^((p+3)/8)
+
+        Fe vx2{fe_mul(v, fe_sq(x))};
+        if (!fe_equal(vx2, u))
+        {
+            if (!fe_equal(vx2, fe_neg(u)))
+            {
+                return std::nullopt;
+            }
+            x = fe_mul(x, c.sqrt_m1);
+        }
+        if (fe_is_zero(x) && sign)
+        {
+            return std::nullopt;
+        }
+        if (fe_is_negative(x) != sign)
+        {
+            x = fe_neg(x);
+        }
+        return Point{x, y, one, fe_mul(x, y)};
+    }
+
+    // === Function: 1B..8B for the base point, computed once ===
+    inline const Multiples &base_multiples()
+    {
+        static const Multiples base{[]
+                                    {
+                                        // y = 4/5, x even
+                                        unsigned char encoded[32];
+                                        std::memset(encoded, 0x66, sizeof(encoded));
+                                        encoded[0] = 0x58;
+                                        return make_multiples(*decode_point(encoded));
+                                    }()};
+        return base;
+    }
+
+    // === Scalars ===
+    // Signed radix-16 digits in [-8, 8] of a scalar below 2^253
+    using Digits = std::array<int8_t, 64>;
+
+    inline Digits to_digits(const unsigned char *scalar)
+    {
+        Digits e{};
+        for (size_t i{0}; i < 32; ++i)
+        {
+            e[2 * i] = static_cast<int8_t>(scalar[i] & 15);
+            e[2 * i + 1] = static_cast<int8_t>(scalar[i] >> 4);
+        }
+        int8_t carry{0};
+        for (size_t i{0}; i < 63; ++i)
+        {
+            e[i] = static_cast<int8_t>(e[i] + carry);
+            carry = static_cast<int8_t>((e[i] + 8) >> 4);
+            e[i] = static_cast<int8_t>(e[i] - (carry << 4));
+        }
+        e[63] = static_cast<int8_t>(e[63] + carry);
+        return e;
+    }
+
+    // L = 2^252 + 27742317777372353535851937790883648493, the group order
+    inline const BIGNUM *group_order()
+    {
+        static const BnPtr order{[]
+                                 {
+                                     BIGNUM *n{nullptr};
+                                     BN_hex2bn(&n, "1000000000000000000000000000000014def9dea2f79cd65812631a5cf5d3ed");
+                                     return BnPtr{n, &BN_free};
+                                 }()};
+        return order.get();
+    }
+
+    inline const EVP_MD *sha512_md()
+    {
+        static const EvpMdPtr md{EVP_MD_fetch(nullptr, "SHA512", nullptr), &EVP_MD_free};
+        if (!md)
+        {
+            throw std::runtime_error("Failed to fetch SHA512 implementation");
+        }
+        return md.get();
+    }
+
+    // === Public keys ===
+    // Decoded once when the user is provisioned: the point's multiples for
+    // verification, and an OpenSSL key for the verify_one() reference.
+    struct PublicKey
+    {
+        std::array<unsigned char, KEY_SIZE> bytes{};
+        Multiples multiples{};
+        EvpPkeyPtr pkey{nullptr, &EVP_PKEY_free};
+    };
+
+    // === Function: Parse a raw 32-byte public key ===
+    // Refuses non-canonical encodings and the small-order points: with [8]A = 0
+    // the cofactored equation holds for s = 0 and R = identity on any message.
+    inline std::optional<PublicKey> parse_public_key(const unsigned char *bytes)
+    {
+        std::optional<Point> a{decode_point(bytes)};
+        if (!a || is_identity(point_double(point_double(point_double(*a)))))
+        {
+            return std::nullopt;
+        }
+        PublicKey key{};
+        std::memcpy(key.bytes.data(), bytes, KEY_SIZE);
+        key.multiples = make_multiples(*a);
+        key.pkey.reset(EVP_PKEY_new_raw_public_key(EVP_PKEY_ED25519, nullptr, bytes, KEY_SIZE));
+        if (!key.pkey)
+        {
+            return std::nullopt;
+        }
+        return key;
+    }
+
+    // === Function: Verify one signature with OpenSSL (cofactorless reference) ===
+    // Each thread reuses one verification context. Not used for verdicts; see
+    // the top of this file.
+    inline bool verify_one(const std::string &message, const std::string &signature, const PublicKey &key)
+    {
+        if (signature.length() != SIGNATURE_SIZE)
+        {
+            return false;
+        }
+        thread_local EvpMdCtxPtr ctx{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+        if (!ctx || !EVP_MD_CTX_reset(ctx.get()) ||
+            !EVP_DigestVerifyInit(ctx.get(), nullptr, nullptr, nullptr, key.pkey.get()))
+        {
+            throw std::runtime_error("Ed25519 verification setup failed");
+        }
+        return EVP_DigestVerify(ctx.get(),
+                                reinterpret_cast<const unsigned char *>(signature.data()), signature.length(),
+                                reinterpret_cast<const unsigned char *>(message.data()), message.length()) == 1;
+    }
+
+    // One signature to check
+    struct Item
+    {
+        const std::string *message{nullptr};
+        const std::string *signature{nullptr};
+        const PublicKey *key{nullptr};
+    };
+
+    // A signature that passed the checks needing no key: length, s < L, R a canonical point
+    struct Term
+    {
+        size_t index{}; // Into the items
+        Point r{};
+        const unsigned char *s{};
+    };
+
+    // === Function: Parse and range-check one signature ===
+    inline std::optional<Term> parse_signature(const std::string &signature, size_t index)
+    {
+        if (signature.length() != SIGNATURE_SIZE)
+        {
+            return std::nullopt;
+        }
+        const unsigned char *bytes{reinterpret_cast<const unsigned char *>(signature.data())};
+        unsigned char s_big_endian[32];
+        for (size_t j{0}; j < 32; ++j)
+        {
+            s_big_endian[j] = bytes[63 - j];
+        }
+        BnPtr s{BN_bin2bn(s_big_endian, 32, nullptr), &BN_free};
+        if (!s || BN_cmp(s.get(), group_order()) >= 0)
+        {
+            return std::nullopt;
+        }
+        std::optional<Point> r{decode_point(bytes)};
+        if (!r)
+        {
+            return std::nullopt;
+        }
+        return Term{index, *r, bytes + 32};
+    }
+
+    // === Function: Evaluate the cofactored equation over some terms ===
+    // True iff [8](-[sum z_i s_i]B + sum [z_i]R_i + sum [z_i h_i]A_i) is the
+    // identity. With `randomize` the z_i are random 128-bit scalars (a batch);
+    // without, every z_i is 1, which for one term is the single cofactored check.
+    inline bool equation_holds(const std::vector<Item> &items, const std::vector<Term> &terms, bool randomize)
+    {
+        // Step 1: Scalars: z_i for R_i, z_i * h_i for A_i, -sum z_i * s_i for B
+        std::vector<unsigned char> z(terms.size() * 16, 0);
+        if (randomize && !RAND_bytes(z.data(), static_cast<int>(z.size())))
+        {
+            throw std::runtime_error("RAND_bytes failed");
+        }
+        for (size_t t{0}; !randomize && t < terms.size(); ++t)
+        {
+            z[t * 16] = 1;
+        }
+        BnCtxPtr bn_ctx{BN_CTX_new(), &BN_CTX_free};
+        BnPtr sum{BN_new(), &BN_free};
+        BnPtr zi{BN_new(), &BN_free};
+        BnPtr hi{BN_new(), &BN_free};
+        BnPtr si{BN_new(), &BN_free};
+        BnPtr product{BN_new(), &BN_free};
+        if (!bn_ctx || !sum || !zi || !hi || !si || !product)
+        {
+            throw std::runtime_error("BIGNUM allocation failed");
+        }
+        BN_zero(sum.get());
+
+        thread_local EvpMdCtxPtr sha{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+        std::vector<Digits> r_digits(terms.size());
+        std::vector<Digits> a_digits(terms.size());
+        for (size_t t{0}; t < terms.size(); ++t)
+        {
+            const Item &item{items[terms[t].index]};
+            const unsigned char *signature{reinterpret_cast<const unsigned char *>(item.signature->data())};
+            unsigned char h[64];
+            if (!sha || !EVP_DigestInit_ex(sha.get(), sha512_md(), nullptr) ||
+                !EVP_DigestUpdate(sha.get(), signature, 32) ||
+                !EVP_DigestUpdate(sha.get(), item.key->bytes.data(), KEY_SIZE) ||
+                !EVP_DigestUpdate(sha.get(), item.message->data(), item.message->length()) ||
+                !EVP_DigestFinal_ex(sha.get(), h, nullptr))
+            {
+                throw std::runtime_error("SHA512 failed");
+            }
+
+            unsigned char scalar[32]{};
+            std::memcpy(scalar, &z[t * 16], 16);
+            r_digits[t] = to_digits(scalar);
+
+            if (!BN_lebin2bn(&z[t * 16], 16, zi.get()) || !BN_lebin2bn(h, 64, hi.get()) ||
+                !BN_lebin2bn(terms[t].s, 32, si.get()) ||
+                !BN_mod_mul(product.get(), zi.get(), hi.get(), group_order(), bn_ctx.get()) ||
+                BN_bn2lebinpad(product.get(), scalar, 32) != 32 ||
+                !BN_mod_mul(product.get(), zi.get(), si.get(), group_order(), bn_ctx.get()) ||
+                !BN_mod_add(sum.get(), sum.get(), product.get(), group_order(), bn_ctx.get()))
+            {
+                throw std::runtime_error("Ed25519 scalar arithmetic failed");
+            }
+            a_digits[t] = to_digits(scalar);
+        }
+        unsigned char base_scalar[32]{};
+        if (!BN_mod_sub(sum.get(), group_order(), sum.get(), group_order(), bn_ctx.get()) ||
+            BN_bn2lebinpad(sum.get(), base_scalar, 32) != 32)
+        {
+            throw std::runtime_error("Ed25519 scalar arithmetic failed");
+        }
+        Digits base_digits{to_digits(base_scalar)};
+
+        // Step 2: One interleaved (Straus) multiplication, four shared doublings per digit
+        std::vector<Multiples> r_multiples(terms.size());
+        for (size_t t{0}; t < terms.size(); ++t)
+        {
+            r_multiples[t] = make_multiples(terms[t].r);
+        }
+        auto add_digit{[](Point &q, const Multiples &table, int8_t digit)
+                       {
+                           if (digit > 0)
+                           {
+                               q = point_add(q, table[digit - 1]);
+                           }
+                           else if (digit < 0)
+                           {
+                               q = point_add(q, table[-digit - 1], true);
+                           }
+                       }};
+        Point q{};
+        for (int i{63}; i >= 0; --i)
+        {
+            if (i != 63)
+            {
+                q = point_double(point_double(point_double(point_double(q))));
+            }
+            add_digit(q, base_multiples(), base_digits[i]);
+            for (size_t t{0}; t < terms.size(); ++t)
+            {
+                add_digit(q, r_multiples[t], r_digits[t][i]);
+                add_digit(q, items[terms[t].index].key->multiples, a_digits[t][i]);
+            }
+        }
+        q = point_double(point_double(point_double(q))); // Clear the cofactor
+        return is_identity(q);
+    }
+
+    // === Function: Verify one signature (cofactored, RFC 8032 5.1.7) ===
+    // The same equation as a batch, so the two never disagree.
+    inline bool verify_single(const std::string &message, const std::string &signature, const PublicKey &key)
+    {
+        std::optional<Term> term{parse_signature(signature, 0)};
+        return term && equation_holds({Item{&message, &signature, &key}}, {*term}, false);
+    }
+
+    // === Function: Verify a batch of signatures ===
+    // Returns one flag per item (std::vector<char> rather than the bit-packed
+    // std::vector<bool>, so callers can hand out pointers into it). Each flag
+    // is what verify_single() says about that item.
+    inline std::vector<char> verify_batch(const std::vector<Item> &items)
+    {
+        std::vector<char> valid(items.size(), 0);
+
+        // Step 1: Drop what fails on its own: bad length, s >= L, R not a point
+        std::vector<Term> terms{};
+        terms.reserve(items.size());
+        for (size_t i{0}; i < items.size(); ++i)
+        {
+            if (std::optional<Term> term{parse_signature(*items[i].signature, i)})
+            {
+                terms.push_back(*term);
+            }
+        }
+
+        // Step 2: One equation for the whole batch (a lone signature needs no z)
+        bool all_valid{terms.size() > 1 ? equation_holds(items, terms, true)
+                                        : terms.size() == 1 && equation_holds(items, terms, false)};
+
+        // Step 3: All valid, or find out which ones aren't
+        for (const Term &term : terms)
+        {
+            valid[term.index] = all_valid || (terms.size() > 1 && equation_holds(items, {term}, false));
+        }
+        return valid;
+    }
+}
@@ -0,0 +1,570 @@
+#include <iostream>     // For std::cout, std::cerr
+#include <string>       // For std::string
+#include <vector>       // For batches
+#include <array>        // For scalars
+#include <stdexcept>    // For std::runtime_error
+#include <openssl/evp.h>
+#include <openssl/rand.h>
+#include <openssl/bn.h>
+#include "ed25519_batch.h"
+
+// Checks for ed25519_batch.h: the RFC 8032 test vectors, rejection of
+// non-canonical S and R, small-order and mixed-order points, and that a batch
+// blames exactly the forged items and agrees with single verification.
+//
+// Build: g++ -std=c++17 -O2 ed25519_batch_test.cpp -o ed25519_batch_test -lcrypto
+// Usage: ./ed25519_batch_test   (exits non-zero if any check fails)
+
+using ed25519_batch::Point;
+using Scalar = std::array<unsigned char, 32>; // Little-endian
+
+size_t failures{0};
+
+// === Function: Record one check ===
+void check(const std::string &name, bool passed)
+{
+    std::cout << (passed ? "PASS  " : "FAIL  ") << name << "\n";
+    failures += passed ? 0 : 1;
+}
+
+// === Function: Hex to bytes ===
+std::string from_hex(const std::string &hex)
+{
+    std::string bytes{};
+    for (size_t i{0}; i + 1 < hex.length(); i += 2)
+    {
+        bytes += static_cast<char>(std::stoi(hex.substr(i, 2), nullptr, 16));
+    }
+    return bytes;
+}
+
+const unsigned char *raw(const std::string &bytes)
+{
+    return reinterpret_cast<const unsigned char *>(bytes.data());
+}
+
+// === Function: Point helpers the header doesn't need ===
+Point base_point()
+{
+    unsigned char encoded[32];
+    std::fill(std::begin(encoded), std::end(encoded), 0x66);
+    encoded[0] = 0x58;
+    return *ed25519_batch::decode_point(encoded);
+}
+
+Point add(const Point &p, const Point &q)
+{
+    return ed25519_batch::point_add(p, ed25519_batch::to_cached(q));
+}
+
+// Plain double-and-add, for any 256-bit scalar (including multiples of L)
+Point multiply(const Point &p, const Scalar &scalar)
+{
+    Point q{};
+    for (int bit{255}; bit >= 0; --bit)
+    {
+        q = ed25519_batch::point_double(q);
+        if ((scalar[bit / 8] >> (bit % 8)) & 1)
+        {
+            q = add(q, p);
+        }
+    }
+    return q;
+}
+
+std::string encode(const Point &p)
+{
+    using namespace ed25519_batch;
+    Fe z_inverse{fe_invert(p.Z)};
+    Fe x{fe_mul(p.X, z_inverse)};
+    std::array<unsigned char, 32> bytes{fe_to_bytes(fe_mul(p.Y, z_inverse))};
+    bytes[31] |= fe_is_negative(x) ? 0x80 : 0;
+    return std::string(reinterpret_cast<char *>(bytes.data()), bytes.size());
+}
+
+// === Function: Scalar arithmetic mod L ===
+using BnPtr = ed25519_batch::BnPtr;
+using BnCtxPtr = ed25519_batch::BnCtxPtr;
+
+BnPtr to_bn(const unsigned char *bytes, size_t length)
+{
+    BnPtr n{BN_lebin2bn(bytes, static_cast<int>(length), nullptr), &BN_free};
+    if (!n)
+    {
+        throw std::runtime_error("BN_lebin2bn failed");
+    }
+    return n;
+}
+
+Scalar to_scalar(const BIGNUM *n)
+{
+    Scalar scalar{};
+    if (BN_bn2lebinpad(n, scalar.data(), 32) != 32)
+    {
+        throw std::runtime_error("BN_bn2lebinpad failed");
+    }
+    return scalar;
+}
+
+Scalar reduce(const unsigned char *bytes, size_t length)
+{
+    BnCtxPtr ctx{BN_CTX_new(), &BN_CTX_free};
+    BnPtr n{to_bn(bytes, length)};
+    BN_nnmod(n.get(), n.get(), ed25519_batch::group_order(), ctx.get());
+    return to_scalar(n.get());
+}
+
+Scalar random_scalar()
+{
+    unsigned char wide[64];
+    if (!RAND_bytes(wide, sizeof(wide)))
+    {
+        throw std::runtime_error("RAND_bytes failed");
+    }
+    return reduce(wide, sizeof(wide));
+}
+
+// r + h * a mod L
+Scalar mul_add(const Scalar &r, const Scalar &h, const Scalar &a)
+{
+    BnCtxPtr ctx{BN_CTX_new(), &BN_CTX_free};
+    BnPtr result{BN_new(), &BN_free};
+    BnPtr rn{to_bn(r.data(), 32)};
+    BnPtr hn{to_bn(h.data(), 32)};
+    BnPtr an{to_bn(a.data(), 32)};
+    BN_mod_mul(result.get(), hn.get(), an.get(), ed25519_batch::group_order(), ctx.get());
+    BN_mod_add(result.get(), result.get(), rn.get(), ed25519_batch::group_order(), ctx.get());
+    return to_scalar(result.get());
+}
+
+// === Function: Sign with an explicit secret scalar, nonce and R encoding ===
+// s = r + SHA512(R || A || M) * a mod L. Lets a test put torsion in R or A, or
+// spell R non-canonically, which a real signer never does.
+std::string sign_raw(const std::string &message, const Scalar &a, const std::string &a_bytes,
+                     const std::string &r_bytes, const Scalar &r)
+{
+    std::string hashed{r_bytes + a_bytes + message};
+    unsigned char h[64];
+    if (!EVP_Digest(hashed.data(), hashed.length(), h, nullptr, EVP_sha512(), nullptr))
+    {
+        throw std::runtime_error("SHA512 failed");
+    }
+    Scalar s{mul_add(r, reduce(h, sizeof(h)), a)};
+    return r_bytes + std::string(reinterpret_cast<char *>(s.data()), s.size());
+}
+
+// h mod L for a signature, to predict the cofactorless verdict
+Scalar challenge_scalar(const std::string &message, const std::string &signature, const std::string &a_bytes)
+{
+    std::string hashed{signature.substr(0, 32) + a_bytes + message};
+    unsigned char h[64];
+    EVP_Digest(hashed.data(), hashed.length(), h, nullptr, EVP_sha512(), nullptr);
+    return reduce(h, sizeof(h));
+}
+
+// === Function: Sign with OpenSSL from a 32-byte seed ===
+struct OpenSslSigner
+{
+    std::string public_key{};
+    ed25519_batch::EvpPkeyPtr key{nullptr, &EVP_PKEY_free};
+
+    explicit OpenSslSigner(const std::string &seed)
+    {
+        key.reset(EVP_PKEY_new_raw_private_key(EVP_PKEY_ED25519, nullptr, raw(seed), seed.length()));
+        unsigned char bytes[32];
+        size_t length{sizeof(bytes)};
+        if (!key || !EVP_PKEY_get_raw_public_key(key.get(), bytes, &length))
+        {
+            throw std::runtime_error("Ed25519 key setup failed");
+        }
+        public_key.assign(reinterpret_cast<char *>(bytes), length);
+    }
+
+    std::string sign(const std::string &message) const
+    {
+        ed25519_batch::EvpMdCtxPtr ctx{EVP_MD_CTX_new(), &EVP_MD_CTX_free};
+        unsigned char signature[64];
+        size_t length{sizeof(signature)};
+        if (!ctx || !EVP_DigestSignInit(ctx.get(), nullptr, nullptr, nullptr, key.get()) ||
+            !EVP_DigestSign(ctx.get(), signature, &length, raw(message), message.length()))
+        {
+            throw std::runtime_error("Ed25519 signing failed");
+        }
+        return std::string(reinterpret_cast<char *>(signature), length);
+    }
+};
+
+// === Function: Batch verdicts equal single verdicts, and equal `expected` ===
+bool batch_matches(const std::vector<ed25519_batch::Item> &items, const std::vector<char> &expected)
+{
+    std::vector<char> valid{ed25519_batch::verify_batch(items)};
+    bool matches{valid == expected};
+    for (size_t i{0}; i < items.size(); ++i)
+    {
+        matches = matches && valid[i] == ed25519_batch::verify_single(*items[i].message, *items[i].signature, *items[i].key);
+    }
+    return matches;
+}
+
+// === Function: RFC 8032 section 7.1 test vectors ===
+void test_rfc8032()
+{
+    struct Vector
+    {
+        const char *name;
+        const char *secret;
+        const char *public_key;
+        const char *message;
+        const char *signature;
+    };
+    const Vector vectors[]{
+        {"TEST 1", "9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+         "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a", "",
+         "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e065224901555fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+        {"TEST 2", "4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+         "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c", "72",
+         "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+        {"TEST 3", "c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+         "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025", "af82",
+         "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"},
+        {"TEST SHA(abc)", "833fe62409237b9d62ec77587520911e9a759cec1d19755b7da901b96dca3d42",
+         "ec172b93ad5e563bf4932c70e1245034c35467ef2efd4d64ebf819683467e2bf",
+         "ddaf35a193617abacc417349ae20413112e6fa4e89a97ea20a9eeee64b55d39a"
+         "2192992a274fc1a836ba3c23a3feebbd454d4423643ce80e2a9ac94fa54ca49f",
+         "dc2a4459e7369633a52b1bf277839a00201009a3efbf3ecb69bea2186c26b589"
+         "09351fc9ac90b3ecfdfbc7c66431e0303dca179c138ac17ad9bef1177331a704"},
+    };
+
+    std::vector<ed25519_batch::PublicKey> keys{};
+    std::vector<std::string> messages{};
+    std::vector<std::string> signatures{};
+    for (const Vector &vector : vectors)
+    {
+        OpenSslSigner signer{from_hex(vector.secret)};
+        messages.push_back(from_hex(vector.message));
+        signatures.push_back(from_hex(vector.signature));
+        std::optional<ed25519_batch::PublicKey> key{ed25519_batch::parse_public_key(raw(from_hex(vector.public_key)))};
+        check(std::string{"RFC 8032 "} + vector.name + ": vector matches OpenSSL's key and signature",
+              signer.public_key == from_hex(vector.public_key) && signer.sign(messages.back()) == signatures.back());
+        check(std::string{"RFC 8032 "} + vector.name + ": verifies alone",
+              key && ed25519_batch::verify_single(messages.back(), signatures.back(), *key) &&
+                  ed25519_batch::verify_one(messages.back(), signatures.back(), *key));
+        if (key)
+        {
+            keys.push_back(std::move(*key));
+        }
+    }
+    if (keys.size() != std::size(vectors))
+    {
+        return;
+    }
+
+    std::vector<ed25519_batch::Item> items{};
+    for (size_t i{0}; i < keys.size(); ++i)
+    {
+        items.push_back({&messages[i], &signatures[i], &keys[i]});
+    }
+    check("RFC 8032: the vectors verify as one batch", batch_matches(items, std::vector<char>(items.size(), 1)));
+
+    // The same signatures under the wrong key or message
+    std::vector<ed25519_batch::Item> swapped{{&messages[0], &signatures[0], &keys[1]},
+                                             {&messages[1], &signatures[2], &keys[2]},
+                                             {&messages[2], &signatures[2], &keys[2]}};
+    check("RFC 8032: wrong key and wrong message are rejected, the rest accepted", batch_matches(swapped, {0, 0, 1}));
+}
+
+// === Function: Non-canonical S and R ===
+void test_non_canonical()
+{
+    OpenSslSigner signer{std::string(32, '\x07')};
+    ed25519_batch::PublicKey key{*ed25519_batch::parse_public_key(raw(signer.public_key))};
+    std::string message{"non-canonical"};
+    std::string signature{signer.sign(message)};
+
+    // S + L: the same value mod L, but RFC 8032 requires S < L
+    BnCtxPtr ctx{BN_CTX_new(), &BN_CTX_free};
+    BnPtr s{to_bn(raw(signature) + 32, 32)};
+    BN_add(s.get(), s.get(), ed25519_batch::group_order());
+    Scalar s_plus_l{to_scalar(s.get())};
+    std::string malleated{signature.substr(0, 32) + std::string(reinterpret_cast<char *>(s_plus_l.data()), 32)};
+    check("S + L is rejected", !ed25519_batch::verify_single(message, malleated, key) &&
+                                   !ed25519_batch::verify_one(message, malleated, key));
+    ed25519_batch::Item valid_item{&message, &signature, &key};
+    ed25519_batch::Item malleated_item{&message, &malleated, &key};
+    check("S + L is rejected in a batch", batch_matches({valid_item, malleated_item, valid_item}, {1, 0, 1}));
+
+    // S with the top bits set (S >= 2^253)
+    std::string high_s{signature};
+    high_s[63] = static_cast<char>(high_s[63] | 0xe0);
+    check("S >= 2^253 is rejected", batch_matches({valid_item, {&message, &high_s, &key}}, {1, 0}));
+
+    // R = identity with r = 0 and s = h * a: valid when R is spelled canonically
+    // (y = 1), and must be rejected when spelled y = p + 1
+    Scalar a{random_scalar()};
+    std::string a_bytes{encode(multiply(base_point(), a))};
+    ed25519_batch::PublicKey chosen_key{*ed25519_batch::parse_public_key(raw(a_bytes))};
+    std::string identity{from_hex("0100000000000000000000000000000000000000000000000000000000000000")};
+    std::string identity_p_plus_1{from_hex("eeffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff7f")};
+    std::string canonical_r{sign_raw(message, a, a_bytes, identity, Scalar{})};
+    std::string non_canonical_r{sign_raw(message, a, a_bytes, identity_p_plus_1, Scalar{})};
+    check("R = identity spelled canonically verifies (control)",
+          ed25519_batch::verify_single(message, canonical_r, chosen_key) &&
+              ed25519_batch::verify_one(message, canonical_r, chosen_key));
+    check("R spelled with y >= p is rejected",
+          batch_matches({{&message, &canonical_r, &chosen_key}, {&message, &non_canonical_r, &chosen_key}}, {1, 0}));
+
+    // R = identity with the sign bit set (x = 0 has no negative)
+    std::string negative_zero{identity};
+    negative_zero[31] = static_cast<char>(0x80);
+    std::string negative_zero_r{sign_raw(message, a, a_bytes, negative_zero, Scalar{})};
+    check("R with x = 0 and the sign bit set is rejected",
+          batch_matches({{&message, &negative_zero_r, &chosen_key}, {&message, &canonical_r, &chosen_key}}, {0, 1}));
+
+    check("public key spelled with y >= p is rejected", !ed25519_batch::parse_public_key(raw(identity_p_plus_1)));
+    check("public key with x = 0 and the sign bit set is rejected", !ed25519_batch::parse_public_key(raw(negative_zero)));
+    check("wrong signature lengths are rejected",
+          batch_matches({{&message, &identity, &key}, {&message, &signature, &key}}, {0, 1}) &&
+              !ed25519_batch::verify_single(message, signature + "x", key));
+}
+
+// === Function: Small-order and mixed-order points ===
+void test_small_order()
+{
+    // [L]P of a random point is in the torsion subgroup; keep one of order 8
+    Scalar l{to_scalar(ed25519_batch::group_order())};
+    Point torsion{};
+    for (unsigned char seed{1}; seed != 0; ++seed)
+    {
+        std::string candidate(32, static_cast<char>(seed));
+        std::optional<Point> p{ed25519_batch::decode_point(raw(candidate))};
+        if (!p)
+        {
+            continue;
+        }
+        torsion = multiply(*p, l);
+        if (!ed25519_batch::is_identity(ed25519_batch::point_double(ed25519_batch::point_double(torsion))))
+        {
+            break;
+        }
+    }
+    Point four_t{ed25519_batch::point_double(ed25519_batch::point_double(torsion))};
+    check("found a point of order 8", !ed25519_batch::is_identity(four_t) &&
+                                          ed25519_batch::is_identity(ed25519_batch::point_double(four_t)));
+
+    // All eight small-order points, as public keys
+    bool all_refused{true};
+    Point multiple{};
+    for (int i{0}; i < 8; ++i)
+    {
+        multiple = add(multiple, torsion);
+        all_refused = all_refused && !ed25519_batch::parse_public_key(raw(encode(multiple)));
+    }
+    check("all 8 small-order public keys are refused", all_refused);
+
+    std::string message{"torsion"};
+    Scalar a{random_scalar()};
+    Point a_point{multiply(base_point(), a)};
+    std::string a_bytes{encode(a_point)};
+    ed25519_batch::PublicKey key{*ed25519_batch::parse_public_key(raw(a_bytes))};
+
+    // Small-order R (r = 0): cofactored accepts, cofactorless OpenSSL doesn't
+    std::string small_r{sign_raw(message, a, a_bytes, encode(torsion), Scalar{})};
+    check("small-order R: cofactored single check accepts, OpenSSL's cofactorless check rejects",
+          ed25519_batch::verify_single(message, small_r, key) && !ed25519_batch::verify_one(message, small_r, key));
+
+    // Mixed-order R: rB + T
+    Scalar r{random_scalar()};
+    std::string mixed_r{sign_raw(message, a, a_bytes, encode(add(multiply(base_point(), r), torsion)), r)};
+    check("mixed-order R: cofactored single check accepts, OpenSSL's cofactorless check rejects",
+          ed25519_batch::verify_single(message, mixed_r, key) && !ed25519_batch::verify_one(message, mixed_r, key));
+
+    // Mixed-order A: aB + T; OpenSSL's verdict depends on whether [h]T vanishes
+    std::string mixed_a_bytes{encode(add(a_point, torsion))};
+    std::optional<ed25519_batch::PublicKey> mixed_key{ed25519_batch::parse_public_key(raw(mixed_a_bytes))};
+    check("mixed-order public key is accepted (only small-order keys are refused)", mixed_key.has_value());
+    if (!mixed_key)
+    {
+        return;
+    }
+    bool consistent{true};
+    bool cofactorless_differed{false};
+    std::vector<std::string> mixed_a_signatures{};
+    for (int i{0}; i < 16; ++i)
+    {
+        std::string nonce_message{message + std::to_string(i)};
+        Scalar nonce{random_scalar()};
+        std::string signature{sign_raw(nonce_message, a, mixed_a_bytes, encode(multiply(base_point(), nonce)), nonce)};
+        bool cofactorless_expected{ed25519_batch::is_identity(
+            multiply(torsion, challenge_scalar(nonce_message, signature, mixed_a_bytes)))};
+        consistent = consistent && ed25519_batch::verify_single(nonce_message, signature, *mixed_key) &&
+                     ed25519_batch::verify_one(nonce_message, signature, *mixed_key) == cofactorless_expected;
+        cofactorless_differed = cofactorless_differed || !cofactorless_expected;
+    }
+    check("mixed-order A: cofactored check accepts, OpenSSL accepts exactly when [h]T = 0",
+          consistent && cofactorless_differed);
+
+    // In a batch, torsioned signatures get the same verdict as alone, next to
+    // honest ones, forged ones and a torsioned forgery
+    std::string mixed_a_signature{sign_raw(message, a, mixed_a_bytes, encode(multiply(base_point(), r)), r)};
+    std::string forged_mixed{mixed_r};
+    forged_mixed[40] = static_cast<char>(forged_mixed[40] ^ 1);
+    std::string honest{sign_raw(message, a, a_bytes, encode(multiply(base_point(), r)), r)};
+    std::vector<ed25519_batch::Item> items{{&message, &small_r, &key},
+                                           {&message, &honest, &key},
+                                           {&message, &mixed_r, &key},
+                                           {&message, &forged_mixed, &key},
+                                           {&message, &mixed_a_signature, &*mixed_key},
+                                           {&message, &honest, &*mixed_key}};
+    check("batch with small- and mixed-order items agrees with single checks", batch_matches(items, {1, 1, 1, 0, 1, 0}));
+    items.erase(items.begin() + 5);
+    items.erase(items.begin() + 3);
+    bool all_pass{true};
+    for (int round{0}; round < 32; ++round) // Fresh random z_i each time
+    {
+        all_pass = all_pass && ed25519_batch::verify_batch(items) == std::vector<char>(items.size(), 1);
+    }
+    check("batch of only valid torsioned signatures passes for every draw of z", all_pass);
+}
+
+// === Function: A forged item is blamed on itself, wherever it is in the batch ===
+void test_attribution()
+{
+    constexpr size_t BATCH{16};
+    std::vector<OpenSslSigner> signers{};
+    std::vector<ed25519_batch::PublicKey> keys{};
+    std::vector<std::string> messages{};
+    std::vector<std::string> signatures{};
+    for (size_t i{0}; i < BATCH; ++i)
+    {
+        // Signer 3 appears twice, as one key signing in two sessions
+        signers.emplace_back(std::string(32, static_cast<char>(i == 9 ? 3 : i + 1)));
+        keys.push_back(*ed25519_batch::parse_public_key(raw(signers.back().public_key)));
+        messages.push_back("challenge " + std::to_string(i));
+        signatures.push_back(signers.back().sign(messages.back()));
+    }
+    auto items_for{[&](const std::vector<std::string> &batch_messages, const std::vector<std::string> &batch_signatures,
+                       const std::vector<const ed25519_batch::PublicKey *> &batch_keys)
+                   {
+                       std::vector<ed25519_batch::Item> items{};
+                       for (size_t i{0}; i < BATCH; ++i)
+                       {
+                           items.push_back({&batch_messages[i], &batch_signatures[i], batch_keys[i]});
+                       }
+                       return items;
+                   }};
+    std::vector<const ed25519_batch::PublicKey *> key_pointers{};
+    for (const auto &key : keys)
+    {
+        key_pointers.push_back(&key);
+    }
+    check("valid batch with a repeated key passes",
+          batch_matches(items_for(messages, signatures, key_pointers), std::vector<char>(BATCH, 1)));
+
+    bool forged_s{true};
+    bool forged_r{true};
+    bool forged_message{true};
+    bool wrong_key{true};
+    for (size_t j{0}; j < BATCH; ++j)
+    {
+        std::vector<char> expected(BATCH, 1);
+        expected[j] = 0;
+
+        std::vector<std::string> bad_signatures{signatures};
+        bad_signatures[j][33] = static_cast<char>(bad_signatures[j][33] ^ 0x10);
+        forged_s = forged_s && batch_matches(items_for(messages, bad_signatures, key_pointers), expected);
+
+        // Another valid point for R: the signer's own R from another message
+        bad_signatures = signatures;
+        bad_signatures[j].replace(0, 32, signatures[(j + 1) % BATCH], 0, 32);
+        forged_r = forged_r && batch_matches(items_for(messages, bad_signatures, key_pointers), expected);
+
+        std::vector<std::string> bad_messages{messages};
+        bad_messages[j] += "!";
+        forged_message = forged_message && batch_matches(items_for(bad_messages, signatures, key_pointers), expected);
+
+        std::vector<const ed25519_batch::PublicKey *> bad_keys{key_pointers};
+        bad_keys[j] = &keys[(j + 5) % BATCH];
+        wrong_key = wrong_key && batch_matches(items_for(messages, signatures, bad_keys), expected);
+    }
+    check("forged S is blamed on its item at every position", forged_s);
+    check("substituted R is blamed on its item at every position", forged_r);
+    check("forged message is blamed on its item at every position", forged_message);
+    check("wrong key is blamed on its item at every position", wrong_key);
+
+    // Several forgeries, including two from the same key
+    std::vector<std::string> bad_signatures{signatures};
+    std::vector<char> expected(BATCH, 1);
+    for (size_t j : {0, 3, 9, 15})
+    {
+        bad_signatures[j][50] = static_cast<char>(bad_signatures[j][50] ^ 1);
+        expected[j] = 0;
+    }
+    check("several forgeries are each blamed", batch_matches(items_for(messages, bad_signatures, key_pointers), expected));
+
+    // Two forgeries that cancel in an unweighted sum (s_0 + d, s_1 - d) still
+    // fail: the random z_i weigh them differently
+    bad_signatures = signatures;
+    BnCtxPtr ctx{BN_CTX_new(), &BN_CTX_free};
+    BnPtr s0{to_bn(raw(bad_signatures[0]) + 32, 32)};
+    BnPtr s1{to_bn(raw(bad_signatures[1]) + 32, 32)};
+    BnPtr one{BN_new(), &BN_free};
+    BN_one(one.get());
+    BN_mod_add(s0.get(), s0.get(), one.get(), ed25519_batch::group_order(), ctx.get());
+    BN_mod_sub(s1.get(), s1.get(), one.get(), ed25519_batch::group_order(), ctx.get());
+    Scalar s0_bytes{to_scalar(s0.get())};
+    Scalar s1_bytes{to_scalar(s1.get())};
+    bad_signatures[0].replace(32, 32, reinterpret_cast<char *>(s0_bytes.data()), 32);
+    bad_signatures[1].replace(32, 32, reinterpret_cast<char *>(s1_bytes.data()), 32);
+    expected.assign(BATCH, 1);
+    expected[0] = 0;
+    expected[1] = 0;
+    check("forgeries that cancel without random weights are blamed",
+          batch_matches(items_for(messages, bad_signatures, key_pointers), expected));
+
+    // Random mixes: batch verdicts always equal single verdicts
+    bool agrees{true};
+    for (int round{0}; round < 20; ++round)
+    {
+        bad_signatures = signatures;
+        unsigned char choice[BATCH];
+        RAND_bytes(choice, sizeof(choice));
+        for (size_t j{0}; j < BATCH; ++j)
+        {
+            if (choice[j] % 4 == 0)
+            {
+                bad_signatures[j][choice[j] % 64] = static_cast<char>(bad_signatures[j][choice[j] % 64] ^ 0x04);
+            }
+        }
+        for (size_t size : {1, 2, 3, 16})
+        {
+            std::vector<ed25519_batch::Item> items{items_for(messages, bad_signatures, key_pointers)};
+            items.resize(size);
+            std::vector<char> expected_single{};
+            for (const auto &item : items)
+            {
+                expected_single.push_back(ed25519_batch::verify_single(*item.message, *item.signature, *item.key));
+            }
+            agrees = agrees && batch_matches(items, expected_single);
+        }
+    }
+    check("random mixes of valid and forged items agree with single checks", agrees);
+}
+
+int main()
+{
+    try
+    {
+        test_rfc8032();
+        test_non_canonical();
+        test_small_order();
+        test_attribution();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Test error: " << e.what() << "\n";
+        failures += 1;
+    }
+
+    std::cout << (failures == 0 ? "All checks passed\n" : std::to_string(failures) + " check(s) failed\n");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,235 @@
+#include <iostream>     // For std::cout, std::cerr
+#include <fstream>      // For std::ifstream
+#include <string>       // For std::string
+#include <vector>       // For std::vector
+#include <algorithm>    // For std::sort
+#include <iomanip>      // For std::setw, std::setfill, std::fixed
+#include <cstdint>      // For fixed-width integer types
+#include <cstdlib>      // For std::atof()
+#include <cstring>      // For strnlen()
+#include <ctime>        // For gmtime_r(), strftime()
+#include <arpa/inet.h>  // For inet_ntop()
+
+// Decodes a flight recorder dump written by server2 (flight_recorder.bin, on
+// SIGUSR2, the "dump" control command or a crash) into one line per event,
+// oldest first, merged across threads.
+//
+// Usage: ./flight_decoder flight_recorder.bin [--last <seconds>]
+
+constexpr uint32_t FLIGHT_DUMP_MAGIC{0x464C5231}; // "FLR1"
+constexpr uint32_t FLIGHT_DUMP_VERSION{1};
+
+// Must match FlightEvent, FlightRecord, FlightDumpHeader and
+// FlightThreadHeader in server2.cpp
+enum class FlightEvent : uint16_t
+{
+    Start = 1,
+    Listening,
+    Accept,
+    AcceptFailed,
+    Verdict,
+    Rejected,
+    SessionError,
+    HelloRate,
+    AuditCommit,
+    AuditRotate,
+    Dump,
+    DeadlineExceeded,
+    QueueDepth,
+};
+
+struct FlightRecord
+{
+    uint64_t ns{0};
+    FlightEvent type{};
+    uint16_t reserved{0};
+    uint32_t a{0};
+    uint64_t b{0};
+    uint64_t c{0};
+};
+static_assert(sizeof(FlightRecord) == 32);
+
+struct FlightDumpHeader
+{
+    uint32_t magic{0};
+    uint32_t version{0};
+    uint32_t record_size{0};
+    uint32_t ring_capacity{0};
+    uint32_t thread_count{0};
+    uint32_t signal{0};
+    uint64_t monotonic_ns{0};
+    uint64_t realtime_ns{0};
+};
+
+struct FlightThreadHeader
+{
+    char name[16]{};
+    uint32_t tid{0};
+    uint32_t reserved{0};
+    uint64_t head{0};
+};
+
+// One decoded event and the thread it came from
+struct Event
+{
+    FlightRecord record{};
+    std::string thread{};
+};
+
+// === FUNCTION: Format an IPv4 address stored in network byte order ===
+std::string peer_text(uint32_t peer_ipv4)
+{
+    char peer[INET_ADDRSTRLEN]{};
+    inet_ntop(AF_INET, &peer_ipv4, peer, sizeof(peer));
+    return peer;
+}
+
+// === FUNCTION: Describe one event ===
+std::string describe(const FlightRecord &record)
+{
+    switch (record.type)
+    {
+    case FlightEvent::Start:
+        return "start";
+    case FlightEvent::Listening:
+        return "listening port=" + std::to_string(record.a);
+    case FlightEvent::Accept:
+        return "accept peer=" + peer_text(record.a);
+    case FlightEvent::AcceptFailed:
+        return "accept_failed errno=" + std::to_string(record.a);
+    case FlightEvent::Verdict:
+        return "verdict peer=" + peer_text(record.a) + (record.b == 1 ? " SUCCESS" : " FAILURE") +
+               " session_us=" + std::to_string(record.c / 1000);
+    case FlightEvent::Rejected:
+        return "rejected peer=" + peer_text(record.a) + " (puzzle not solved)";
+    case FlightEvent::SessionError:
+        return "session_error peer=" + peer_text(record.a);
+    case FlightEvent::HelloRate:
+        return "hello_rate per_second=" + std::to_string(record.b);
+    case FlightEvent::AuditCommit:
+        return "audit_commit records=" + std::to_string(record.a) + " bytes=" + std::to_string(record.b) +
+               " commit_us=" + std::to_string(record.c / 1000);
+    case FlightEvent::AuditRotate:
+        return "audit_rotate";
+    case FlightEvent::Dump:
+        return "dump (control command)";
+    case FlightEvent::DeadlineExceeded:
+    {
+        constexpr const char *CHECKS[]{"queueing", "challenge", "verify"};
+        return "deadline_exceeded peer=" + peer_text(record.a) + " at=" + (record.b < 3 ? CHECKS[record.b] : "?");
+    }
+    case FlightEvent::QueueDepth:
+    {
+        constexpr const char *QUEUES[]{"?", "accept", "ed25519_batch"};
+        std::string text{"queue_depth queue=" + std::string(record.a < 3 ? QUEUES[record.a] : "?") +
+                         " depth=" + std::to_string(record.b)};
+        if (record.c != 0)
+        {
+            text += (record.a == 2 ? " batch=" : " limit=") + std::to_string(record.c);
+        }
+        return text;
+    }
+    default:
+        return "unknown type=" + std::to_string(static_cast<unsigned>(record.type));
+    }
+}
+
+// === FUNCTION: Read every thread's ring from a dump ===
+// Returns false if the file is not a dump this tool understands.
+bool read_dump(const std::string &path, FlightDumpHeader &header, std::vector<Event> &events)
+{
+    std::ifstream in{path, std::ios::binary};
+    if (!in)
+    {
+        std::cerr << path << ": cannot open\n";
+        return false;
+    }
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)) || header.magic != FLIGHT_DUMP_MAGIC ||
+        header.version != FLIGHT_DUMP_VERSION || header.record_size != sizeof(FlightRecord) || header.ring_capacity == 0)
+    {
+        std::cerr << path << ": not a flight recorder dump (or a different version)\n";
+        return false;
+    }
+
+    std::vector<FlightRecord> ring(header.ring_capacity);
+    for (uint32_t t{0}; t < header.thread_count; ++t)
+    {
+        FlightThreadHeader thread{};
+        if (!in.read(reinterpret_cast<char *>(&thread), sizeof(thread)) ||
+            !in.read(reinterpret_cast<char *>(ring.data()), static_cast<std::streamsize>(ring.size() * sizeof(FlightRecord))))
+        {
+            std::cerr << path << ": truncated at thread " << t << "\n";
+            return !events.empty();
+        }
+
+        // The ring holds the newest min(head, capacity) records
+        std::string name{std::string(thread.name, strnlen(thread.name, sizeof(thread.name))) + "/" +
+                         std::to_string(thread.tid)};
+        uint64_t count{std::min<uint64_t>(thread.head, header.ring_capacity)};
+        for (uint64_t i{thread.head - count}; i < thread.head; ++i)
+        {
+            const FlightRecord &record{ring[i % header.ring_capacity]};
+            if (record.ns != 0)
+            {
+                events.push_back({record, name});
+            }
+        }
+    }
+    return true;
+}
+
+// === FUNCTION: Print one event with its wall-clock time ===
+void print_event(const FlightDumpHeader &header, const Event &event)
+{
+    // Monotonic timestamps are mapped to wall time through the dump's clocks
+    int64_t before_dump{static_cast<int64_t>(header.monotonic_ns) - static_cast<int64_t>(event.record.ns)};
+    uint64_t wall_ns{header.realtime_ns - static_cast<uint64_t>(before_dump)};
+
+    time_t seconds{static_cast<time_t>(wall_ns / 1000000000)};
+    tm utc{};
+    gmtime_r(&seconds, &utc);
+    char when[32]{};
+    strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", &utc);
+
+    std::cout << when << "." << std::setw(6) << std::setfill('0') << (wall_ns % 1000000000) / 1000 << "Z\t"
+              << "-" << std::fixed << std::setprecision(6) << static_cast<double>(before_dump) / 1e9 << "s\t"
+              << event.thread << "\t" << describe(event.record) << "\n";
+}
+
+// === Main Entry Point ===
+int main(int argc, char *argv[])
+{
+    if (argc != 2 && !(argc == 4 && std::string(argv[2]) == "--last"))
+    {
+        std::cerr << "Usage: " << argv[0] << " <flight_recorder.bin> [--last <seconds>]\n";
+        return 1;
+    }
+    double last_seconds{argc == 4 ? std::atof(argv[3]) : 0.0};
+
+    FlightDumpHeader header{};
+    std::vector<Event> events{};
+    if (!read_dump(argv[1], header, events))
+    {
+        return 1;
+    }
+
+    std::sort(events.begin(), events.end(), [](const Event &a, const Event &b)
+              { return a.record.ns < b.record.ns; });
+
+    std::cout << "dump of " << header.thread_count << " threads";
+    if (header.signal != 0)
+    {
+        std::cout << " on signal " << header.signal;
+    }
+    std::cout << ", " << events.size() << " events\n";
+
+    for (const Event &event : events)
+    {
+        if (last_seconds > 0 && static_cast<double>(header.monotonic_ns - event.record.ns) / 1e9 > last_seconds)
+        {
+            continue;
+        }
+        print_event(header, event);
+    }
+    return 0;
+}
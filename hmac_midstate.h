@@ -0,0 +1,226 @@
+#pragma once
+
+// === Precomputed HMAC key schedules ===
+// HMAC(key, msg) = H((key ^ opad) || H((key ^ ipad) || msg))
+// The two padded key blocks are the same for every message, so they are hashed
+// once when a key is provisioned and only the resulting chaining values (the
+// "midstates") are kept. Each MAC then resumes from them, which saves two
+// compression rounds and means the raw key is not kept around.
+//
+// A KeyState is plain words stored inline: no OpenSSL context, no heap. It can
+// be copied, exported to a file and imported again, so a server can persist
+// the midstates instead of the secret. The midstates are key-equivalent
+// (anyone holding them can compute MACs), so store them like the key itself.
+//
+// EVP has no way to read out or resume from a chaining state, so this uses the
+// low-level SHA1/SHA256 API, which OpenSSL 3 marks deprecated but still ships.
+//
+// Usage:
+//
+//     auto state{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, secret)};   // once
+//     std::string mac{hmac_midstate::compute_hmac(challenge, state)};                      // per message
+//
+// Link with -lcrypto.
+
+#include <string>             // For std::string
+#include <string_view>        // For std::string_view (messages)
+#include <cstdint>            // For uint32_t, uint8_t
+#include <algorithm>          // For std::copy
+#include <optional>           // For std::optional (import)
+#include <stdexcept>          // For std::runtime_error
+#include <openssl/sha.h>      // For SHA_CTX, SHA256_CTX – resumable hash states
+#include <openssl/crypto.h>   // For OPENSSL_cleanse()
+
+namespace hmac_midstate
+{
+    constexpr size_t BLOCK_SIZE{64}; // SHA1 and SHA256 both use 64-byte blocks
+    constexpr size_t MAX_DIGEST_SIZE{32};
+    constexpr size_t MAX_STATE_WORDS{8};
+
+    enum class Digest : uint8_t
+    {
+        None, // No key provisioned
+        Sha1,
+        Sha256
+    };
+
+    struct KeyState
+    {
+        Digest digest{Digest::None};
+        uint32_t inner[MAX_STATE_WORDS]{}; // Chaining value after absorbing key ^ ipad
+        uint32_t outer[MAX_STATE_WORDS]{}; // Chaining value after absorbing key ^ opad
+
+        explicit operator bool() const { return digest != Digest::None; }
+    };
+
+    // === Function: Digest size, also the number of state bytes per half ===
+    inline size_t digest_size(Digest digest)
+    {
+        return digest == Digest::Sha1 ? SHA_DIGEST_LENGTH : digest == Digest::Sha256 ? SHA256_DIGEST_LENGTH : 0;
+    }
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+
+    // === Function: Hash one padded key block and keep the chaining value ===
+    inline void absorb_block(Digest digest, const unsigned char *block, uint32_t *words)
+    {
+        if (digest == Digest::Sha1)
+        {
+            SHA_CTX ctx{};
+            SHA1_Init(&ctx);
+            SHA1_Update(&ctx, block, BLOCK_SIZE);
+            const uint32_t h[]{ctx.h0, ctx.h1, ctx.h2, ctx.h3, ctx.h4};
+            std::copy(h, h + 5, words);
+            OPENSSL_cleanse(&ctx, sizeof(ctx));
+        }
+        else
+        {
+            SHA256_CTX ctx{};
+            SHA256_Init(&ctx);
+            SHA256_Update(&ctx, block, BLOCK_SIZE);
+            std::copy(ctx.h, ctx.h + 8, words);
+            OPENSSL_cleanse(&ctx, sizeof(ctx));
+        }
+    }
+
+    // === Function: Finish a hash resumed after one absorbed block ===
+    // Writes digest_size(digest) bytes to `out`.
+    inline void resume(Digest digest, const uint32_t *words, const void *data, size_t length, unsigned char *out)
+    {
+        if (digest == Digest::Sha1)
+        {
+            SHA_CTX ctx{};
+            ctx.h0 = words[0], ctx.h1 = words[1], ctx.h2 = words[2], ctx.h3 = words[3], ctx.h4 = words[4];
+            ctx.Nl = BLOCK_SIZE * 8; // Message length so far, in bits
+            SHA1_Update(&ctx, data, length);
+            SHA1_Final(out, &ctx);
+            OPENSSL_cleanse(&ctx, sizeof(ctx));
+        }
+        else
+        {
+            SHA256_CTX ctx{};
+            std::copy(words, words + 8, ctx.h);
+            ctx.Nl = BLOCK_SIZE * 8;
+            ctx.md_len = SHA256_DIGEST_LENGTH;
+            SHA256_Update(&ctx, data, length);
+            SHA256_Final(out, &ctx);
+            OPENSSL_cleanse(&ctx, sizeof(ctx));
+        }
+    }
+
+#pragma GCC diagnostic pop
+
+    // === Function: Precompute the key schedule for one key ===
+    // Keys longer than a block are hashed first, as HMAC requires. Every
+    // intermediate copy of the key is wiped before returning.
+    inline KeyState make_key_state(Digest digest, std::string_view key)
+    {
+        if (digest_size(digest) == 0)
+        {
+            throw std::runtime_error("Unsupported HMAC digest");
+        }
+
+        unsigned char key_block[BLOCK_SIZE]{};
+        if (key.length() > BLOCK_SIZE)
+        {
+            if (digest == Digest::Sha1)
+            {
+                SHA1(reinterpret_cast<const unsigned char *>(key.data()), key.length(), key_block);
+            }
+            else
+            {
+                SHA256(reinterpret_cast<const unsigned char *>(key.data()), key.length(), key_block);
+            }
+        }
+        else
+        {
+            std::copy(key.begin(), key.end(), key_block);
+        }
+
+        // Hash the inner (0x36) and outer (0x5c) padded key blocks
+        KeyState state{};
+        state.digest = digest;
+        unsigned char pad[BLOCK_SIZE]{};
+        for (size_t i{0}; i < BLOCK_SIZE; ++i)
+        {
+            pad[i] = key_block[i] ^ 0x36;
+        }
+        absorb_block(digest, pad, state.inner);
+        for (size_t i{0}; i < BLOCK_SIZE; ++i)
+        {
+            pad[i] = key_block[i] ^ 0x5c;
+        }
+        absorb_block(digest, pad, state.outer);
+
+        OPENSSL_cleanse(key_block, sizeof(key_block));
+        OPENSSL_cleanse(pad, sizeof(pad));
+        return state;
+    }
+
+    // === Function: HMAC of `data` into `out` (digest_size() bytes) ===
+    // Identical to HMAC(digest, key, data) for the key the state was made from.
+    inline size_t compute(const KeyState &state, std::string_view data, unsigned char *out)
+    {
+        size_t size{digest_size(state.digest)};
+        if (size == 0)
+        {
+            throw std::runtime_error("HMAC computation without a key");
+        }
+        unsigned char inner_digest[MAX_DIGEST_SIZE];
+        resume(state.digest, state.inner, data.data(), data.length(), inner_digest);
+        resume(state.digest, state.outer, inner_digest, size, out);
+        OPENSSL_cleanse(inner_digest, sizeof(inner_digest));
+        return size;
+    }
+
+    // === Function: HMAC of `data` as a binary string ===
+    inline std::string compute_hmac(std::string_view data, const KeyState &state)
+    {
+        unsigned char mac[MAX_DIGEST_SIZE];
+        size_t size{compute(state, data, mac)};
+        // reinterpret_cast: raw bytes into a std::string, which may contain null bytes
+        return std::string(reinterpret_cast<char *>(mac), size);
+    }
+
+    // === Function: Export the midstates as bytes (inner then outer, big-endian words) ===
+    inline std::string export_state(const KeyState &state)
+    {
+        size_t words{digest_size(state.digest) / 4};
+        std::string bytes{};
+        bytes.reserve(words * 8);
+        for (const uint32_t *half : {state.inner, state.outer})
+        {
+            for (size_t i{0}; i < words; ++i)
+            {
+                for (int shift{24}; shift >= 0; shift -= 8)
+                {
+                    bytes += static_cast<char>((half[i] >> shift) & 0xff);
+                }
+            }
+        }
+        return bytes;
+    }
+
+    // === Function: Rebuild a KeyState from export_state() bytes ===
+    // Returns nothing if the length doesn't match the digest.
+    inline std::optional<KeyState> import_state(Digest digest, std::string_view bytes)
+    {
+        size_t words{digest_size(digest) / 4};
+        if (words == 0 || bytes.length() != words * 8)
+        {
+            return std::nullopt;
+        }
+        KeyState state{};
+        state.digest = digest;
+        auto byte{[&](size_t i)
+                  { return static_cast<uint32_t>(static_cast<unsigned char>(bytes[i])); }};
+        for (size_t i{0}; i < words; ++i)
+        {
+            state.inner[i] = byte(4 * i) << 24 | byte(4 * i + 1) << 16 | byte(4 * i + 2) << 8 | byte(4 * i + 3);
+            size_t o{4 * (words + i)};
+            state.outer[i] = byte(o) << 24 | byte(o + 1) << 16 | byte(o + 2) << 8 | byte(o + 3);
+        }
+        return state;
+    }
+}
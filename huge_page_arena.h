@@ -0,0 +1,255 @@
+#pragma once
+
+// === Huge-page backed memory arena ===
+// A large table that is looked up at random misses the TLB on most lookups
+// when it sits on 4 KiB pages. On 2 MiB pages one TLB entry covers 512 times
+// as much memory. The arena maps memory in 2 MiB-aligned chunks and, for each
+// chunk, tries in order:
+//   1. explicit huge pages (MAP_HUGETLB; needs pages reserved in
+//      /proc/sys/vm/nr_hugepages, fails otherwise),
+//   2. transparent huge pages (madvise(MADV_HUGEPAGE) on a 2 MiB-aligned
+//      region; only a hint, the kernel may still use small pages),
+//   3. regular pages.
+// Asking for RegularPages skips the first two and also opts the chunks out of
+// THP (MADV_NOHUGEPAGE), so a baseline on small pages is really on small pages.
+//
+// Allocation is a bump pointer, as in std::pmr::monotonic_buffer_resource:
+// memory handed back is only counted, and is released with the arena. That
+// suits a table built once and then only read; reserve() the table up front so
+// rehashing doesn't strand old bucket arrays. Not thread-safe.
+//
+// Usage:
+//
+//     huge_page_arena::Arena arena{};
+//     std::pmr::unordered_map<std::string, Record> table{&arena};
+//     table.reserve(users);
+//     ...
+//     arena.huge_page_coverage_percent();   // How much of it the kernel put on 2 MiB pages
+//
+// Linux only.
+
+#include <string>             // For std::string (smaps lines)
+#include <cstdint>            // For uintptr_t, uint64_t
+#include <cstdio>             // For std::sscanf()
+#include <algorithm>          // For std::max, std::min
+#include <fstream>            // For reading /proc/self/smaps
+#include <memory_resource>    // For std::pmr::memory_resource
+#include <new>                // For std::bad_alloc
+#include <vector>             // For the chunk list
+#include <sys/mman.h>         // For mmap(), munmap(), madvise()
+
+namespace huge_page_arena
+{
+    constexpr size_t HUGE_PAGE_SIZE{2 * 1024 * 1024};
+    constexpr size_t CHUNK_SIZE{64 * 1024 * 1024}; // Mapped per chunk; pages are touched on use
+
+    enum class Backing : uint8_t
+    {
+        ExplicitHugePages,
+        TransparentHugePages,
+        RegularPages,
+        Count
+    };
+    constexpr const char *BACKING_NAMES[]{"explicit huge pages", "transparent huge pages", "regular pages"};
+
+    class Arena : public std::pmr::memory_resource
+    {
+    public:
+        // `preferred` is the first backing tried for each chunk
+        explicit Arena(Backing preferred = Backing::ExplicitHugePages) : preferred_{preferred}
+        {
+        }
+
+        ~Arena() override
+        {
+            for (const Chunk &chunk : chunks_)
+            {
+                munmap(chunk.base, chunk.size);
+            }
+        }
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        // Bytes handed out, and how many of those were handed back (not reused)
+        size_t used_bytes() const
+        {
+            return used_bytes_;
+        }
+        size_t released_bytes() const
+        {
+            return released_bytes_;
+        }
+
+        // Chunks mapped with each backing
+        size_t chunk_count(Backing backing) const
+        {
+            return static_cast<size_t>(std::count_if(chunks_.begin(), chunks_.end(), [backing](const Chunk &chunk)
+                                                     { return chunk.backing == backing; }));
+        }
+
+        // The backing most of the used bytes got (the preferred one unless it failed)
+        Backing backing() const
+        {
+            size_t bytes[static_cast<size_t>(Backing::Count)]{};
+            for (const Chunk &chunk : chunks_)
+            {
+                bytes[static_cast<size_t>(chunk.backing)] += chunk.used;
+            }
+            return static_cast<Backing>(std::max_element(std::begin(bytes), std::end(bytes)) - std::begin(bytes));
+        }
+
+        // === Function: Share of the touched arena pages that are 2 MiB pages ===
+        // Explicit huge pages always are. For THP chunks this asks the kernel
+        // (AnonHugePages in /proc/self/smaps), since madvise() is only a hint and
+        // khugepaged may collapse more pages later. Touched means rounded up to
+        // whole huge pages, which is what the kernel can back with one.
+        uint64_t huge_page_coverage_percent() const
+        {
+            size_t touched{0};
+            size_t huge{0};
+            bool any_thp{false};
+            for (const Chunk &chunk : chunks_)
+            {
+                size_t chunk_touched{round_up(chunk.used, HUGE_PAGE_SIZE)};
+                touched += chunk_touched;
+                huge += chunk.backing == Backing::ExplicitHugePages ? chunk_touched : 0;
+                any_thp = any_thp || chunk.backing == Backing::TransparentHugePages;
+            }
+            if (touched == 0)
+            {
+                return 0;
+            }
+            if (any_thp)
+            {
+                huge += transparent_huge_bytes();
+            }
+            return std::min<uint64_t>(100, huge * 100 / touched);
+        }
+
+    private:
+        struct Chunk
+        {
+            char *base{nullptr};
+            size_t size{0};
+            size_t used{0};
+            Backing backing{Backing::RegularPages};
+        };
+
+        static size_t round_up(size_t value, size_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        // === Function: Map one 2 MiB-aligned chunk of at least `size` bytes ===
+        Chunk map_chunk(size_t size) const
+        {
+            Chunk chunk{};
+            chunk.size = round_up(size, HUGE_PAGE_SIZE);
+
+            if (preferred_ == Backing::ExplicitHugePages)
+            {
+                void *region{mmap(nullptr, chunk.size, PROT_READ | PROT_WRITE,
+                                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0)};
+                if (region != MAP_FAILED)
+                {
+                    chunk.base = static_cast<char *>(region);
+                    chunk.backing = Backing::ExplicitHugePages;
+                    return chunk;
+                }
+            }
+
+            // Over-map by one huge page, then trim both ends to a 2 MiB boundary
+            size_t mapped{chunk.size + HUGE_PAGE_SIZE};
+            void *region{mmap(nullptr, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)};
+            if (region == MAP_FAILED)
+            {
+                throw std::bad_alloc();
+            }
+            auto start{reinterpret_cast<uintptr_t>(region)};
+            auto aligned{round_up(start, HUGE_PAGE_SIZE)};
+            if (aligned > start)
+            {
+                munmap(region, aligned - start);
+            }
+            if (size_t tail{start + mapped - (aligned + chunk.size)}; tail > 0)
+            {
+                munmap(reinterpret_cast<char *>(aligned + chunk.size), tail);
+            }
+            chunk.base = reinterpret_cast<char *>(aligned);
+
+            chunk.backing = Backing::RegularPages;
+            if (preferred_ != Backing::RegularPages)
+            {
+                if (madvise(chunk.base, chunk.size, MADV_HUGEPAGE) == 0)
+                {
+                    chunk.backing = Backing::TransparentHugePages;
+                }
+            }
+            else
+            {
+                madvise(chunk.base, chunk.size, MADV_NOHUGEPAGE);
+            }
+            return chunk;
+        }
+
+        // === Function: AnonHugePages of the mappings that hold THP chunks ===
+        // Adjacent chunks with the same flags may be merged into one mapping, so
+        // every mapping that starts inside a THP chunk is counted once.
+        size_t transparent_huge_bytes() const
+        {
+            std::ifstream smaps{"/proc/self/smaps"};
+            std::string line{};
+            bool in_arena{false};
+            size_t bytes{0};
+            while (std::getline(smaps, line))
+            {
+                uintptr_t start{0};
+                uintptr_t end{0};
+                if (std::sscanf(line.c_str(), "%lx-%lx ", &start, &end) == 2 && line.find(':') > line.find(' '))
+                {
+                    in_arena = std::any_of(chunks_.begin(), chunks_.end(), [start](const Chunk &chunk)
+                                           {
+                                               auto base{reinterpret_cast<uintptr_t>(chunk.base)};
+                                               return chunk.backing == Backing::TransparentHugePages &&
+                                                      base <= start && start < base + chunk.size;
+                                           });
+                }
+                else if (unsigned long kib{0}; in_arena && std::sscanf(line.c_str(), "AnonHugePages: %lu kB", &kib) == 1)
+                {
+                    bytes += kib * 1024;
+                }
+            }
+            return bytes;
+        }
+
+        void *do_allocate(size_t bytes, size_t alignment) override
+        {
+            if (chunks_.empty() || round_up(chunks_.back().used, alignment) + bytes > chunks_.back().size)
+            {
+                // A request bigger than a chunk (a large bucket array) gets a chunk of its own
+                chunks_.push_back(map_chunk(std::max(CHUNK_SIZE, bytes + alignment)));
+            }
+            Chunk &chunk{chunks_.back()};
+            size_t offset{round_up(chunk.used, alignment)};
+            chunk.used = offset + bytes;
+            used_bytes_ += bytes;
+            return chunk.base + offset;
+        }
+
+        void do_deallocate(void *, size_t bytes, size_t) override
+        {
+            released_bytes_ += bytes;
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        const Backing preferred_;
+        std::vector<Chunk> chunks_{};
+        size_t used_bytes_{0};
+        size_t released_bytes_{0};
+    };
+}
@@ -1,11 +1,153 @@
 #include <iostream>     // For std::cout, std::cerr, std::string, etc.
 #include <string>       // For std::string
+#include <atomic>       // For std::atomic (per-account failure counters)
+#include <chrono>       // For std::chrono::steady_clock
+#include <cmath>        // For std::exp2() (counter decay)
+#include <algorithm>    // For std::min
+#include <functional>   // For std::hash (unknown usernames)
+#include <cerrno>       // For errno (read timeouts)
 #include <netinet/in.h> // For sockaddr_in, htons, bind(), listen(), etc.
+#include <sys/time.h>   // For timeval (SO_RCVTIMEO)
 #include <unistd.h>     // For read(), write(), close()
+#include "auth_token.h" // For minting bearer tokens after a successful login
 
 // Port the server will listen on
 constexpr int PORT{12345};
 
+// Clients are served one at a time, so a client that stops sending must not
+// hold the server: each read gives up after this long and the session ends
+constexpr int CLIENT_READ_TIMEOUT_SECONDS{10};
+
+// Bearer tokens handed out after a successful login (see auth_token.h).
+// Other services verify them locally with the same key file.
+const std::string TOKEN_KEY_FILE{"token_keys"};
+constexpr long long TOKEN_TTL_SECONDS{900};
+const std::string TOKEN_SCOPES{"read"};
+
+// Failed-attempt policy:
+// - every failure adds 1 to the account's score, which halves every FAILURE_HALF_LIFE_SECONDS
+// - once the score reaches LOCKOUT_THRESHOLD the account is locked for
+//   LOCKOUT_BASE_SECONDS, doubling with each further failure up to LOCKOUT_MAX_SECONDS
+constexpr double FAILURE_HALF_LIFE_SECONDS{300.0};
+constexpr double LOCKOUT_THRESHOLD{5.0};
+constexpr uint32_t LOCKOUT_BASE_SECONDS{1};
+constexpr uint32_t LOCKOUT_MAX_SECONDS{900};
+
+// Failures against usernames that don't exist are tracked too, in this many
+// shared slots (by hash of the name), so a lockout reply doesn't reveal
+// whether an account exists
+constexpr size_t UNKNOWN_USER_SLOTS{1024};
+
+// === Failed-attempt tracker ===
+// Each account's state is one 64-bit word updated with compare-and-swap:
+//   high 32 bits: failure score at the last failure (fixed point, 16 fractional bits)
+//   low 32 bits:  time of the last failure, in seconds of steady_clock
+// Memory is fixed at 8 bytes per account, and because every account has its
+// own word, a flood against one account never blocks updates to another.
+class FailureTracker
+{
+public:
+    // Seconds the account must still wait before it may try again (0 = allowed)
+    uint32_t lockout_remaining(uint32_t now) const
+    {
+        uint64_t word{state_.load(std::memory_order_acquire)};
+        double score{score_of(word)};
+        if (score < LOCKOUT_THRESHOLD)
+        {
+            return 0;
+        }
+
+        // Exponential backoff: base * 2^(failures past the threshold)
+        double doublings{std::min(score - LOCKOUT_THRESHOLD, 31.0)};
+        auto lockout{static_cast<uint32_t>(std::min<double>(LOCKOUT_BASE_SECONDS * std::exp2(doublings), LOCKOUT_MAX_SECONDS))};
+        uint32_t locked_until{time_of(word) + lockout};
+        return now < locked_until ? locked_until - now : 0;
+    }
+
+    void record_failure(uint32_t now)
+    {
+        uint64_t word{state_.load(std::memory_order_relaxed)};
+        uint64_t updated{};
+        do
+        {
+            // Decay the old score to "now", then count this failure
+            double elapsed{static_cast<double>(now - time_of(word))};
+            double score{score_of(word) * std::exp2(-elapsed / FAILURE_HALF_LIFE_SECONDS) + 1.0};
+            updated = pack(score, now);
+        } while (!state_.compare_exchange_weak(word, updated, std::memory_order_acq_rel, std::memory_order_relaxed));
+    }
+
+    void record_success()
+    {
+        state_.store(0, std::memory_order_release);
+    }
+
+private:
+    static constexpr double SCORE_SCALE{65536.0};
+
+    static double score_of(uint64_t word)
+    {
+        return static_cast<double>(word >> 32) / SCORE_SCALE;
+    }
+
+    static uint32_t time_of(uint64_t word)
+    {
+        return static_cast<uint32_t>(word);
+    }
+
+    static uint64_t pack(double score, uint32_t now)
+    {
+        double fixed{std::min(score * SCORE_SCALE, 4294967295.0)};
+        return (static_cast<uint64_t>(fixed) << 32) | now;
+    }
+
+    std::atomic<uint64_t> state_{0};
+};
+static_assert(sizeof(FailureTracker) == 8);
+
+// Entry in the credential table: the failure tracker lives next to the
+// credentials it protects, so no separate lookup or lock is needed
+struct Account
+{
+    const char *username;
+    const char *password;
+    FailureTracker failures{};
+};
+
+// Fixed credential table (the only demo account)
+Account ACCOUNTS[]{
+    {"admin", "pass123"},
+};
+
+// Failure trackers for names that aren't accounts (8 bytes each)
+FailureTracker UNKNOWN_USER_FAILURES[UNKNOWN_USER_SLOTS]{};
+
+// Find an account by name, or nullptr if it doesn't exist
+Account *find_account(const std::string &username)
+{
+    for (Account &account : ACCOUNTS)
+    {
+        if (username == account.username)
+        {
+            return &account;
+        }
+    }
+    return nullptr;
+}
+
+// The tracker for a username: the account's own, or a shared slot for unknown names
+FailureTracker &failures_for(Account *account, const std::string &username)
+{
+    return account ? account->failures : UNKNOWN_USER_FAILURES[std::hash<std::string>{}(username) % UNKNOWN_USER_SLOTS];
+}
+
+// Current time in whole seconds of the monotonic clock
+uint32_t now_seconds()
+{
+    auto since_boot{std::chrono::steady_clock::now().time_since_epoch()};
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(since_boot).count());
+}
+
 // Function to create, bind, and set up the server socket
 int create_server_socket()
 {
@@ -16,6 +158,10 @@ int create_server_socket()
         throw std::runtime_error("Socket creation failed");
     }
 
+    // Allow quick restarts while old connections are still in TIME_WAIT
+    int reuse{1};
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
     // Define the server address (IP: ANY, Port: PORT)
     sockaddr_in address{};
     address.sin_family = AF_INET;
@@ -28,8 +174,9 @@ int create_server_socket()
         throw std::runtime_error("Bind failed");
     }
 
-    // Listen for incoming connections (max 1 pending connection)
-    if (listen(sockfd, 1) < 0)
+    // Listen for incoming connections (queue as many as the kernel allows,
+    // so batch clients with many concurrent sessions aren't refused)
+    if (listen(sockfd, SOMAXCONN) < 0)
     {
         throw std::runtime_error("Listen failed");
     }
@@ -38,6 +185,7 @@ int create_server_socket()
 }
 
 // Read a message from a connected socket
+// Throws if the client sent nothing within CLIENT_READ_TIMEOUT_SECONDS
 std::string read_message(const int sock)
 {
     char buffer[1024]{};
@@ -47,6 +195,10 @@ std::string read_message(const int sock)
     {
         return std::string(buffer, bytes_read); // Return message as string
     }
+    else if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+        throw std::runtime_error("Client timed out");
+    }
     else
     {
         return std::string();
@@ -54,13 +206,15 @@ std::string read_message(const int sock)
 }
 
 // Send a message through the connected socket
+// MSG_NOSIGNAL: a client that already disconnected must not SIGPIPE the
+// server, which would also wipe every account's failure tracker
 void send_message(const int sock, const std::string &msg)
 {
-    send(sock, msg.c_str(), msg.length(), 0);
+    send(sock, msg.c_str(), msg.length(), MSG_NOSIGNAL);
 }
 
 // Handle client-server interaction
-void handle_client(const int client_sock)
+void handle_client(const int client_sock, const auth_token::TokenIssuer &issuer)
 {
     // Step 1: Initial greeting
     send_message(client_sock, "Hello. Send your greeting.");
@@ -71,49 +225,77 @@ void handle_client(const int client_sock)
     // Step 2: Ask for username
     send_message(client_sock, "Enter username:");
     std::string username{read_message(client_sock)};
+    Account *account{find_account(username)};
+    FailureTracker &failures{failures_for(account, username)};
 
-    // Step 3: Ask for password
+    // Step 3: Refuse locked names before even asking for the password. Unknown
+    // names are tracked and locked the same way, so the reply doesn't tell
+    // which accounts exist
+    if (uint32_t wait{failures.lockout_remaining(now_seconds())}; wait > 0)
+    {
+        send_message(client_sock, "Too many failed attempts. Try again in " + std::to_string(wait) + " seconds.");
+        return;
+    }
+
+    // Step 4: Ask for password
     send_message(client_sock, "Enter password:");
     std::string password{read_message(client_sock)};
 
-    // Step 4: Verify credentials
-    if (std::string response{}; username == "admin" && password == "pass123")
+    // Step 5: Verify credentials
+    if (std::string response{}; account && password == account->password)
     {
-        response = "Authentication successful.\n secret_data_from_server...";
+        account->failures.record_success();
+        response = "Authentication successful.\n token: " + issuer.issue(account->username, TOKEN_SCOPES, TOKEN_TTL_SECONDS);
         send_message(client_sock, response);
     }
     else
     {
+        failures.record_failure(now_seconds());
         response = "Authentication failed.";
         send_message(client_sock, response);
     }
-
-    // Step 6: Close client connection
-    close(client_sock);
 }
 
 int main()
 {
     try
     {
-        // Step 1: Create and set up server socket
+        // Step 1: Load (or create) the token signing key, then set up the server socket
+        auth_token::ensure_key_file(TOKEN_KEY_FILE);
+        const auth_token::TokenIssuer issuer{TOKEN_KEY_FILE};
+
         int server_sock{create_server_socket()};
         std::cout << "Server listening on port " << PORT << "...\n";
 
-        // Step 2: Accept one client connection
-        sockaddr_in client_addr{};
-        socklen_t addr_len{sizeof(client_addr)};
-        int client_sock{accept(server_sock, reinterpret_cast<sockaddr *>(&client_addr), &addr_len)};
-        if (client_sock < 0)
+        // Step 2: Accept client connections one after another, so failed
+        // attempts are tracked across connections
+        while (true)
         {
-            throw std::runtime_error("Accept failed");
-        }
+            sockaddr_in client_addr{};
+            socklen_t addr_len{sizeof(client_addr)};
+            int client_sock{accept(server_sock, reinterpret_cast<sockaddr *>(&client_addr), &addr_len)};
+            if (client_sock < 0)
+            {
+                std::cerr << "Accept failed\n";
+                continue;
+            }
 
-        // Step 3: Handle client interaction
-        handle_client(client_sock);
+            // Step 3: Handle client interaction; a silent or broken client
+            // only ends its own session
+            timeval timeout{CLIENT_READ_TIMEOUT_SECONDS, 0};
+            setsockopt(client_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            try
+            {
+                handle_client(client_sock, issuer);
+            }
+            catch (const std::exception &e)
+            {
+                std::cerr << "Client session error: " << e.what() << "\n";
+            }
 
-        // Step 4: Close the main server socket
-        close(server_sock);
+            // Step 4: Close client connection
+            close(client_sock);
+        }
     }
     catch (const std::exception &e)
     {
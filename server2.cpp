@@ -1,190 +1,4029 @@
 #include <iostream>       // For std::cout, std::cerr, std::string, etc.
 #include <string>         // For std::string
+#include <memory>         // For std::unique_ptr (OpenSSL context ownership)
+#include <algorithm>      // For std::copy
+#include <unordered_map>  // For the in-memory credential database
+#include <memory_resource> // For std::pmr (the credential table lives in a huge-page arena)
+#include <vector>         // For std::vector
+#include <atomic>         // For lock-free log ring indices
+#include <mutex>          // For std::mutex, std::lock_guard
+#include <tuple>          // For lock profiler report keys
+#include <thread>         // For the background log writer
+#include <chrono>         // For log flush interval and rate limiting
+#include <cstdio>         // For std::snprintf() in the log writer
+#include <cerrno>         // For errno
+#include <array>          // For std::array (CRC table)
+#include <ctime>          // For std::time() (audit log rotation suffix)
+#include <condition_variable> // For audit log group-commit waits (std::condition_variable_any)
+#include <fcntl.h>        // For open() flags
+#include <sys/stat.h>     // For fstat()
+#include <sys/uio.h>      // For pwritev(), iovec
+#include <climits>        // For IOV_MAX
+#include <sys/mman.h>     // For mlockall(), mmap()
+#include <fstream>        // For writing trace.json and profile.folded
+#include <map>            // For aggregating profiler stacks and the SCRAM verifier file
+#include <sstream>        // For parsing the SCRAM verifier file
+#include <optional>       // For std::optional (an account's Ed25519 key)
+#include <exception>      // For std::exception_ptr (errors handed back from a verification batch)
+#include <csignal>        // For sigaction(), SIGPROF
+#include <sys/time.h>     // For setitimer() – the profiler's sampling clock
+#include <execinfo.h>     // For backtrace() – unwinding sampled stacks
+#include <dlfcn.h>        // For dladdr() – naming sampled frames
+#include <cxxabi.h>       // For abi::__cxa_demangle()
+#include <arpa/inet.h>    // For INADDR_LOOPBACK
+#include <linux/perf_event.h> // For perf_event_attr – per-stage hardware counters
+#include <sys/syscall.h>  // For SYS_perf_event_open
+#include <linux/net_tstamp.h> // For SOF_TIMESTAMPING_* – kernel receive timestamps
+#include <linux/errqueue.h> // For scm_timestamping
+#include <linux/tcp.h>    // For TCP_INFO, tcp_info (with tcpi_delivery_rate)
+#include <poll.h>         // For poll() – parking idle workers
+#include <sched.h>        // For sched_yield()
 #include <netinet/in.h>   // For sockaddr_in, htons, INADDR_ANY, etc.
 #include <unistd.h>       // For POSIX socket functions: read(), write(), close()
-#include <openssl/hmac.h> // For HMAC (Hash-based Message Authentication Code)
+#include <openssl/evp.h>  // For EVP_Digest(), PKCS5_PBKDF2_HMAC()
+#include <openssl/crypto.h> // For OPENSSL_cleanse() – wiping key material
 #include <openssl/rand.h> // For RAND_bytes() – cryptographically secure RNG
+#include <openssl/pem.h>  // For PEM_read_PUBKEY() – loading Ed25519 public keys
+#include <dirent.h>       // For opendir() – finding provisioned Ed25519 public keys
+#include <termios.h>      // For tcgetattr() – reading the first-start password without echo
+#include "ed25519_batch.h" // Batched Ed25519 signature verification
+#include "hmac_midstate.h" // Precomputed, persistable HMAC key schedules
+#include "async_logger.h" // Per-thread binary log rings and the batching writer
+#include "huge_page_arena.h" // Huge-page backed memory for the credential table
 
 // === CONSTANTS ===
 
-// TCP port number that the server will bind to
+// TCP port number that the server will bind to (overridden by "./server2 <port>")
 constexpr int PORT{12345};
 
-// A secret key shared between client and server
-// It's never sent over the network — only used for hashing
-const std::string SHARED_SECRET{"pass123"};
+// Worker threads accepting and serving clients in parallel
+constexpr size_t WORKER_COUNT{4};
+
+// Warm-up: bytes of stack each worker touches up front, and whether to pin all
+// memory (current and future) with mlockall() so it's never paged out or faulted in
+constexpr size_t STACK_PREFAULT_BYTES{256 * 1024};
+constexpr bool LOCK_MEMORY{false};
+
+// Back the credential table with 2 MiB pages (explicit, else transparent; see
+// huge_page_arena.h). Off puts it on regular pages, opted out of THP.
+constexpr bool USE_HUGE_PAGES{true};
+
+// Random bytes fetched per RAND_bytes() call to serve many challenges from
+constexpr size_t CHALLENGE_POOL_BYTES{4096};
+
+// Ed25519 accounts are provisioned as "<username><ED25519_PUBKEY_SUFFIX>" (PEM)
+// in the working directory; client2 --ed25519 writes one for its account.
+// Such accounts hold only the public key: no shared secret, no SCRAM verifier.
+const std::string ED25519_PUBKEY_SUFFIX{".ed25519.pub"};
+constexpr size_t ED25519_SIGNATURE_SIZE{64};
+
+// Most Ed25519 signatures verified together in one multi-scalar multiplication.
+// The per-signature cost stops falling much beyond this (see auth_bench).
+constexpr size_t ED25519_MAX_BATCH{64};
+
+// User assumed when a client sends a bare "hello" without naming itself
+const std::string DEFAULT_USERNAME{"admin"};
+
+// Hello option carrying the client's deadline in milliseconds, counted from
+// when the kernel received the hello; longer deadlines are capped
+const std::string DEADLINE_OPTION{"deadline="};
+constexpr unsigned long MAX_DEADLINE_MS{60'000};
+
+// SCRAM mode: PBKDF2 parameters used when provisioning a user's StoredKey/ServerKey.
+// The iteration count only affects provisioning and the client, never verification.
+constexpr uint32_t SCRAM_ITERATIONS{4096};
+constexpr size_t SCRAM_SALT_SIZE{16};
+constexpr size_t SCRAM_KEY_SIZE{32}; // SHA-256
+
+// SCRAM verifiers, HMAC midstates (and the key for decoy salts) are generated
+// once, from a password read on stdin at first start, and kept in this file,
+// readable by its owner only. The password itself is never stored, and a
+// user's salt survives restarts.
+const std::string SCRAM_VERIFIER_FILE{"scram_verifiers"};
+constexpr size_t SCRAM_DECOY_KEY_SIZE{32};
+
+// Loopback-only port for operator commands (e.g. "profile 10"); see control_loop().
+// A server started on another port listens for commands on that port + 1.
+constexpr int CONTROL_PORT{12346};
+
+// Sampling profiler: SIGPROF rate (per second of process CPU time), deepest
+// stack kept, sample buffer size, longest allowed run and where folded stacks go
+constexpr int PROFILE_SAMPLE_HZ{1000};
+constexpr size_t PROFILE_MAX_DEPTH{48};
+constexpr size_t PROFILE_MAX_SAMPLES{64 * 1024};
+constexpr int PROFILE_DEFAULT_SECONDS{10};
+constexpr int PROFILE_MAX_SECONDS{60};
+const std::string PROFILE_OUTPUT_PATH{"profile.folded"};
+
+// Read hardware counters (perf_event_open) at every handshake stage boundary
+// from startup; otherwise only wall time is kept until "counters on"
+constexpr bool STAGE_HW_COUNTERS{false};
+
+// Session traces: events kept per session, 1-in-N sampling, recent sampled
+// sessions and slowest sessions kept per worker, and the export file
+constexpr size_t TRACE_MAX_EVENTS{48};
+constexpr uint64_t TRACE_SAMPLE_EVERY{100};
+constexpr size_t TRACE_RING_SESSIONS{64};
+constexpr size_t TRACE_SLOWEST_KEPT{16};
+const std::string TRACE_OUTPUT_PATH{"trace.json"};
+
+// Flight recorder: events kept per thread (power of two), most threads
+// recorded, and where dumps go
+constexpr size_t FLIGHT_RING_CAPACITY{4096};
+constexpr size_t FLIGHT_MAX_THREADS{64};
+constexpr const char *FLIGHT_DUMP_PATH{"flight_recorder.bin"};
+constexpr size_t FLIGHT_ALT_STACK_BYTES{64 * 1024}; // Per-thread signal stack, so a stack overflow can still dump
+constexpr auto FLIGHT_QUEUE_SAMPLE_INTERVAL{std::chrono::seconds(1)}; // Accept queue depth sampling
+
+// Sessions (per worker) whose TCP_INFO is sampled at close: 1 in N, plus any
+// session whose trace is going to be kept as one of the slowest
+constexpr uint64_t TCP_INFO_SAMPLE_EVERY{10};
+
+// Buckets in every log2 histogram (bucket k holds values below 2^k)
+constexpr size_t HISTOGRAM_BUCKETS{40};
+
+// Lock profiler: record from startup (otherwise only after "locks on"),
+// distinct (mutex, call site) pairs tracked per thread, sites in the report
+constexpr bool LOCK_PROFILING{false};
+constexpr size_t LOCK_SITES_PER_THREAD{32};
+constexpr size_t LOCK_REPORT_TOP{10};
+
+// Average kernel-to-read delay of hello frames above which the overload
+// controller demands (minimum difficulty) puzzles even if the hello rate looks normal
+constexpr uint64_t QUEUEING_DELAY_THRESHOLD_NS{20'000'000};
+
+// Owning pointers for OpenSSL digest algorithms and keys
+using EvpMdPtr = std::unique_ptr<EVP_MD, decltype(&EVP_MD_free)>;
+using EvpPkeyPtr = std::unique_ptr<EVP_PKEY, decltype(&EVP_PKEY_free)>;
+using FilePtr = std::unique_ptr<FILE, decltype(&fclose)>;
+
+// === HISTOGRAMS ===
+// Lock-free log2 histogram: bucket k counts values in [2^(k-1), 2^k).
+// Percentiles are reported as the upper bound of their bucket.
+class Histogram
+{
+public:
+    void record(const uint64_t value)
+    {
+        size_t bucket{value == 0 ? 0 : static_cast<size_t>(64 - __builtin_clzll(value))};
+        bucket = std::min(bucket, HISTOGRAM_BUCKETS - 1);
+        buckets_[bucket].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+        raise_max(value);
+    }
+
+    // Adds another histogram's samples to this one (e.g. merging per-thread ones)
+    void add(const Histogram &other)
+    {
+        for (size_t i{0}; i < HISTOGRAM_BUCKETS; ++i)
+        {
+            buckets_[i].fetch_add(other.buckets_[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        sum_.fetch_add(other.sum(), std::memory_order_relaxed);
+        raise_max(other.max_.load(std::memory_order_relaxed));
+    }
+
+    void reset()
+    {
+        for (auto &bucket : buckets_)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        sum_.store(0, std::memory_order_relaxed);
+        max_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const
+    {
+        uint64_t total{0};
+        for (const auto &bucket : buckets_)
+        {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    uint64_t sum() const
+    {
+        return sum_.load(std::memory_order_relaxed);
+    }
+
+    // Upper bound of the bucket holding the given fraction of samples
+    uint64_t percentile(const double fraction) const
+    {
+        auto wanted{std::max<uint64_t>(static_cast<uint64_t>(fraction * static_cast<double>(count()) + 0.5), 1)};
+        uint64_t seen{0};
+        size_t bucket{0};
+        while (bucket + 1 < HISTOGRAM_BUCKETS && (seen += buckets_[bucket].load(std::memory_order_relaxed)) < wanted)
+        {
+            bucket++;
+        }
+        return bucket == 0 ? 0 : (uint64_t{1} << bucket) - 1;
+    }
+
+    // e.g. "queueing_us n=120 mean=35 p50<=32 p90<=64 p99<=128 max=97"
+    std::string report(const std::string &name, const uint64_t divisor = 1) const
+    {
+        uint64_t total{count()};
+        std::string out{name + " n=" + std::to_string(total)};
+        if (total == 0)
+        {
+            return out;
+        }
+        out += " mean=" + std::to_string(sum() / total / divisor);
+        out += " p50<=" + std::to_string(percentile(0.50) / divisor);
+        out += " p90<=" + std::to_string(percentile(0.90) / divisor);
+        out += " p99<=" + std::to_string(percentile(0.99) / divisor);
+        out += " max=" + std::to_string(max_.load(std::memory_order_relaxed) / divisor);
+        return out;
+    }
+
+private:
+    void raise_max(const uint64_t value)
+    {
+        uint64_t max{max_.load(std::memory_order_relaxed)};
+        while (value > max && !max_.compare_exchange_weak(max, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    std::atomic<uint64_t> buckets_[HISTOGRAM_BUCKETS]{};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// === LOCK PROFILER ===
+// Shared structures are guarded by ProfiledMutex and locked through
+// ProfiledLock, which remembers where it was taken (__builtin_FILE/LINE at the
+// guard's construction). While profiling is on ("locks on" control command,
+// or LOCK_PROFILING at build time) every acquisition records its wait and
+// hold times into histograms owned by the locking thread, keyed by
+// (mutex, call site). "locks" merges them and ranks sites by total wait.
+// When off, a lock costs one relaxed load more than a plain std::mutex.
+
+class ProfiledMutex
+{
+public:
+    explicit ProfiledMutex(const char *name) : name_{name}
+    {
+    }
+
+    ProfiledMutex(const ProfiledMutex &) = delete;
+    ProfiledMutex &operator=(const ProfiledMutex &) = delete;
+
+    void lock()
+    {
+        mutex_.lock();
+    }
+
+    bool try_lock()
+    {
+        return mutex_.try_lock();
+    }
+
+    void unlock()
+    {
+        mutex_.unlock();
+    }
+
+    const char *name() const
+    {
+        return name_;
+    }
+
+private:
+    std::mutex mutex_{};
+    const char *name_;
+};
+
+// Statistics of one (mutex, call site) pair on one thread
+struct LockSiteStats
+{
+    const char *mutex{nullptr};
+    const char *file{nullptr};
+    unsigned line{0};
+    std::atomic<uint64_t> contended{0}; // Acquisitions that had to wait
+    Histogram wait_ns{};                // One sample per acquisition
+    Histogram hold_ns{};
+};
+
+class LockProfiler
+{
+public:
+    bool enabled() const
+    {
+        return enabled_.load(std::memory_order_relaxed);
+    }
+
+    void set_enabled(const bool enabled)
+    {
+        enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    // The calling thread's entry for this site; nullptr once its table is full
+    LockSiteStats *site(const char *mutex, const char *file, const unsigned line)
+    {
+        ThreadSites &sites{thread_sites()};
+        size_t used{sites.used.load(std::memory_order_relaxed)};
+        for (size_t i{0}; i < used; ++i)
+        {
+            LockSiteStats &entry{sites.entries[i]};
+            if (entry.line == line && entry.mutex == mutex && entry.file == file)
+            {
+                return &entry;
+            }
+        }
+        if (used == LOCK_SITES_PER_THREAD)
+        {
+            return nullptr;
+        }
+        LockSiteStats &entry{sites.entries[used]};
+        entry.mutex = mutex;
+        entry.file = file;
+        entry.line = line;
+        sites.used.store(used + 1, std::memory_order_release); // Publish to report()
+        return &entry;
+    }
+
+    void reset()
+    {
+        for (const auto &thread : threads())
+        {
+            size_t used{thread->used.load(std::memory_order_acquire)};
+            for (size_t i{0}; i < used; ++i)
+            {
+                thread->entries[i].contended.store(0, std::memory_order_relaxed);
+                thread->entries[i].wait_ns.reset();
+                thread->entries[i].hold_ns.reset();
+            }
+        }
+    }
+
+    // Worst LOCK_REPORT_TOP call sites by total wait time, across all threads
+    std::string report()
+    {
+        struct Merged
+        {
+            uint64_t contended{0};
+            Histogram wait_ns{};
+            Histogram hold_ns{};
+        };
+        std::map<std::tuple<std::string, std::string, unsigned>, Merged> merged{};
+        for (const auto &thread : threads())
+        {
+            size_t used{thread->used.load(std::memory_order_acquire)};
+            for (size_t i{0}; i < used; ++i)
+            {
+                const LockSiteStats &entry{thread->entries[i]};
+                Merged &site{merged[{entry.mutex, entry.file, entry.line}]};
+                site.contended += entry.contended.load(std::memory_order_relaxed);
+                site.wait_ns.add(entry.wait_ns);
+                site.hold_ns.add(entry.hold_ns);
+            }
+        }
+
+        std::vector<std::pair<const std::tuple<std::string, std::string, unsigned> *, const Merged *>> ranked{};
+        for (const auto &[key, site] : merged)
+        {
+            ranked.emplace_back(&key, &site);
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const auto &a, const auto &b)
+                  { return a.second->wait_ns.sum() > b.second->wait_ns.sum(); });
+
+        std::string out{std::string("lock profiling: ") + (enabled() ? "on" : "off")};
+        char line[200]{};
+        std::snprintf(line, sizeof(line), "\n%-16s %-18s %10s %10s %12s %11s %11s %11s", "mutex", "site", "acquired",
+                      "contended", "wait_tot_us", "wait_p99_us", "hold_avg_us", "hold_p99_us");
+        out += line;
+        for (size_t i{0}; i < std::min(ranked.size(), LOCK_REPORT_TOP); ++i)
+        {
+            const auto &[mutex, file, site_line]{*ranked[i].first};
+            const Merged &site{*ranked[i].second};
+            uint64_t acquired{site.wait_ns.count()};
+            std::string where{file.substr(file.find_last_of('/') + 1) + ":" + std::to_string(site_line)};
+            std::snprintf(line, sizeof(line), "\n%-16s %-18s %10lu %10lu %12lu %11.1f %11.2f %11.1f", mutex.c_str(),
+                          where.c_str(), static_cast<unsigned long>(acquired), static_cast<unsigned long>(site.contended),
+                          static_cast<unsigned long>(site.wait_ns.sum() / 1000),
+                          static_cast<double>(site.wait_ns.percentile(0.99)) / 1000.0,
+                          acquired == 0 ? 0.0 : static_cast<double>(site.hold_ns.sum()) / static_cast<double>(acquired) / 1000.0,
+                          static_cast<double>(site.hold_ns.percentile(0.99)) / 1000.0);
+            out += line;
+        }
+        return out;
+    }
+
+private:
+    struct ThreadSites
+    {
+        std::atomic<size_t> used{0};
+        LockSiteStats entries[LOCK_SITES_PER_THREAD]{};
+    };
+
+    // The registry itself uses a plain mutex so it never profiles itself
+    ThreadSites &thread_sites()
+    {
+        thread_local std::shared_ptr<ThreadSites> sites{};
+        if (!sites)
+        {
+            sites = std::make_shared<ThreadSites>();
+            std::lock_guard<std::mutex> lock{threads_mutex_};
+            threads_.push_back(sites);
+        }
+        return *sites;
+    }
+
+    std::vector<std::shared_ptr<ThreadSites>> threads()
+    {
+        std::lock_guard<std::mutex> lock{threads_mutex_};
+        return threads_;
+    }
+
+    std::atomic<bool> enabled_{LOCK_PROFILING};
+    std::mutex threads_mutex_{};
+    std::vector<std::shared_ptr<ThreadSites>> threads_{};
+};
+
+// === FUNCTION: Access the process-wide lock profiler ===
+// Never destroyed: other singletons still take locks in their destructors
+LockProfiler &lock_profiler()
+{
+    static LockProfiler *instance{new LockProfiler{}};
+    return *instance;
+}
+
+// Scoped lock on a ProfiledMutex. Also BasicLockable, so it can be handed to
+// std::condition_variable_any, whose waits then count as unlock + lock here.
+class ProfiledLock
+{
+public:
+    explicit ProfiledLock(ProfiledMutex &mutex, const char *file = __builtin_FILE(), const unsigned line = __builtin_LINE())
+        : mutex_{mutex}, site_{lock_profiler().enabled() ? lock_profiler().site(mutex.name(), file, line) : nullptr}
+    {
+        lock();
+    }
+
+    ~ProfiledLock()
+    {
+        if (owns_)
+        {
+            unlock();
+        }
+    }
+
+    ProfiledLock(const ProfiledLock &) = delete;
+    ProfiledLock &operator=(const ProfiledLock &) = delete;
+
+    void lock()
+    {
+        if (site_ == nullptr)
+        {
+            mutex_.lock();
+        }
+        else if (mutex_.try_lock())
+        {
+            site_->wait_ns.record(0);
+            acquired_ = std::chrono::steady_clock::now();
+        }
+        else
+        {
+            auto started{std::chrono::steady_clock::now()};
+            mutex_.lock();
+            acquired_ = std::chrono::steady_clock::now();
+            site_->contended.fetch_add(1, std::memory_order_relaxed);
+            site_->wait_ns.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(acquired_ - started).count()));
+        }
+        owns_ = true;
+    }
+
+    void unlock()
+    {
+        if (site_ != nullptr)
+        {
+            site_->hold_ns.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                            std::chrono::steady_clock::now() - acquired_)
+                                                            .count()));
+        }
+        owns_ = false;
+        mutex_.unlock();
+    }
+
+private:
+    ProfiledMutex &mutex_;
+    LockSiteStats *site_;
+    std::chrono::steady_clock::time_point acquired_{};
+    bool owns_{false};
+};
+
+// === ASYNC LOGGER ===
+// Writing to std::cout on the request path takes the iostream lock and blocks
+// on the terminal. Instead, each thread appends fixed-size binary records to
+// its own ring and a background thread formats and writes them in batches
+// (async_logger.h, also timed by auth_bench).
+
+// Pre-registered log formats. Every format receives (text length, text, number)
+// in that order, so a format may use "%.*s" and/or "%lu"; text beyond
+// async_log::TEXT_CAPACITY bytes is printed cut, with a "..." marker.
+enum class LogFormat : uint16_t
+{
+    ServerListening,
+    ClientHello,
+    ClientError,
+    AcceptFailed,
+    AuditError,
+    ServerReady,
+    MlockFailed,
+    ControlListening,
+    CredentialTable,
+    Count
+};
+
+constexpr const char *LOG_FORMATS[]{
+    "Server listening on port %.*s%lu...\n",
+    "Client: %.*s\n",
+    "Client session error: %.*s\n",
+    "Accept failed: %.*serrno %lu\n",
+    "Audit log %.*s%lu\n",
+    "Server ready: %.*s%lu us from start to listening\n",
+    "mlockall failed (continuing unlocked): %.*serrno %lu\n",
+    "Control channel on 127.0.0.1:%.*s%lu\n",
+    "Credential table: %.*s%lu%% huge page coverage\n",
+};
+static_assert(sizeof(LOG_FORMATS) / sizeof(LOG_FORMATS[0]) == static_cast<size_t>(LogFormat::Count));
+
+// Per-format rate limit (records per second per thread) and sampling (keep 1 in N)
+constexpr uint32_t LOG_RATE_LIMIT_PER_SEC{10000};
+constexpr uint32_t LOG_SAMPLE_EVERY{1};
+
+// How often the writer drains the per-thread rings
+constexpr auto LOG_FLUSH_INTERVAL{std::chrono::milliseconds(10)};
+
+using AsyncLogger = async_log::Logger<LogFormat, ProfiledMutex, ProfiledLock>;
+
+// === FUNCTION: Access the process-wide logger ===
+AsyncLogger &logger()
+{
+    static AsyncLogger instance{LOG_FORMATS, {STDOUT_FILENO, LOG_RATE_LIMIT_PER_SEC, LOG_SAMPLE_EVERY, LOG_FLUSH_INTERVAL}};
+    return instance;
+}
+
+// === FLIGHT RECORDER ===
+// Always on: every thread appends small fixed-size binary events (accepts,
+// verdicts, errors, hello rate, audit commits, queue depths) to its own ring,
+// overwriting the oldest. Nothing is formatted or written until a dump is
+// requested with SIGUSR2 (or the "dump" control command) or the process
+// crashes; the dump copies every ring verbatim to FLIGHT_DUMP_PATH using only
+// async-signal-safe calls. Decode it with flight_decoder.cpp.
+//
+// Rings are allocated when a thread first records or registers, never from
+// the signal handler, which only reads rings that already exist. Registered
+// threads also get an alternate signal stack, so a SIGSEGV from a stack
+// overflow can still dump.
+
+constexpr uint32_t FLIGHT_DUMP_MAGIC{0x464C5231}; // "FLR1"
+constexpr uint32_t FLIGHT_DUMP_VERSION{1};
+
+// Layout is part of the dump format; keep flight_decoder.cpp in sync
+enum class FlightEvent : uint16_t
+{
+    Start = 1,
+    Listening,
+    Accept,       // a = peer IPv4
+    AcceptFailed, // a = errno
+    Verdict,      // a = peer IPv4, b = AuditVerdict, c = session ns
+    Rejected,     // a = peer IPv4 (puzzle not solved)
+    SessionError, // a = peer IPv4
+    HelloRate,    // b = hellos in the last second
+    AuditCommit,  // a = records, b = bytes, c = write + flush ns
+    AuditRotate,
+    Dump,            // Requested by the control command (signal dumps are in the header)
+    DeadlineExceeded, // a = peer IPv4, b = DeadlineCheck where the session was dropped
+    QueueDepth,       // a = FlightQueue, b = entries waiting, c = limit (0 = unbounded)
+};
+
+// Queues whose depth is recorded
+enum class FlightQueue : uint32_t
+{
+    Accept = 1,   // Listen backlog, sampled once per FLIGHT_QUEUE_SAMPLE_INTERVAL
+    Ed25519Batch, // Signatures waiting when a batch was taken; c = batch size
+};
+
+struct FlightRecord
+{
+    uint64_t ns{0}; // CLOCK_MONOTONIC
+    FlightEvent type{};
+    uint16_t reserved{0};
+    uint32_t a{0};
+    uint64_t b{0};
+    uint64_t c{0};
+};
+static_assert(sizeof(FlightRecord) == 32);
+
+// Written only by its thread; head counts every record ever written
+struct FlightRing
+{
+    char name[16]{};
+    uint32_t tid{0};
+    uint32_t reserved{0};
+    std::atomic<uint64_t> head{0};
+    FlightRecord records[FLIGHT_RING_CAPACITY]{};
+};
+
+// Dump file: FlightDumpHeader, then per thread a FlightThreadHeader followed
+// by FLIGHT_RING_CAPACITY raw records
+struct FlightDumpHeader
+{
+    uint32_t magic{FLIGHT_DUMP_MAGIC};
+    uint32_t version{FLIGHT_DUMP_VERSION};
+    uint32_t record_size{sizeof(FlightRecord)};
+    uint32_t ring_capacity{FLIGHT_RING_CAPACITY};
+    uint32_t thread_count{0};
+    uint32_t signal{0};
+    uint64_t monotonic_ns{0}; // Clocks at dump time, to map records to wall time
+    uint64_t realtime_ns{0};
+};
+
+struct FlightThreadHeader
+{
+    char name[16]{};
+    uint32_t tid{0};
+    uint32_t reserved{0};
+    uint64_t head{0};
+};
+
+class FlightRecorder
+{
+public:
+    // Hot path: a few stores into this thread's ring
+    void record(const FlightEvent type, const uint32_t a = 0, const uint64_t b = 0, const uint64_t c = 0)
+    {
+        FlightRing *ring{thread_ring()};
+        if (ring == nullptr)
+        {
+            return;
+        }
+        uint64_t head{ring->head.load(std::memory_order_relaxed)};
+        FlightRecord &record{ring->records[head & (FLIGHT_RING_CAPACITY - 1)]};
+        record.ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                              std::chrono::steady_clock::now().time_since_epoch())
+                                              .count());
+        record.type = type;
+        record.a = a;
+        record.b = b;
+        record.c = c;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    // Names the calling thread's ring in dumps (creates it if needed) and
+    // gives the thread its alternate signal stack
+    void register_thread(const char *name)
+    {
+        if (FlightRing *ring{thread_ring()}; ring != nullptr)
+        {
+            std::snprintf(ring->name, sizeof(ring->name), "%s", name);
+        }
+        install_alt_stack();
+    }
+
+    // Async-signal-safe: open/write/close and clock_gettime only, on rings
+    // that already exist; it records nothing and allocates nothing. A record
+    // being written by an interrupted thread may come out torn.
+    void dump(const int signal)
+    {
+        if (dumping_.test_and_set(std::memory_order_acquire))
+        {
+            return; // A crash during a dump must not recurse
+        }
+
+        int fd{open(FLIGHT_DUMP_PATH, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)};
+        if (fd >= 0)
+        {
+            FlightDumpHeader header{};
+            size_t count{std::min(ring_count_.load(std::memory_order_acquire), FLIGHT_MAX_THREADS)};
+            header.thread_count = static_cast<uint32_t>(count);
+            header.signal = static_cast<uint32_t>(signal);
+            timespec now{};
+            clock_gettime(CLOCK_MONOTONIC, &now);
+            header.monotonic_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+            clock_gettime(CLOCK_REALTIME, &now);
+            header.realtime_ns = static_cast<uint64_t>(now.tv_sec) * 1000000000 + static_cast<uint64_t>(now.tv_nsec);
+            write_all(fd, &header, sizeof(header));
+
+            for (size_t i{0}; i < count; ++i)
+            {
+                FlightRing *ring{rings_[i].load(std::memory_order_acquire)};
+                FlightThreadHeader thread{};
+                if (ring != nullptr)
+                {
+                    std::copy_n(ring->name, sizeof(thread.name), thread.name);
+                    thread.tid = ring->tid;
+                    thread.head = ring->head.load(std::memory_order_acquire);
+                }
+                write_all(fd, &thread, sizeof(thread));
+                write_all(fd, ring != nullptr ? ring->records : empty_.records, sizeof(empty_.records));
+            }
+            close(fd);
+        }
+        dumping_.clear(std::memory_order_release);
+    }
+
+private:
+    static void write_all(const int fd, const void *data, size_t length)
+    {
+        const char *bytes{static_cast<const char *>(data)};
+        while (length > 0)
+        {
+            ssize_t written{write(fd, bytes, length)};
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return;
+            }
+            bytes += written;
+            length -= static_cast<size_t>(written);
+        }
+    }
+
+    // The handler runs on this stack (SA_ONSTACK) instead of the thread's own,
+    // which may be the very thing that overflowed. Released when the thread exits.
+    static void install_alt_stack()
+    {
+        struct AltStack
+        {
+            void *base{mmap(nullptr, FLIGHT_ALT_STACK_BYTES, PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0)};
+
+            AltStack()
+            {
+                if (base != MAP_FAILED)
+                {
+                    stack_t stack{};
+                    stack.ss_sp = base;
+                    stack.ss_size = FLIGHT_ALT_STACK_BYTES;
+                    sigaltstack(&stack, nullptr);
+                }
+            }
+
+            ~AltStack()
+            {
+                if (base != MAP_FAILED)
+                {
+                    stack_t disabled{};
+                    disabled.ss_flags = SS_DISABLE;
+                    sigaltstack(&disabled, nullptr);
+                    munmap(base, FLIGHT_ALT_STACK_BYTES);
+                }
+            }
+        };
+        thread_local AltStack stack{};
+        (void)stack;
+    }
+
+    // Rings are never freed, so a dump can always read them. Threads beyond
+    // FLIGHT_MAX_THREADS are not recorded.
+    FlightRing *thread_ring()
+    {
+        thread_local FlightRing *ring{nullptr};
+        thread_local bool registered{false};
+        if (!registered)
+        {
+            registered = true;
+            size_t slot{ring_count_.fetch_add(1, std::memory_order_acq_rel)};
+            if (slot < FLIGHT_MAX_THREADS)
+            {
+                ring = new FlightRing{};
+                std::snprintf(ring->name, sizeof(ring->name), "thread");
+                ring->tid = static_cast<uint32_t>(gettid());
+                rings_[slot].store(ring, std::memory_order_release);
+            }
+        }
+        return ring;
+    }
+
+    std::atomic<FlightRing *> rings_[FLIGHT_MAX_THREADS]{};
+    std::atomic<size_t> ring_count_{0};
+    std::atomic_flag dumping_ = ATOMIC_FLAG_INIT;
+    FlightRing empty_{}; // Stands in for a slot still being registered
+};
+
+// === FUNCTION: Access the process-wide flight recorder ===
+FlightRecorder &flight_recorder()
+{
+    static FlightRecorder instance{};
+    return instance;
+}
+
+// === FUNCTION: Dump the flight recorder from a signal ===
+// SIGUSR2 dumps and carries on; fatal signals dump, then re-raise with the
+// default action so the process still dies (and cores) as it would have.
+void on_flight_signal(const int signal)
+{
+    int saved_errno{errno};
+    flight_recorder().dump(signal);
+    if (signal != SIGUSR2)
+    {
+        std::signal(signal, SIG_DFL);
+        raise(signal);
+    }
+    errno = saved_errno;
+}
+
+// === FUNCTION: Install the flight recorder's signal handlers ===
+void install_flight_recorder()
+{
+    flight_recorder().register_thread("main");
+    for (int signal : {SIGUSR2, SIGSEGV, SIGBUS, SIGFPE, SIGILL, SIGABRT})
+    {
+        struct sigaction action{};
+        action.sa_handler = on_flight_signal;
+        action.sa_flags = SA_RESTART | SA_ONSTACK;
+        sigemptyset(&action.sa_mask);
+        sigaction(signal, &action, nullptr);
+    }
+}
+
+// === AUDIT LOG ===
+// Every authentication verdict is persisted to an append-only binary log.
+// Workers append fixed-size, CRC-protected records to per-thread buffers; a
+// single writer thread collects all buffers and commits them with one
+// pwritev() + fdatasync() per interval (group commit), so the cost of a disk
+// flush is shared by every verdict in the batch. Use audit_reader to replay it.
+
+constexpr const char *AUDIT_LOG_PATH{"auth_audit.log"};
+constexpr off_t AUDIT_ROTATE_BYTES{64 * 1024 * 1024};          // Start a new file past this size
+constexpr auto AUDIT_COMMIT_INTERVAL{std::chrono::milliseconds(5)}; // Max wait between group commits
+constexpr int AUDIT_COMMIT_ATTEMPTS{3};                        // Writes + flushes tried before a batch is lost
+constexpr auto AUDIT_RETRY_BACKOFF{std::chrono::milliseconds(2)}; // Times the attempt number
+constexpr uint32_t AUDIT_RECORD_MAGIC{0x41554431};             // "AUD1"
+
+// When AuditLog::append() returns to the caller. Durable puts the group
+// commit's fdatasync on every handshake's path: on a local ext4 disk that adds
+// about 0.1 ms to the median handshake, and the disk's flush outliers
+// (several ms) reach the tail. Switch at runtime with "audit <mode>".
+enum class AuditAck
+{
+    Buffered, // Record queued in memory; may be lost on crash
+    Written,  // Record handed to the kernel (survives a process crash)
+    Durable   // Record flushed to stable storage (survives power loss)
+};
+constexpr AuditAck AUDIT_ACK_DEFAULT{AuditAck::Durable};
+constexpr const char *AUDIT_ACK_NAMES[]{"buffered", "written", "durable"}; // Indexed by AuditAck
+
+enum class AuditVerdict : uint8_t
+{
+    Success = 1,
+    Failure = 2,
+};
+
+// On-disk record; crc32 covers every byte after the crc32 field
+struct AuditRecord
+{
+    uint32_t magic{AUDIT_RECORD_MAGIC};
+    uint32_t crc32{0};
+    uint64_t sequence{0};
+    uint64_t timestamp_ns{0}; // CLOCK_REALTIME
+    uint8_t verdict{0};
+    uint8_t username_len{0};
+    uint16_t reserved{0};
+    uint32_t peer_ipv4{0};    // Network byte order
+    char username[32]{};
+};
+static_assert(sizeof(AuditRecord) == 64);
+
+// === FUNCTION: CRC-32 (IEEE 802.3) ===
+uint32_t crc32(const unsigned char *data, size_t length)
+{
+    static const auto table{[]
+                            {
+                                std::array<uint32_t, 256> t{};
+                                for (uint32_t i{0}; i < 256; ++i)
+                                {
+                                    uint32_t c{i};
+                                    for (int k{0}; k < 8; ++k)
+                                    {
+                                        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                                    }
+                                    t[i] = c;
+                                }
+                                return t;
+                            }()};
+
+    uint32_t crc{0xFFFFFFFFu};
+    for (size_t i{0}; i < length; ++i)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+class AuditLog
+{
+public:
+    AuditLog()
+    {
+        // The writer reports errors through the logger, so make sure it is
+        // constructed first (and therefore destroyed after us)
+        logger();
+        open_file();
+
+        // Continue the sequence from the last record of an existing log
+        AuditRecord last{};
+        if (offset_ >= static_cast<off_t>(sizeof(last)) &&
+            pread(fd_, &last, sizeof(last), offset_ - static_cast<off_t>(sizeof(last))) == sizeof(last) &&
+            last.magic == AUDIT_RECORD_MAGIC)
+        {
+            next_sequence_.store(last.sequence + 1, std::memory_order_relaxed);
+        }
+        writer_ = std::thread{[this]
+                              { run(); }};
+    }
+
+    ~AuditLog()
+    {
+        {
+            ProfiledLock lock{commit_mutex_};
+            stop_ = true;
+        }
+        wake_writer_.notify_one();
+        writer_.join();
+        close(fd_);
+    }
+
+    // Queue one verdict; blocks according to the ack mode. Unless the mode is
+    // Buffered, throws if the batch holding the record could not be committed,
+    // so the caller never reports a verdict the log does not have.
+    void append(AuditVerdict verdict, const std::string &username, uint32_t peer_ipv4)
+    {
+        AuditAck ack{ack_mode_.load(std::memory_order_relaxed)};
+        AuditRecord record{};
+        record.sequence = next_sequence_.fetch_add(1, std::memory_order_relaxed);
+        record.timestamp_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        record.verdict = static_cast<uint8_t>(verdict);
+        record.username_len = static_cast<uint8_t>(std::min(username.length(), sizeof(record.username)));
+        record.peer_ipv4 = peer_ipv4;
+        std::copy_n(username.data(), record.username_len, record.username);
+        record.crc32 = crc32(reinterpret_cast<const unsigned char *>(&record) + 8, sizeof(record) - 8);
+
+        Buffer &buffer{thread_buffer()};
+        uint64_t generation{0};
+        {
+            ProfiledLock lock{buffer.mutex};
+            buffer.pending.push_back(record);
+            generation = buffer.generation;
+        }
+
+        if (ack == AuditAck::Buffered)
+        {
+            return;
+        }
+
+        // Wait until the writer has committed (or given up on) the batch our record went into
+        ProfiledLock lock{commit_mutex_};
+        waiters_++;
+        wake_writer_.notify_one();
+        committed_.wait(lock, [&]
+                        { return buffer.committed.load(std::memory_order_acquire) > generation ||
+                                 buffer.lost.load(std::memory_order_acquire) > generation || stop_; });
+        waiters_--;
+        if (buffer.committed.load(std::memory_order_acquire) <= generation)
+        {
+            throw std::runtime_error("Audit log commit failed; verdict not recorded");
+        }
+    }
+
+    // Creates the calling thread's buffer ahead of its first append
+    void register_thread()
+    {
+        thread_buffer().pending.reserve(64);
+    }
+
+    // Applies to appends from now on; Written also stops the writer's fdatasync
+    void set_ack_mode(AuditAck ack)
+    {
+        ack_mode_.store(ack, std::memory_order_relaxed);
+    }
+
+    AuditAck ack_mode() const
+    {
+        return ack_mode_.load(std::memory_order_relaxed);
+    }
+
+private:
+    // Records appended by one thread since the writer last collected them.
+    // generation counts collections that took records; committed is the last
+    // generation on disk and lost the last one the writer gave up on. A buffer
+    // is only collected when it has records, so the thread waiting on it (its
+    // only writer) finds its own generation in one of the two.
+    struct Buffer
+    {
+        ProfiledMutex mutex{"audit.buffer"};
+        std::vector<AuditRecord> pending{};
+        uint64_t generation{0};
+        std::atomic<uint64_t> committed{0};
+        std::atomic<uint64_t> lost{0};
+    };
+
+    using Batch = std::vector<std::pair<std::shared_ptr<Buffer>, std::vector<AuditRecord>>>;
+
+    Buffer &thread_buffer()
+    {
+        thread_local std::shared_ptr<Buffer> buffer{};
+        if (!buffer)
+        {
+            buffer = std::make_shared<Buffer>();
+            ProfiledLock lock{buffers_mutex_};
+            buffers_.push_back(buffer);
+        }
+        return *buffer;
+    }
+
+    void open_file()
+    {
+        fd_ = open(AUDIT_LOG_PATH, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        if (fd_ < 0)
+        {
+            throw std::runtime_error("Failed to open audit log");
+        }
+        struct stat st{};
+        if (fstat(fd_, &st) < 0)
+        {
+            close(fd_);
+            fd_ = -1;
+            throw std::runtime_error("Failed to stat audit log");
+        }
+        // Drop a torn record left behind by a crash mid-write
+        offset_ = st.st_size - st.st_size % static_cast<off_t>(sizeof(AuditRecord));
+    }
+
+    // Move the full file aside as <path>.<unix seconds>.<first sequence> and
+    // start an empty one. Returns false, still writing to the old file, if any
+    // step fails; the next batch tries again.
+    bool rotate()
+    {
+        if (fdatasync(fd_) < 0)
+        {
+            logger().log(LogFormat::AuditError, "rotate: fdatasync failed, errno ", static_cast<uint64_t>(errno));
+            return false;
+        }
+
+        // The first record's sequence number keeps names unique within a second;
+        // RENAME_NOREPLACE (plus a counter) guards against restarts reusing it
+        AuditRecord first{};
+        if (ssize_t n{pread(fd_, &first, sizeof(first), 0)}; n != sizeof(first))
+        {
+            logger().log(LogFormat::AuditError, "rotate: cannot read the first record, errno ",
+                         static_cast<uint64_t>(n < 0 ? errno : 0));
+            return false;
+        }
+        std::string rotated{std::string(AUDIT_LOG_PATH) + "." + std::to_string(std::time(nullptr)) + "." +
+                            (first.magic == AUDIT_RECORD_MAGIC ? std::to_string(first.sequence) : std::string{"unknown"})};
+        std::string target{rotated};
+        int renamed{-1};
+        for (int attempt{1}; attempt <= 100; ++attempt)
+        {
+            renamed = renameat2(AT_FDCWD, AUDIT_LOG_PATH, AT_FDCWD, target.c_str(), RENAME_NOREPLACE);
+            if (renamed == 0 || errno != EEXIST)
+            {
+                break;
+            }
+            target = rotated + "-" + std::to_string(attempt);
+        }
+        if (renamed < 0)
+        {
+            logger().log(LogFormat::AuditError, "rotate: rename failed, errno ", static_cast<uint64_t>(errno));
+            return false;
+        }
+
+        int old_fd{fd_};
+        off_t old_offset{offset_};
+        try
+        {
+            open_file();
+        }
+        catch (const std::exception &)
+        {
+            // Keep appending to the renamed file rather than losing records
+            logger().log(LogFormat::AuditError, "rotate: reopen failed, errno ", static_cast<uint64_t>(errno));
+            fd_ = old_fd;
+            offset_ = old_offset;
+            return false;
+        }
+        close(old_fd);
+        flight_recorder().record(FlightEvent::AuditRotate);
+        return true;
+    }
+
+    // Writer thread: one group commit per interval, or sooner if someone waits
+    void run()
+    {
+        flight_recorder().register_thread("audit");
+        Batch batch{};
+        while (true)
+        {
+            {
+                ProfiledLock lock{commit_mutex_};
+                wake_writer_.wait_for(lock, AUDIT_COMMIT_INTERVAL, [this]
+                                      { return stop_ || waiters_ > 0; });
+            }
+
+            // Collect every thread's pending records
+            batch.clear();
+            {
+                ProfiledLock lock{buffers_mutex_};
+                for (const auto &buffer : buffers_)
+                {
+                    ProfiledLock buffer_lock{buffer->mutex};
+                    if (buffer->pending.empty())
+                    {
+                        continue;
+                    }
+                    batch.emplace_back(buffer, std::move(buffer->pending));
+                    buffer->pending.clear();
+                    buffer->generation++;
+                }
+            }
+
+            size_t bytes{0};
+            for (auto &[buffer, records] : batch)
+            {
+                bytes += records.size() * sizeof(AuditRecord);
+            }
+
+            bool committed{true};
+            if (bytes > 0)
+            {
+                try
+                {
+                    if (offset_ + static_cast<off_t>(bytes) > AUDIT_ROTATE_BYTES && offset_ > 0)
+                    {
+                        rotate();
+                    }
+                    auto started{std::chrono::steady_clock::now()};
+                    committed = commit(batch, bytes);
+                    auto elapsed{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count()};
+                    flight_recorder().record(FlightEvent::AuditCommit, static_cast<uint32_t>(bytes / sizeof(AuditRecord)), bytes,
+                                             static_cast<uint64_t>(elapsed));
+                }
+                catch (const std::exception &e)
+                {
+                    // The writer must outlive any one bad batch
+                    logger().log(LogFormat::AuditError, std::string("commit failed: ") + e.what() + ", errno ",
+                                 static_cast<uint64_t>(errno));
+                    committed = false;
+                }
+            }
+
+            // Publish: everything collected in this round is now on disk, or lost
+            {
+                ProfiledLock lock{commit_mutex_};
+                for (auto &[buffer, records] : batch)
+                {
+                    (committed ? buffer->committed : buffer->lost).store(buffer->generation, std::memory_order_release);
+                }
+                if (stop_ && bytes == 0)
+                {
+                    committed_.notify_all();
+                    return;
+                }
+            }
+            committed_.notify_all();
+        }
+    }
+
+    // Write the batch at the end of the file and flush it. A failed attempt
+    // rewrites the whole batch at the same offset before flushing again (after
+    // a failed fdatasync the kernel may already have dropped the dirty pages).
+    // Returns false if the records may not have reached the disk.
+    bool commit(const Batch &batch, const size_t bytes)
+    {
+        for (int attempt{1}; attempt <= AUDIT_COMMIT_ATTEMPTS; ++attempt)
+        {
+            if (!write_at_end(batch))
+            {
+                logger().log(LogFormat::AuditError, "write failed, errno ", static_cast<uint64_t>(errno));
+            }
+            else if (ack_mode_.load(std::memory_order_relaxed) != AuditAck::Written && fdatasync(fd_) < 0)
+            {
+                logger().log(LogFormat::AuditError, "fdatasync failed, errno ", static_cast<uint64_t>(errno));
+            }
+            else
+            {
+                offset_ += static_cast<off_t>(bytes);
+                return true;
+            }
+            std::this_thread::sleep_for(AUDIT_RETRY_BACKOFF * attempt);
+        }
+        return false;
+    }
+
+    // One pass of pwritev() calls (at most IOV_MAX entries each) writing the
+    // batch at offset_; false if any call failed
+    bool write_at_end(const Batch &batch)
+    {
+        std::vector<iovec> iov{};
+        for (const auto &[buffer, records] : batch)
+        {
+            iov.push_back({const_cast<AuditRecord *>(records.data()), records.size() * sizeof(AuditRecord)});
+        }
+
+        off_t offset{offset_};
+        size_t first{0};
+        while (first < iov.size())
+        {
+            int count{static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX))};
+            ssize_t written{pwritev(fd_, &iov[first], count, offset)};
+            if (written < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (written <= 0)
+            {
+                return false;
+            }
+            offset += written;
+
+            // Advance past fully written entries, trimming a partially written one
+            auto remaining{static_cast<size_t>(written)};
+            while (first < iov.size() && remaining >= iov[first].iov_len)
+            {
+                remaining -= iov[first].iov_len;
+                first++;
+            }
+            if (remaining > 0)
+            {
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + remaining;
+                iov[first].iov_len -= remaining;
+            }
+        }
+        return true;
+    }
+
+    int fd_{-1};
+    off_t offset_{0};
+    std::atomic<uint64_t> next_sequence_{0};
+    std::atomic<AuditAck> ack_mode_{AUDIT_ACK_DEFAULT};
+
+    ProfiledMutex buffers_mutex_{"audit.buffers"};
+    std::vector<std::shared_ptr<Buffer>> buffers_{};
+
+    ProfiledMutex commit_mutex_{"audit.commit"};
+    std::condition_variable_any wake_writer_{};
+    std::condition_variable_any committed_{};
+    size_t waiters_{0};
+    bool stop_{false};
+
+    std::thread writer_{};
+};
+
+// === FUNCTION: Access the process-wide audit log ===
+AuditLog &audit_log()
+{
+    static AuditLog instance{};
+    return instance;
+}
+
+// === FUNCTION: Fetch SHA256 once (SCRAM, puzzles) ===
+// Under OpenSSL 3, EVP_sha256() is a legacy handle: every digest init through
+// it performs an implicit provider lookup. Fetching the algorithm explicitly
+// once and reusing it keeps that lookup off the per-handshake path.
+const EVP_MD *sha256_md()
+{
+    static const EvpMdPtr md{EVP_MD_fetch(nullptr, "SHA256", nullptr), &EVP_MD_free};
+    if (!md)
+    {
+        throw std::runtime_error("Failed to fetch SHA256 implementation");
+    }
+    return md.get();
+}
+
+// === CREDENTIAL RECORD ===
+// HMAC keys are kept as precomputed inner/outer midstates (hmac_midstate.h):
+// each verification resumes from them, and neither the raw key nor anything
+// heap-allocated is kept per user. Everything a lookup touches (username up to
+// 15 bytes, midstates, SCRAM verifier) sits inline in the table node, so one
+// lookup walks only the bucket array and the node, both in the huge-page arena.
+using HmacKeyState = hmac_midstate::KeyState;
+using hmac_midstate::compute_hmac;
+
+// SCRAM-SHA-256 style verifier: what the server keeps instead of the password.
+//   SaltedPassword = PBKDF2-HMAC-SHA256(password, salt, iterations)
+//   StoredKey      = SHA256(HMAC(SaltedPassword, "Client Key"))
+//   ServerKey      = HMAC(SaltedPassword, "Server Key")
+// Neither lets an attacker who steals it log in as the user.
+struct ScramCredential
+{
+    std::array<char, SCRAM_SALT_SIZE> salt{};
+    uint32_t iterations{0}; // 0: the user has no SCRAM verifier
+    std::array<unsigned char, SCRAM_KEY_SIZE> stored_key{};
+    HmacKeyState stored_key_hmac{}; // HMAC keyed with StoredKey (client signature)
+    HmacKeyState server_key_hmac{}; // HMAC keyed with ServerKey (server signature)
+};
+
+// A user has either
+// - an HMAC-SHA1 key state for the default challenge-response mode and a
+//   SCRAM verifier for the salted challenge-response mode, or
+// - only an Ed25519 public key; the client signs the challenge and the
+//   server never holds anything that could be used to log in.
+// The parts a user doesn't have are left empty. The Ed25519 key (over a KiB
+// with its precomputed multiples) is held behind a pointer, so only the few
+// key-only accounts pay for it.
+struct CredentialRecord
+{
+    HmacKeyState hmac{};
+    std::unique_ptr<const ed25519_batch::PublicKey> ed25519_public{}; // Decoded once at load
+    ScramCredential scram{};
+};
+
+// Username -> credential record, with nodes and buckets in credential_arena()
+using CredentialDatabase = std::pmr::unordered_map<std::string, CredentialRecord>;
+
+// === FUNCTION: Access the credential table's arena ===
+// Filled once by load_credentials() before any worker starts; read-only afterwards.
+huge_page_arena::Arena &credential_arena()
+{
+    static huge_page_arena::Arena arena{USE_HUGE_PAGES ? huge_page_arena::Backing::ExplicitHugePages
+                                                       : huge_page_arena::Backing::RegularPages};
+    return arena;
+}
+
+// === FUNCTION: Report where the credential table ended up ===
+// Coverage is asked from the kernel each time: khugepaged may collapse more
+// of a THP-backed table into huge pages after startup.
+std::string credential_arena_report()
+{
+    const huge_page_arena::Arena &arena{credential_arena()};
+    std::string report{"credential table: " + std::string(huge_page_arena::BACKING_NAMES[static_cast<size_t>(arena.backing())]) +
+                       ", " + std::to_string(arena.huge_page_coverage_percent()) + "% huge page coverage\n"};
+    report += "  " + std::to_string(arena.used_bytes()) + " bytes in arena, " + std::to_string(arena.released_bytes()) +
+              " released (not reused)\n";
+    report += "  chunks:";
+    for (size_t i{0}; i < static_cast<size_t>(huge_page_arena::Backing::Count); ++i)
+    {
+        report += std::string(" ") + huge_page_arena::BACKING_NAMES[i] + " " +
+                  std::to_string(arena.chunk_count(static_cast<huge_page_arena::Backing>(i))) + ";";
+    }
+    report.back() = '\n';
+    return report;
+}
 
 // === FUNCTION: Generate a Random Challenge String ===
 // This function creates a cryptographically secure random byte string (challenge)
 // which will be used for the HMAC challenge-response step.
+//
+// Each thread keeps a pool of random bytes and refills it with one RAND_bytes()
+// call, so the DRBG is entered once per CHALLENGE_POOL_BYTES instead of per
+// handshake. Bytes are consumed once and never reused.
 std::string generate_challenge(size_t length = 16)
 {
-    unsigned char buffer[64]{}; // Buffer with maximum safe size
-    if (!RAND_bytes(buffer, static_cast<int>(length)))
+    struct ChallengePool
+    {
+        std::array<unsigned char, CHALLENGE_POOL_BYTES> bytes{};
+        size_t used{CHALLENGE_POOL_BYTES}; // Starts empty
+    };
+    thread_local ChallengePool pool{};
+
+    if (length > pool.bytes.size())
+    {
+        throw std::runtime_error("Challenge length exceeds pool size");
+    }
+    if (pool.bytes.size() - pool.used < length)
+    {
+        if (!RAND_bytes(pool.bytes.data(), static_cast<int>(pool.bytes.size())))
+        {
+            throw std::runtime_error("Failed to generate random challenge");
+        }
+        pool.used = 0;
+    }
+
+    // reinterpret_cast is used to treat raw bytes as char* for std::string construction
+    // This is safe because we're specifying the exact length and the pool holds that many fresh bytes
+    std::string challenge(reinterpret_cast<char *>(pool.bytes.data() + pool.used), length);
+    pool.used += length;
+    return challenge;
+}
+
+// The persisted form of a SCRAM verifier: everything needed to rebuild a
+// ScramCredential without the password.
+struct ScramVerifier
+{
+    std::string salt{};
+    uint32_t iterations{0};
+    std::string stored_key{};
+    std::string server_key{};
+};
+
+// Contents of SCRAM_VERIFIER_FILE
+struct ScramStore
+{
+    std::string decoy_key{}; // Keys HMAC(decoy_key, username), the salt shown for unknown users
+    std::map<std::string, ScramVerifier> users{};
+    std::map<std::string, HmacKeyState> hmac_keys{}; // Challenge-response midstates, for users that have them
+};
+
+// === FUNCTION: Derive a user's SCRAM verifier from the password ===
+// Runs PBKDF2 once, when the user is first provisioned; only the derived keys are kept.
+ScramVerifier derive_scram_verifier(const std::string &password)
+{
+    ScramVerifier verifier{};
+    verifier.iterations = SCRAM_ITERATIONS;
+    verifier.salt = generate_challenge(SCRAM_SALT_SIZE);
+
+    unsigned char salted[SCRAM_KEY_SIZE]{};
+    if (!PKCS5_PBKDF2_HMAC(password.data(), static_cast<int>(password.length()),
+                           reinterpret_cast<const unsigned char *>(verifier.salt.data()), static_cast<int>(verifier.salt.length()),
+                           static_cast<int>(verifier.iterations), sha256_md(), sizeof(salted), salted))
+    {
+        throw std::runtime_error("PBKDF2 failed");
+    }
+
+    HmacKeyState salted_hmac{hmac_midstate::make_key_state(hmac_midstate::Digest::Sha256,
+                                                           std::string_view(reinterpret_cast<char *>(salted), sizeof(salted)))};
+    OPENSSL_cleanse(salted, sizeof(salted));
+
+    std::string client_key{compute_hmac("Client Key", salted_hmac)};
+    verifier.server_key = compute_hmac("Server Key", salted_hmac);
+
+    unsigned char stored[SCRAM_KEY_SIZE]{};
+    if (!EVP_Digest(client_key.data(), client_key.length(), stored, nullptr, sha256_md(), nullptr))
+    {
+        throw std::runtime_error("SCRAM StoredKey derivation failed");
+    }
+    verifier.stored_key.assign(reinterpret_cast<char *>(stored), sizeof(stored));
+
+    OPENSSL_cleanse(client_key.data(), client_key.size());
+    return verifier;
+}
+
+// === FUNCTION: Build the in-memory SCRAM credential from a stored verifier ===
+ScramCredential make_scram_credential(const ScramVerifier &verifier)
+{
+    ScramCredential scram{};
+    std::copy(verifier.salt.begin(), verifier.salt.end(), scram.salt.begin());
+    scram.iterations = verifier.iterations;
+    std::copy(verifier.stored_key.begin(), verifier.stored_key.end(), scram.stored_key.begin());
+    scram.stored_key_hmac = hmac_midstate::make_key_state(hmac_midstate::Digest::Sha256, verifier.stored_key);
+    scram.server_key_hmac = hmac_midstate::make_key_state(hmac_midstate::Digest::Sha256, verifier.server_key);
+    return scram;
+}
+
+// === FUNCTION: Hex-encode bytes for the verifier file ===
+std::string to_hex(const std::string &bytes)
+{
+    static constexpr char HEX[]{"0123456789abcdef"};
+    std::string hex{};
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char b : bytes)
+    {
+        hex += HEX[b >> 4];
+        hex += HEX[b & 15];
+    }
+    return hex;
+}
+
+// === FUNCTION: Decode hex from the verifier file ===
+// Throws on odd lengths and non-hex characters rather than guessing.
+std::string from_hex(const std::string &hex)
+{
+    auto digit{[](char c) -> int
+               {
+                   if (c >= '0' && c <= '9')
+                   {
+                       return c - '0';
+                   }
+                   if (c >= 'a' && c <= 'f')
+                   {
+                       return c - 'a' + 10;
+                   }
+                   if (c >= 'A' && c <= 'F')
+                   {
+                       return c - 'A' + 10;
+                   }
+                   return -1;
+               }};
+    if (hex.size() % 2 != 0)
+    {
+        throw std::runtime_error("Odd-length hex string");
+    }
+    std::string bytes{};
+    bytes.reserve(hex.size() / 2);
+    for (size_t i{0}; i < hex.size(); i += 2)
+    {
+        int high{digit(hex[i])};
+        int low{digit(hex[i + 1])};
+        if (high < 0 || low < 0)
+        {
+            throw std::runtime_error("Invalid hex string");
+        }
+        bytes += static_cast<char>((high << 4) | low);
+    }
+    return bytes;
+}
+
+// === FUNCTION: Read the demo account's password on first start ===
+// One line from stdin, with echo turned off when stdin is a terminal.
+std::string read_first_start_password()
+{
+    termios saved{};
+    bool terminal{isatty(STDIN_FILENO) == 1 && tcgetattr(STDIN_FILENO, &saved) == 0};
+    if (terminal)
+    {
+        termios quiet{saved};
+        quiet.c_lflag &= ~static_cast<tcflag_t>(ECHO);
+        tcsetattr(STDIN_FILENO, TCSANOW, &quiet);
+        std::cerr << "No " << SCRAM_VERIFIER_FILE << " yet. Password for " << DEFAULT_USERNAME << ": " << std::flush;
+    }
+
+    std::string password{};
+    password.reserve(256); // Long enough that getline() doesn't leave reallocated copies behind
+    bool read{static_cast<bool>(std::getline(std::cin, password))};
+    if (terminal)
+    {
+        tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+        std::cerr << "\n";
+    }
+    if (!read || password.empty())
+    {
+        OPENSSL_cleanse(password.data(), password.size());
+        throw std::runtime_error("First start needs a password for " + DEFAULT_USERNAME + " on stdin");
+    }
+    return password;
+}
+
+// === FUNCTION: Create the SCRAM verifier file ===
+// First start only: a random decoy key plus the demo account's SCRAM verifier
+// and HMAC midstates, derived from a password read on stdin and then wiped.
+// Written with O_EXCL and mode 0600 so an existing file is never replaced.
+ScramStore create_scram_store(const std::string &path)
+{
+    ScramStore store{};
+    store.decoy_key = generate_challenge(SCRAM_DECOY_KEY_SIZE);
+    std::string password{read_first_start_password()};
+    store.users.emplace(DEFAULT_USERNAME, derive_scram_verifier(password));
+    store.hmac_keys.emplace(DEFAULT_USERNAME, hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, password));
+    OPENSSL_cleanse(password.data(), password.size());
+
+    std::string contents{"decoy " + to_hex(store.decoy_key) + "\n"};
+    for (const auto &[username, verifier] : store.users)
+    {
+        contents += username + " " + std::to_string(verifier.iterations) + " " + to_hex(verifier.salt) + " " +
+                    to_hex(verifier.stored_key) + " " + to_hex(verifier.server_key);
+        auto hmac_key{store.hmac_keys.find(username)};
+        if (hmac_key != store.hmac_keys.end())
+        {
+            contents += " " + to_hex(hmac_midstate::export_state(hmac_key->second));
+        }
+        contents += "\n";
+    }
+
+    int fd{open(path.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0600)};
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot create SCRAM verifier file " + path);
+    }
+    size_t done{0};
+    while (done < contents.size())
+    {
+        ssize_t n{write(fd, contents.data() + done, contents.size() - done)};
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    bool synced{fsync(fd) == 0};
+    bool closed{close(fd) == 0};
+    OPENSSL_cleanse(contents.data(), contents.size());
+    if (done < contents.size() || !synced || !closed)
+    {
+        unlink(path.c_str());
+        throw std::runtime_error("Cannot write SCRAM verifier file " + path);
+    }
+    return store;
+}
+
+// === FUNCTION: Load the SCRAM verifier file, creating it on first start ===
+// Format, one entry per line:
+//   decoy <hex key>
+//   <username> <iterations> <hex salt> <hex StoredKey> <hex ServerKey> [<hex HMAC-SHA1 midstates>]
+// Files readable by group or others are refused.
+ScramStore load_scram_store(const std::string &path)
+{
+    int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+    if (fd < 0 && errno == ENOENT)
+    {
+        return create_scram_store(path);
+    }
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open SCRAM verifier file " + path);
+    }
+    struct stat info{};
+    if (fstat(fd, &info) != 0 || (info.st_mode & (S_IRWXG | S_IRWXO)) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("SCRAM verifier file " + path + " must not be accessible by group or others");
+    }
+
+    std::string contents{};
+    char chunk[4096];
+    for (ssize_t n{}; (n = read(fd, chunk, sizeof(chunk))) != 0;)
+    {
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0)
+        {
+            close(fd);
+            throw std::runtime_error("Cannot read SCRAM verifier file " + path);
+        }
+        contents.append(chunk, static_cast<size_t>(n));
+    }
+    close(fd);
+
+    ScramStore store{};
+    std::istringstream in{contents};
+    OPENSSL_cleanse(contents.data(), contents.size());
+    std::string line{};
+    while (std::getline(in, line))
+    {
+        std::istringstream fields{line};
+        std::string name{};
+        if (!(fields >> name))
+        {
+            continue;
+        }
+        if (name == "decoy")
+        {
+            std::string key{};
+            fields >> key;
+            store.decoy_key = from_hex(key);
+            continue;
+        }
+        uint32_t iterations{0};
+        std::string salt{};
+        std::string stored_key{};
+        std::string server_key{};
+        if (!(fields >> iterations >> salt >> stored_key >> server_key))
+        {
+            throw std::runtime_error("Malformed SCRAM verifier for " + name);
+        }
+        ScramVerifier verifier{from_hex(salt), iterations, from_hex(stored_key), from_hex(server_key)};
+        if (verifier.salt.size() != SCRAM_SALT_SIZE || verifier.stored_key.size() != SCRAM_KEY_SIZE ||
+            verifier.server_key.size() != SCRAM_KEY_SIZE || iterations == 0)
+        {
+            throw std::runtime_error("Malformed SCRAM verifier for " + name);
+        }
+        store.users.emplace(name, std::move(verifier));
+
+        std::string hmac_hex{};
+        if (fields >> hmac_hex)
+        {
+            std::string exported{from_hex(hmac_hex)};
+            auto hmac_key{hmac_midstate::import_state(hmac_midstate::Digest::Sha1, exported)};
+            OPENSSL_cleanse(exported.data(), exported.size());
+            OPENSSL_cleanse(hmac_hex.data(), hmac_hex.size());
+            if (!hmac_key)
+            {
+                throw std::runtime_error("Malformed HMAC key state for " + name);
+            }
+            store.hmac_keys.emplace(name, *hmac_key);
+        }
+    }
+    OPENSSL_cleanse(line.data(), line.size());
+    if (store.decoy_key.size() != SCRAM_DECOY_KEY_SIZE)
+    {
+        throw std::runtime_error("Missing decoy key in SCRAM verifier file " + path);
+    }
+    return store;
+}
+
+// === FUNCTION: Access the decoy-salt key ===
+// Set once by load_credentials() before any worker starts.
+HmacKeyState &scram_decoy_key()
+{
+    static HmacKeyState key{};
+    return key;
+}
+
+// === FUNCTION: Salt to show an unknown user ===
+// HMAC(decoy key, username): stable for a given name across hellos and restarts,
+// like a real user's salt, so the salt doesn't reveal whether the user exists.
+std::string scram_decoy_salt(const std::string &username)
+{
+    return compute_hmac(username, scram_decoy_key()).substr(0, SCRAM_SALT_SIZE);
+}
+
+// === FUNCTION: Provision one user ===
+CredentialRecord make_credential_record(const HmacKeyState &hmac, const ScramVerifier &verifier)
+{
+    CredentialRecord record{};
+    record.hmac = hmac;
+    record.scram = make_scram_credential(verifier);
+    return record;
+}
+
+// === FUNCTION: Load the credential database ===
+// Every user is provisioned once at startup from SCRAM_VERIFIER_FILE (created
+// on first start): the SCRAM verifier and, for challenge-response, the stored
+// HMAC midstates. No password or raw HMAC key is ever loaded.
+CredentialDatabase load_credentials()
+{
+    ScramStore store{load_scram_store(SCRAM_VERIFIER_FILE)};
+    scram_decoy_key() = hmac_midstate::make_key_state(hmac_midstate::Digest::Sha256, store.decoy_key);
+    OPENSSL_cleanse(store.decoy_key.data(), store.decoy_key.size());
+
+    if (store.hmac_keys.count(DEFAULT_USERNAME) == 0)
+    {
+        throw std::runtime_error("No HMAC key state for " + DEFAULT_USERNAME + " in " + SCRAM_VERIFIER_FILE +
+                                 " (written by an older server2; remove it to provision again)");
+    }
+    // Sized up front: the arena doesn't reuse the bucket arrays a rehash frees
+    CredentialDatabase db{&credential_arena()};
+    db.reserve(store.users.size() + 1);
+    for (const auto &[username, verifier] : store.users)
+    {
+        auto hmac_key{store.hmac_keys.find(username)};
+        db.emplace(username, make_credential_record(hmac_key == store.hmac_keys.end() ? HmacKeyState{} : hmac_key->second,
+                                                    verifier));
+    }
+    for (auto &[username, hmac_key] : store.hmac_keys)
+    {
+        OPENSSL_cleanse(&hmac_key, sizeof(hmac_key));
+    }
+
+    // Every "<username>.ed25519.pub" is a key-only account
+    auto close_dir{[](DIR *d)
+                   { closedir(d); }};
+    std::unique_ptr<DIR, decltype(close_dir)> dir{opendir("."), close_dir};
+    if (!dir)
+    {
+        throw std::runtime_error("Cannot list the working directory for Ed25519 public keys");
+    }
+    while (dirent *entry{readdir(dir.get())})
+    {
+        std::string file_name{entry->d_name};
+        if (file_name.length() <= ED25519_PUBKEY_SUFFIX.length() ||
+            file_name.compare(file_name.length() - ED25519_PUBKEY_SUFFIX.length(), std::string::npos, ED25519_PUBKEY_SUFFIX) != 0)
+        {
+            continue;
+        }
+        std::string username{file_name.substr(0, file_name.length() - ED25519_PUBKEY_SUFFIX.length())};
+        if (db.count(username) > 0)
+        {
+            throw std::runtime_error(username + " has a shared secret; Ed25519 accounts hold only a public key (remove " +
+                                     file_name + ")");
+        }
+
+        FilePtr file{fopen(file_name.c_str(), "r"), &fclose};
+        EvpPkeyPtr pem_key{file ? PEM_read_PUBKEY(file.get(), nullptr, nullptr, nullptr) : nullptr, &EVP_PKEY_free};
+        unsigned char raw[ed25519_batch::KEY_SIZE]{};
+        size_t raw_len{sizeof(raw)};
+        if (!pem_key || EVP_PKEY_get_id(pem_key.get()) != EVP_PKEY_ED25519 ||
+            !EVP_PKEY_get_raw_public_key(pem_key.get(), raw, &raw_len) || raw_len != sizeof(raw))
+        {
+            throw std::runtime_error("Invalid Ed25519 public key for " + username);
+        }
+        std::optional<ed25519_batch::PublicKey> public_key{ed25519_batch::parse_public_key(raw)};
+        if (!public_key)
+        {
+            throw std::runtime_error("Invalid Ed25519 public key for " + username);
+        }
+        CredentialRecord record{};
+        record.ed25519_public = std::make_unique<const ed25519_batch::PublicKey>(std::move(*public_key));
+        db.emplace(username, std::move(record));
+    }
+    return db;
+}
+
+// === FUNCTION: Verify a SCRAM client proof ===
+// AuthMessage binds the proof to this user and this handshake's challenge.
+//   ClientSignature = HMAC(StoredKey, AuthMessage)
+//   ClientKey       = ClientProof XOR ClientSignature
+//   valid if SHA256(ClientKey) == StoredKey
+// On success `server_signature` is set to HMAC(ServerKey, AuthMessage) so the
+// client can check it is talking to a server that knows its verifier.
+bool verify_scram(const std::string &auth_message, const std::string &proof,
+                  const ScramCredential &scram, std::string &server_signature)
+{
+    if (proof.length() != SCRAM_KEY_SIZE)
+    {
+        return false;
+    }
+
+    std::string client_key{compute_hmac(auth_message, scram.stored_key_hmac)};
+    for (size_t i{0}; i < client_key.length(); ++i)
+    {
+        client_key[i] ^= proof[i];
+    }
+
+    unsigned char stored[SCRAM_KEY_SIZE]{};
+    if (!EVP_Digest(client_key.data(), client_key.length(), stored, nullptr, sha256_md(), nullptr))
+    {
+        throw std::runtime_error("SCRAM verification failed");
+    }
+    OPENSSL_cleanse(client_key.data(), client_key.size());
+
+    if (CRYPTO_memcmp(stored, scram.stored_key.data(), SCRAM_KEY_SIZE) != 0)
+    {
+        return false;
+    }
+    server_signature = compute_hmac(auth_message, scram.server_key_hmac);
+    return true;
+}
+
+// === ED25519 BATCH VERIFICATION ===
+// Concurrent Ed25519 handshakes share one multi-scalar verification (see
+// ed25519_batch.h). Whichever worker finds the verifier idle becomes the
+// combiner: it takes everything queued so far (up to ED25519_MAX_BATCH),
+// verifies it as one batch, hands out the verdicts and goes again while its
+// own signature is still queued. Nobody waits for a batch to fill, so a lone
+// handshake is verified at once; batches form only from signatures that
+// arrive while another batch is being checked.
+
+class Ed25519Batcher
+{
+public:
+    bool verify(const std::string &message, const std::string &signature, const ed25519_batch::PublicKey &key)
+    {
+        Request request{{&message, &signature, &key}};
+        ProfiledLock lock{mutex_};
+        queue_.push_back(&request);
+        while (!request.done)
+        {
+            if (busy_)
+            {
+                done_.wait(lock);
+                continue;
+            }
+
+            // Step 1: Take a batch and verify it without holding the lock
+            busy_ = true;
+            size_t count{std::min(queue_.size(), ED25519_MAX_BATCH)};
+            if (queue_.size() > 1) // Only when signatures actually queued up
+            {
+                flight_recorder().record(FlightEvent::QueueDepth, static_cast<uint32_t>(FlightQueue::Ed25519Batch),
+                                         queue_.size(), count);
+            }
+            std::vector<Request *> batch(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+            queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+            lock.unlock();
+
+            std::vector<ed25519_batch::Item> items{};
+            items.reserve(count);
+            for (const Request *queued : batch)
+            {
+                items.push_back(queued->item);
+            }
+            std::vector<char> valid(count, 0);
+            std::exception_ptr error{};
+            try
+            {
+                valid = ed25519_batch::verify_batch(items);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            // Step 2: Hand out the verdicts and let the next combiner in
+            lock.lock();
+            for (size_t i{0}; i < count; ++i)
+            {
+                batch[i]->valid = valid[i] != 0;
+                batch[i]->error = error;
+                batch[i]->done = true;
+            }
+            busy_ = false;
+            batches_++;
+            signatures_ += count;
+            largest_ = std::max(largest_, count);
+            done_.notify_all();
+        }
+        if (request.error)
+        {
+            std::rethrow_exception(request.error);
+        }
+        return request.valid;
+    }
+
+    std::string report()
+    {
+        ProfiledLock lock{mutex_};
+        return "ed25519 signatures=" + std::to_string(signatures_) + " batches=" + std::to_string(batches_) +
+               " largest_batch=" + std::to_string(largest_);
+    }
+
+    void reset()
+    {
+        ProfiledLock lock{mutex_};
+        signatures_ = 0;
+        batches_ = 0;
+        largest_ = 0;
+    }
+
+private:
+    struct Request
+    {
+        ed25519_batch::Item item{};
+        bool done{false};
+        bool valid{false};
+        std::exception_ptr error{};
+    };
+
+    ProfiledMutex mutex_{"ed25519.batch"};
+    std::condition_variable_any done_{};
+    std::vector<Request *> queue_{}; // Waiting signatures; each Request lives on its worker's stack
+    bool busy_{false};               // A combiner is verifying a batch
+    uint64_t signatures_{0};
+    uint64_t batches_{0};
+    size_t largest_{0};
+};
+
+// === FUNCTION: Access the Ed25519 batcher ===
+Ed25519Batcher &ed25519_batcher()
+{
+    static Ed25519Batcher instance{};
+    return instance;
+}
+
+// What the client asked for in its hello
+struct Hello
+{
+    std::string username{};
+    std::string mode{};      // "" = HMAC (default), "ed25519", "scram"
+    uint32_t deadline_ms{0}; // Client's time budget from sending the hello; 0 = none
+};
+
+// === FUNCTION: Parse the client's hello ===
+// Clients greet with "hello [<username> [<mode>] [deadline=<ms>]]"; a bare
+// "hello" means DEFAULT_USERNAME with the HMAC mode and no deadline. The
+// deadline option is recognised wherever it appears, so "hello deadline=500"
+// is the default user with a deadline, not a user named "deadline=500". Of
+// the other words, the first is the username and the second the mode.
+Hello parse_hello(const std::string &hello)
+{
+    Hello parsed{DEFAULT_USERNAME, {}, 0};
+    bool named{false};
+    for (size_t start{hello.find(' ')}; start != std::string::npos && start + 1 < hello.length();)
+    {
+        size_t end{hello.find(' ', start + 1)};
+        std::string word{hello.substr(start + 1, end - start - 1)};
+        if (word.rfind(DEADLINE_OPTION, 0) == 0)
+        {
+            unsigned long ms{std::strtoul(word.c_str() + DEADLINE_OPTION.length(), nullptr, 10)};
+            parsed.deadline_ms = static_cast<uint32_t>(std::min<unsigned long>(ms, MAX_DEADLINE_MS));
+        }
+        else if (!word.empty() && !named)
+        {
+            parsed.username = word;
+            named = true;
+        }
+        else if (!word.empty())
+        {
+            parsed.mode = word;
+        }
+        start = end;
+    }
+    return parsed;
+}
+
+// === FUNCTION: Create and Prepare the Server Socket ===
+int create_server_socket(const int port)
+{
+    // Create a socket: AF_INET = IPv4, SOCK_STREAM = TCP
+    int sockfd{socket(AF_INET, SOCK_STREAM, 0)};
+    if (sockfd < 0)
+    {
+        throw std::runtime_error("Socket creation failed");
+    }
+
+    // Prepare address structure
+    sockaddr_in address{};
+    address.sin_family = AF_INET;         // IPv4
+    address.sin_addr.s_addr = INADDR_ANY; // Accept connections on any interface
+    address.sin_port = htons(port);       // Convert port number to network byte order (big endian)
+
+    // Allow immediate restarts while old connections sit in TIME_WAIT
+    int reuse{1};
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    // Idle workers poll the listener themselves (see idle_accept()); accepted
+    // sockets do not inherit O_NONBLOCK
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK);
+
+    // Software receive timestamps on every frame (see read_message())
+    int timestamping{SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE};
+    setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &timestamping, sizeof(timestamping));
+
+    // Bind the socket to the port/IP
+    if (bind(sockfd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        throw std::runtime_error("Bind failed");
+    }
+
+    return sockfd;
+}
+
+// === FUNCTION: Open the bound socket for connections ===
+// Kept separate from create_server_socket() so workers can warm up on a bound
+// port before any client is allowed to connect.
+void start_listening(const int sockfd)
+{
+    if (listen(sockfd, SOMAXCONN) < 0)
+    {
+        throw std::runtime_error("Listen failed");
+    }
+}
+
+// === KERNEL RECEIVE TIMESTAMPS ===
+// The listener enables SO_TIMESTAMPING (accepted sockets inherit it), so every
+// frame read_message() receives carries the time the kernel queued it. The gap
+// to the moment read_message() gets it is time the frame sat waiting for us
+// (accept backlog, busy workers, scheduling) rather than time in our code.
+
+// === FUNCTION: Histogram of kernel-to-user-space receive delays (ns) ===
+Histogram &queueing_delay()
+{
+    static Histogram instance{};
+    return instance;
+}
+
+// Delay of the last frame this thread read (0 if it had no timestamp)
+thread_local uint64_t last_queueing_delay_ns{0};
+
+// Whether the last read on this thread gave up at the socket's receive timeout
+thread_local bool last_read_timed_out{false};
+
+// When the kernel received the current session's hello (steady clock)
+thread_local std::chrono::steady_clock::time_point hello_arrival{};
+
+// === HANDSHAKE STAGES ===
+// Each thread records which step of a handshake it is in, so diagnostics
+// (e.g. profiler samples) can be attributed to a stage. Threads that never
+// serve clients stay in Stage::Background.
+enum class Stage : uint8_t
+{
+    Background,
+    Accept,
+    ReadHello,
+    Puzzle,
+    Challenge,
+    ReadProof,
+    Verify,
+    Audit,
+    Reply,
+    Count
+};
+
+constexpr const char *STAGE_NAMES[]{
+    "background",
+    "accept",
+    "read_hello",
+    "puzzle",
+    "challenge",
+    "read_proof",
+    "verify",
+    "audit",
+    "reply",
+};
+static_assert(sizeof(STAGE_NAMES) / sizeof(STAGE_NAMES[0]) == static_cast<size_t>(Stage::Count));
+
+// Read from the SIGPROF handler on the same thread, hence volatile
+thread_local volatile Stage current_stage{Stage::Background};
+
+// === STAGE METERS ===
+// Every stage transition charges the elapsed wall time to the stage being
+// left. When hardware counters are switched on (control command "counters on")
+// each worker also reads a perf_event_open group (cycles, instructions, LLC
+// misses, branch misses; user space only) at the same boundaries. The report
+// averages both per stage visit, which shows whether a slow stage is
+// compute-bound (high cycles, good IPC) or memory-bound (LLC misses, low IPC).
+
+enum class HwCounter : uint8_t
+{
+    Cycles,
+    Instructions,
+    LlcMisses,
+    BranchMisses,
+    Count
+};
+
+constexpr uint64_t HW_COUNTER_CONFIGS[]{
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, // Last-level cache misses
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+static_assert(sizeof(HW_COUNTER_CONFIGS) / sizeof(HW_COUNTER_CONFIGS[0]) == static_cast<size_t>(HwCounter::Count));
+
+constexpr size_t HW_COUNTERS{static_cast<size_t>(HwCounter::Count)};
+constexpr size_t STAGES{static_cast<size_t>(Stage::Count)};
+
+class StageMeter
+{
+public:
+    // Called on the worker's own thread when it leaves `from`; time spent
+    // outside any handshake (Stage::Background) is not charged
+    void charge(const Stage from)
+    {
+        ThreadState &state{thread_state()};
+        auto now{std::chrono::steady_clock::now()};
+        StageTotals &totals{state.totals->stages[static_cast<size_t>(from)]};
+        if (from != Stage::Background && state.since != std::chrono::steady_clock::time_point{})
+        {
+            totals.visits.fetch_add(1, std::memory_order_relaxed);
+            totals.nanos.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - state.since).count()),
+                                   std::memory_order_relaxed);
+        }
+        state.since = now;
+
+        // Hardware counters: only deltas between two successful reads count
+        uint64_t values[HW_COUNTERS]{};
+        bool read_ok{hw_enabled_.load(std::memory_order_relaxed) && read_group(state, values)};
+        if (read_ok && state.last_valid)
+        {
+            totals.hw_visits.fetch_add(1, std::memory_order_relaxed);
+            for (size_t i{0}; i < HW_COUNTERS; ++i)
+            {
+                totals.hw[i].fetch_add(values[i] - state.last[i], std::memory_order_relaxed);
+            }
+        }
+        std::copy_n(values, HW_COUNTERS, state.last);
+        state.last_valid = read_ok;
+    }
+
+    void set_hw_enabled(const bool enabled)
+    {
+        hw_enabled_.store(enabled, std::memory_order_relaxed);
+    }
+
+    void reset()
+    {
+        for (const auto &thread : threads())
+        {
+            for (StageTotals &totals : thread->stages)
+            {
+                totals.visits = 0;
+                totals.nanos = 0;
+                totals.hw_visits = 0;
+                for (auto &counter : totals.hw)
+                {
+                    counter = 0;
+                }
+            }
+        }
+    }
+
+    // Per-stage averages over all workers, one line per visited stage
+    std::string report()
+    {
+        uint64_t visits[STAGES]{}, nanos[STAGES]{}, hw_visits[STAGES]{}, hw[STAGES][HW_COUNTERS]{};
+        for (const auto &thread : threads())
+        {
+            for (size_t s{0}; s < STAGES; ++s)
+            {
+                const StageTotals &totals{thread->stages[s]};
+                visits[s] += totals.visits.load(std::memory_order_relaxed);
+                nanos[s] += totals.nanos.load(std::memory_order_relaxed);
+                hw_visits[s] += totals.hw_visits.load(std::memory_order_relaxed);
+                for (size_t i{0}; i < HW_COUNTERS; ++i)
+                {
+                    hw[s][i] += totals.hw[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::string status{!hw_enabled_.load() ? "off" : hw_error_.load() != 0 ? "unavailable (errno " + std::to_string(hw_error_.load()) + ")" : "on"};
+        std::string out{"hardware counters: " + status + "\n"};
+        char line[160]{};
+        std::snprintf(line, sizeof(line), "%-11s %9s %10s %12s %12s %5s %9s %9s\n",
+                      "stage", "visits", "avg_us", "cycles", "instr", "ipc", "llc_miss", "br_miss");
+        out += line;
+        for (size_t s{0}; s < STAGES; ++s)
+        {
+            if (visits[s] == 0)
+            {
+                continue;
+            }
+            double avg_us{static_cast<double>(nanos[s]) / static_cast<double>(visits[s]) / 1000.0};
+            if (hw_visits[s] == 0)
+            {
+                std::snprintf(line, sizeof(line), "%-11s %9lu %10.2f %12s %12s %5s %9s %9s\n", STAGE_NAMES[s],
+                              static_cast<unsigned long>(visits[s]), avg_us, "-", "-", "-", "-", "-");
+            }
+            else
+            {
+                auto avg{[&](HwCounter counter)
+                         { return static_cast<double>(hw[s][static_cast<size_t>(counter)]) / static_cast<double>(hw_visits[s]); }};
+                double cycles{avg(HwCounter::Cycles)};
+                std::snprintf(line, sizeof(line), "%-11s %9lu %10.2f %12.0f %12.0f %5.2f %9.1f %9.1f\n", STAGE_NAMES[s],
+                              static_cast<unsigned long>(visits[s]), avg_us, cycles, avg(HwCounter::Instructions),
+                              cycles > 0 ? avg(HwCounter::Instructions) / cycles : 0.0, avg(HwCounter::LlcMisses),
+                              avg(HwCounter::BranchMisses));
+            }
+            out += line;
+        }
+        out.pop_back(); // The control channel terminates the reply
+        return out;
+    }
+
+private:
+    struct StageTotals
+    {
+        std::atomic<uint64_t> visits{0};
+        std::atomic<uint64_t> nanos{0};
+        std::atomic<uint64_t> hw_visits{0}; // Visits that have hardware deltas
+        std::atomic<uint64_t> hw[HW_COUNTERS]{};
+    };
+
+    // Written only by its thread, read by the control thread
+    struct ThreadTotals
+    {
+        StageTotals stages[STAGES]{};
+    };
+
+    struct ThreadState
+    {
+        std::shared_ptr<ThreadTotals> totals{};
+        std::chrono::steady_clock::time_point since{};
+        int fds[HW_COUNTERS]{-1, -1, -1, -1};
+        bool opened{false}; // Tried to open the group (successfully or not)
+        uint64_t last[HW_COUNTERS]{};
+        bool last_valid{false};
+
+        ~ThreadState()
+        {
+            for (int fd : fds)
+            {
+                if (fd >= 0)
+                {
+                    close(fd);
+                }
+            }
+        }
+    };
+
+    ThreadState &thread_state()
+    {
+        thread_local ThreadState state{};
+        if (!state.totals)
+        {
+            state.totals = std::make_shared<ThreadTotals>();
+            ProfiledLock lock{threads_mutex_};
+            threads_.push_back(state.totals);
+        }
+        return state;
+    }
+
+    std::vector<std::shared_ptr<ThreadTotals>> threads()
+    {
+        ProfiledLock lock{threads_mutex_};
+        return threads_;
+    }
+
+    // Opens this thread's counter group on first use; all four or none
+    bool open_group(ThreadState &state)
+    {
+        state.opened = true;
+        for (size_t i{0}; i < HW_COUNTERS; ++i)
+        {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = HW_COUNTER_CONFIGS[i];
+            attr.read_format = PERF_FORMAT_GROUP;
+            attr.exclude_kernel = 1; // Allowed at perf_event_paranoid <= 2
+            attr.exclude_hv = 1;
+            state.fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, i == 0 ? -1 : state.fds[0], 0));
+            if (state.fds[i] < 0)
+            {
+                hw_error_.store(errno, std::memory_order_relaxed);
+                for (int &fd : state.fds)
+                {
+                    if (fd >= 0)
+                    {
+                        close(fd);
+                    }
+                    fd = -1;
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // One read() returns every counter in the group
+    bool read_group(ThreadState &state, uint64_t (&values)[HW_COUNTERS])
+    {
+        if (!state.opened && !open_group(state))
+        {
+            return false;
+        }
+        if (state.fds[0] < 0)
+        {
+            return false;
+        }
+        uint64_t buffer[1 + HW_COUNTERS]{}; // nr, then values in creation order
+        if (read(state.fds[0], buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)))
+        {
+            return false;
+        }
+        std::copy_n(buffer + 1, HW_COUNTERS, values);
+        return true;
+    }
+
+    std::atomic<bool> hw_enabled_{STAGE_HW_COUNTERS};
+    std::atomic<int> hw_error_{0};
+    ProfiledMutex threads_mutex_{"stage.threads"};
+    std::vector<std::shared_ptr<ThreadTotals>> threads_{};
+};
+
+// === FUNCTION: Access the process-wide stage meter ===
+StageMeter &stage_meter()
+{
+    static StageMeter instance{};
+    return instance;
+}
+
+// === SESSION TRACES ===
+// Every session records a compact event list (stage changes, reads and
+// writes, crypto spans, errors) into a scratch buffer on its worker thread.
+// Whether to keep it is decided only when the session ends (tail-based
+// sampling): 1 in TRACE_SAMPLE_EVERY sessions goes into a per-thread ring of
+// recent traces, and any session slower than the thread's current
+// TRACE_SLOWEST_KEPT slowest replaces the fastest of those. The control
+// command "trace" exports everything kept as Chrome trace JSON
+// (chrome://tracing, ui.perfetto.dev).
+
+enum class TraceEventType : uint8_t
+{
+    Stage,
+    Read,
+    Write,
+    CryptoBegin,
+    CryptoEnd,
+    Error
+};
+
+enum class TraceOutcome : uint8_t
+{
+    Success,
+    Failure,
+    Rejected,
+    Error,
+    Expired
+};
+
+constexpr const char *TRACE_OUTCOME_NAMES[]{"success", "failure", "rejected", "error", "expired"};
+
+struct TraceEvent
+{
+    uint64_t ns{0};
+    TraceEventType type{TraceEventType::Stage};
+    Stage stage{Stage::Background};
+    uint16_t reserved{0};
+    uint32_t value{0}; // Bytes for reads and writes
+};
+static_assert(sizeof(TraceEvent) == 16);
+
+// Kernel's view of the connection at close (see sample_tcp_info())
+struct TcpInfoSample
+{
+    bool valid{false};
+    uint32_t rtt_us{0};
+    uint32_t rttvar_us{0};
+    uint32_t retransmits{0};
+    uint32_t cwnd{0};
+    uint64_t delivery_rate{0}; // Bytes per second
+};
+
+struct SessionTrace
+{
+    uint64_t id{0};
+    uint64_t start_ns{0};
+    uint64_t end_ns{0};
+    uint32_t peer_ipv4{0};
+    TraceOutcome outcome{TraceOutcome::Error};
+    uint16_t event_count{0};
+    TcpInfoSample tcp{};
+    TraceEvent events[TRACE_MAX_EVENTS]{};
+
+    uint64_t duration() const
+    {
+        return end_ns - start_ns;
+    }
+};
+
+class Tracer
+{
+public:
+    void begin_session(const uint32_t peer_ipv4)
+    {
+        ThreadState &state{thread_state()};
+        SessionTrace &session{state.current};
+        session.id = next_id_.fetch_add(1, std::memory_order_relaxed);
+        session.start_ns = now_ns();
+        session.peer_ipv4 = peer_ipv4;
+        session.event_count = 0;
+        session.tcp = {};
+        state.active = true;
+    }
+
+    void attach_tcp_info(const TcpInfoSample &sample)
+    {
+        ThreadState &state{thread_state()};
+        if (state.active)
+        {
+            state.current.tcp = sample;
+        }
+    }
+
+    // Whether the running session is already slower than one of the slowest
+    // kept on this thread, i.e. its trace will be kept if it ends now
+    bool slow_so_far()
+    {
+        ThreadState &state{thread_state()};
+        if (!state.active)
+        {
+            return false;
+        }
+        uint64_t elapsed{now_ns() - state.current.start_ns};
+        ProfiledLock lock{state.kept->mutex};
+        return std::any_of(std::begin(state.kept->slowest), std::end(state.kept->slowest),
+                           [&](const SessionTrace &kept)
+                           { return elapsed > kept.duration(); });
+    }
+
+    // No-op outside a session (e.g. on the control thread)
+    void event(const TraceEventType type, const uint32_t value = 0)
+    {
+        ThreadState &state{thread_state()};
+        SessionTrace &session{state.current};
+        if (!state.active || session.event_count == TRACE_MAX_EVENTS)
+        {
+            return;
+        }
+        session.events[session.event_count++] = TraceEvent{now_ns(), type, current_stage, 0, value};
+    }
+
+    // Decides whether the finished session is kept
+    void end_session(const TraceOutcome outcome)
+    {
+        ThreadState &state{thread_state()};
+        if (!state.active)
+        {
+            return;
+        }
+        state.active = false;
+        SessionTrace &session{state.current};
+        session.end_ns = now_ns();
+        session.outcome = outcome;
+
+        ThreadTraces &kept{*state.kept};
+        bool sampled{++state.sessions % TRACE_SAMPLE_EVERY == 0};
+        ProfiledLock lock{kept.mutex};
+        auto fastest{std::min_element(std::begin(kept.slowest), std::end(kept.slowest),
+                                      [](const SessionTrace &a, const SessionTrace &b)
+                                      { return a.duration() < b.duration(); })};
+        bool slow{session.duration() > fastest->duration()};
+        if (sampled)
+        {
+            kept.recent[kept.recent_next++ % TRACE_RING_SESSIONS] = session;
+        }
+        if (slow)
+        {
+            *fastest = session;
+        }
+    }
+
+    void reset()
+    {
+        for (const auto &thread : threads())
+        {
+            ProfiledLock lock{thread->mutex};
+            std::fill(std::begin(thread->recent), std::end(thread->recent), SessionTrace{});
+            std::fill(std::begin(thread->slowest), std::end(thread->slowest), SessionTrace{});
+        }
+    }
+
+    // Writes every kept session to TRACE_OUTPUT_PATH, one track per worker
+    std::string export_chrome()
+    {
+        std::vector<std::pair<size_t, SessionTrace>> sessions{}; // (thread index, trace)
+        std::vector<uint64_t> seen{};
+        auto threads_now{threads()};
+        for (size_t t{0}; t < threads_now.size(); ++t)
+        {
+            ProfiledLock lock{threads_now[t]->mutex};
+            for (const SessionTrace *list : {threads_now[t]->recent, threads_now[t]->slowest})
+            {
+                size_t size{list == threads_now[t]->recent ? TRACE_RING_SESSIONS : TRACE_SLOWEST_KEPT};
+                for (size_t i{0}; i < size; ++i)
+                {
+                    // A session can be both sampled and slow; export it once
+                    if (list[i].end_ns != 0 && std::find(seen.begin(), seen.end(), list[i].id) == seen.end())
+                    {
+                        seen.push_back(list[i].id);
+                        sessions.emplace_back(t, list[i]);
+                    }
+                }
+            }
+        }
+
+        uint64_t origin{UINT64_MAX};
+        for (const auto &[thread, session] : sessions)
+        {
+            origin = std::min(origin, session.start_ns);
+        }
+
+        std::ofstream out{TRACE_OUTPUT_PATH, std::ios::trunc};
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write " + TRACE_OUTPUT_PATH);
+        }
+        out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+        bool first{true};
+        auto emit{[&](const std::string &json)
+                  {
+                      out << (first ? "\n" : ",\n") << json;
+                      first = false;
+                  }};
+        auto us{[&](uint64_t ns)
+                { return std::to_string(static_cast<double>(ns - origin) / 1000.0); }};
+        auto span{[&](size_t thread, const std::string &name, const char *category, uint64_t begin, uint64_t end,
+                      const std::string &args)
+                  {
+                      emit("{\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(thread) + ",\"name\":\"" + name +
+                           "\",\"cat\":\"" + category + "\",\"ts\":" + us(begin) + ",\"dur\":" +
+                           std::to_string(static_cast<double>(end - begin) / 1000.0) + ",\"args\":{" + args + "}}");
+                  }};
+
+        for (const auto &[thread, session] : sessions)
+        {
+            const unsigned char *ip{reinterpret_cast<const unsigned char *>(&session.peer_ipv4)};
+            std::string peer{std::to_string(ip[0]) + "." + std::to_string(ip[1]) + "." + std::to_string(ip[2]) + "." +
+                             std::to_string(ip[3])};
+            std::string args{"\"peer\":\"" + peer + "\",\"outcome\":\"" +
+                             TRACE_OUTCOME_NAMES[static_cast<size_t>(session.outcome)] + "\""};
+            if (session.tcp.valid)
+            {
+                args += ",\"tcp_rtt_us\":" + std::to_string(session.tcp.rtt_us) +
+                        ",\"tcp_rttvar_us\":" + std::to_string(session.tcp.rttvar_us) +
+                        ",\"tcp_retransmits\":" + std::to_string(session.tcp.retransmits) +
+                        ",\"tcp_cwnd\":" + std::to_string(session.tcp.cwnd) +
+                        ",\"tcp_delivery_rate_Bps\":" + std::to_string(session.tcp.delivery_rate);
+            }
+            span(thread, "session " + std::to_string(session.id), "session", session.start_ns, session.end_ns, args);
+
+            uint64_t stage_start{session.start_ns};
+            Stage stage{Stage::Accept};
+            uint64_t crypto_start{0};
+            for (size_t i{0}; i < session.event_count; ++i)
+            {
+                const TraceEvent &event{session.events[i]};
+                switch (event.type)
+                {
+                case TraceEventType::Stage:
+                    span(thread, STAGE_NAMES[static_cast<size_t>(stage)], "stage", stage_start, event.ns, {});
+                    stage = event.stage;
+                    stage_start = event.ns;
+                    break;
+                case TraceEventType::Read:
+                case TraceEventType::Write:
+                case TraceEventType::Error:
+                {
+                    const char *name{event.type == TraceEventType::Read    ? "read"
+                                     : event.type == TraceEventType::Write ? "write"
+                                                                           : "error"};
+                    emit(std::string("{\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":") + std::to_string(thread) +
+                         ",\"name\":\"" + name + "\",\"ts\":" + us(event.ns) + ",\"args\":{\"bytes\":" +
+                         std::to_string(event.value) + "}}");
+                    break;
+                }
+                case TraceEventType::CryptoBegin:
+                    crypto_start = event.ns;
+                    break;
+                case TraceEventType::CryptoEnd:
+                    span(thread, "crypto", "crypto", crypto_start, event.ns, {});
+                    break;
+                }
+            }
+            span(thread, STAGE_NAMES[static_cast<size_t>(stage)], "stage", stage_start, session.end_ns, {});
+        }
+        out << "\n]}\n";
+
+        return std::to_string(sessions.size()) + " sessions written to " + TRACE_OUTPUT_PATH;
+    }
+
+private:
+    // Traces kept by one thread; the mutex is only contended while exporting
+    struct ThreadTraces
+    {
+        ProfiledMutex mutex{"trace.kept"};
+        SessionTrace recent[TRACE_RING_SESSIONS]{};
+        size_t recent_next{0};
+        SessionTrace slowest[TRACE_SLOWEST_KEPT]{};
+    };
+
+    struct ThreadState
+    {
+        std::shared_ptr<ThreadTraces> kept{};
+        SessionTrace current{};
+        bool active{false};
+        uint64_t sessions{0};
+    };
+
+    static uint64_t now_ns()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    ThreadState &thread_state()
+    {
+        thread_local ThreadState state{};
+        if (!state.kept)
+        {
+            state.kept = std::make_shared<ThreadTraces>();
+            ProfiledLock lock{threads_mutex_};
+            threads_.push_back(state.kept);
+        }
+        return state;
+    }
+
+    std::vector<std::shared_ptr<ThreadTraces>> threads()
+    {
+        ProfiledLock lock{threads_mutex_};
+        return threads_;
+    }
+
+    std::atomic<uint64_t> next_id_{1};
+    ProfiledMutex threads_mutex_{"trace.threads"};
+    std::vector<std::shared_ptr<ThreadTraces>> threads_{};
+};
+
+// === FUNCTION: Access the process-wide tracer ===
+Tracer &tracer()
+{
+    static Tracer instance{};
+    return instance;
+}
+
+// === TCP_INFO SAMPLING ===
+// Just before closing a sampled session (1 in TCP_INFO_SAMPLE_EVERY, or any
+// session slow enough that its trace will be kept) we read the kernel's view
+// of the connection. A slow session with a high RTT or retransmits points at
+// the network or the client; a slow session with a clean TCP_INFO points at us.
+
+struct TcpInfoHistograms
+{
+    Histogram rtt_us{};
+    Histogram rttvar_us{};
+    Histogram retransmits{};
+    Histogram cwnd{};
+    Histogram delivery_rate{}; // Bytes per second
+
+    void reset()
+    {
+        for (Histogram *histogram : {&rtt_us, &rttvar_us, &retransmits, &cwnd, &delivery_rate})
+        {
+            histogram->reset();
+        }
+    }
+
+    std::string report() const
+    {
+        return rtt_us.report("tcp_rtt_us") + "\n" + rttvar_us.report("tcp_rttvar_us") + "\n" +
+               retransmits.report("tcp_retransmits") + "\n" + cwnd.report("tcp_cwnd") + "\n" +
+               delivery_rate.report("tcp_delivery_rate_Bps");
+    }
+};
+
+// === FUNCTION: Access the TCP_INFO histograms ===
+TcpInfoHistograms &tcp_info_histograms()
+{
+    static TcpInfoHistograms instance{};
+    return instance;
+}
+
+// === FUNCTION: Sample TCP_INFO for the current session if it is selected ===
+void sample_tcp_info(const int sock)
+{
+    thread_local uint64_t sessions{0};
+    if (++sessions % TCP_INFO_SAMPLE_EVERY != 0 && !tracer().slow_so_far())
+    {
+        return;
+    }
+
+    tcp_info info{};
+    socklen_t length{sizeof(info)};
+    if (getsockopt(sock, IPPROTO_TCP, TCP_INFO, &info, &length) < 0)
+    {
+        return;
+    }
+    TcpInfoSample sample{true, info.tcpi_rtt, info.tcpi_rttvar, info.tcpi_total_retrans, info.tcpi_snd_cwnd,
+                         info.tcpi_delivery_rate};
+    tracer().attach_tcp_info(sample);
+
+    TcpInfoHistograms &histograms{tcp_info_histograms()};
+    histograms.rtt_us.record(sample.rtt_us);
+    histograms.rttvar_us.record(sample.rttvar_us);
+    histograms.retransmits.record(sample.retransmits);
+    histograms.cwnd.record(sample.cwnd);
+    histograms.delivery_rate.record(sample.delivery_rate);
+}
+
+// === FUNCTION: Mark the calling thread's handshake stage ===
+void enter_stage(const Stage stage)
+{
+    stage_meter().charge(current_stage);
+    current_stage = stage;
+    tracer().event(TraceEventType::Stage);
+}
+
+// === FUNCTION: Read data from socket ===
+// The kernel's receive timestamp, if any, comes back as ancillary data.
+std::string read_message(const int sock)
+{
+    char buffer[1024]{}; // Temporary buffer for incoming message
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(scm_timestamping))];
+    iovec io{buffer, sizeof(buffer)};
+    msghdr msg{};
+    msg.msg_iov = &io;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+    ssize_t bytes_read{recvmsg(sock, &msg, 0)};
+    last_read_timed_out = bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+
+    last_queueing_delay_ns = 0;
+    for (cmsghdr *cmsg{bytes_read > 0 ? CMSG_FIRSTHDR(&msg) : nullptr}; cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+        {
+            scm_timestamping stamps{};
+            std::copy_n(CMSG_DATA(cmsg), sizeof(stamps), reinterpret_cast<unsigned char *>(&stamps));
+            timespec now{};
+            clock_gettime(CLOCK_REALTIME, &now); // Software timestamps use the realtime clock
+            int64_t delay{(now.tv_sec - stamps.ts[0].tv_sec) * 1'000'000'000 + (now.tv_nsec - stamps.ts[0].tv_nsec)};
+            if (stamps.ts[0].tv_sec != 0 && delay >= 0)
+            {
+                last_queueing_delay_ns = static_cast<uint64_t>(delay);
+                queueing_delay().record(last_queueing_delay_ns);
+            }
+        }
+    }
+    tracer().event(TraceEventType::Read, static_cast<uint32_t>(std::max<ssize_t>(bytes_read, 0)));
+
+    // Use explicit if-else for clarity instead of ternary
+    if (bytes_read > 0)
+    {
+        return std::string(buffer, bytes_read);
+    }
+    else
+    {
+        return std::string();
+    }
+}
+
+// === FUNCTION: Bound how long reads on a socket may block ===
+// A zero timeout blocks indefinitely. A read that times out returns nothing
+// and sets last_read_timed_out.
+void set_receive_timeout(const int sock, const std::chrono::microseconds timeout)
+{
+    timeval tv{static_cast<time_t>(timeout.count() / 1'000'000), static_cast<suseconds_t>(timeout.count() % 1'000'000)};
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+// === FUNCTION: Send message to socket ===
+void send_message(const int sock, const std::string &msg)
+{
+    // Write the entire message over the TCP connection. Clients that hit their
+    // deadline hang up mid-session, so a closed peer must not raise SIGPIPE.
+    send(sock, msg.c_str(), msg.length(), MSG_NOSIGNAL);
+    tracer().event(TraceEventType::Write, static_cast<uint32_t>(msg.length()));
+}
+
+// === CLIENT PUZZLES (PROOF OF WORK) ===
+// A flood of fake hellos would make us generate a challenge and compute an
+// HMAC for each one while the attacker pays nothing. When the hello rate is
+// above PUZZLE_LOAD_THRESHOLD, the server first answers a hello with
+//
+//     "PUZZLE" | difficulty (1 byte) | seed (16 random bytes)
+//
+// and only continues once the client returns an 8-byte nonce such that
+// SHA256(seed || nonce) starts with `difficulty` zero bits. Checking a solution
+// costs one hash; finding one costs the client about 2^difficulty hashes.
+
+constexpr const char *PUZZLE_TAG{"PUZZLE"};
+constexpr size_t PUZZLE_SEED_SIZE{16};
+constexpr size_t PUZZLE_NONCE_SIZE{8};
+constexpr uint64_t PUZZLE_LOAD_THRESHOLD{2000}; // Hellos per second before puzzles kick in
+constexpr uint8_t PUZZLE_MIN_DIFFICULTY{12};    // ~4k hashes for the client
+constexpr uint8_t PUZZLE_MAX_DIFFICULTY{24};    // ~16M hashes for the client
+
+// How long a worker waits for a solution: twice the expected solving time at
+// PUZZLE_CLIENT_HASH_RATE plus a round trip's slack, capped. A client that takes
+// the puzzle and never answers holds the worker no longer than this.
+constexpr uint64_t PUZZLE_CLIENT_HASH_RATE{1'000'000}; // Hashes per second of a slow client
+constexpr auto PUZZLE_ANSWER_SLACK{std::chrono::milliseconds(200)};
+constexpr auto PUZZLE_MAX_ANSWER_WINDOW{std::chrono::seconds(10)};
+
+// Why a client was turned away at the puzzle
+enum class PuzzleRejection : uint8_t
+{
+    Wrong,    // Answered with a nonce that doesn't solve it (or hung up)
+    TimedOut, // No answer within the window
+    Count
+};
+
+constexpr const char *PUZZLE_REJECTION_NAMES[]{"wrong", "timed_out"};
+static_assert(sizeof(PUZZLE_REJECTION_NAMES) / sizeof(PUZZLE_REJECTION_NAMES[0]) == static_cast<size_t>(PuzzleRejection::Count));
+
+// Tracks the hello rate over one-second windows and turns it into a puzzle difficulty
+class OverloadController
+{
+public:
+    // Called with each hello's kernel-to-read delay (0 = unknown). Kept as an
+    // EWMA with weight 1/8; racing updates may drop a sample, which is fine.
+    void note_queueing_delay(const uint64_t delay_ns)
+    {
+        if (delay_ns == 0)
+        {
+            return;
+        }
+        auto average{static_cast<int64_t>(queueing_ewma_ns_.load(std::memory_order_relaxed))};
+        average += (static_cast<int64_t>(delay_ns) - average) / 8;
+        queueing_ewma_ns_.store(static_cast<uint64_t>(average), std::memory_order_relaxed);
+    }
+
+    // Called once per incoming hello
+    void note_hello()
+    {
+        uint64_t second{now_seconds()};
+        uint64_t window{window_.load(std::memory_order_relaxed)};
+        if (second != window && window_.compare_exchange_strong(window, second, std::memory_order_relaxed))
+        {
+            // First hello of a new second: publish the rate of the one that ended
+            uint64_t count{count_.exchange(0, std::memory_order_relaxed)};
+            last_rate_.store(second == window + 1 ? count : 0, std::memory_order_relaxed);
+            flight_recorder().record(FlightEvent::HelloRate, 0, second == window + 1 ? count : 0);
+        }
+        count_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // 0 = no puzzle; otherwise the number of leading zero bits to demand.
+    // Each doubling of the rate above the threshold adds two bits. A queueing
+    // delay above its threshold only asks for the minimum: a worker waits for
+    // the solution, so scaling with the delay would feed on itself.
+    uint8_t puzzle_difficulty() const
+    {
+        uint64_t rate{last_rate_.load(std::memory_order_relaxed)};
+        if (rate <= PUZZLE_LOAD_THRESHOLD)
+        {
+            return queueing_ewma_ns_.load(std::memory_order_relaxed) > QUEUEING_DELAY_THRESHOLD_NS ? PUZZLE_MIN_DIFFICULTY : 0;
+        }
+        uint64_t difficulty{PUZZLE_MIN_DIFFICULTY};
+        for (uint64_t r{rate / PUZZLE_LOAD_THRESHOLD}; r > 1 && difficulty < PUZZLE_MAX_DIFFICULTY; r >>= 1)
+        {
+            difficulty += 2;
+        }
+        return static_cast<uint8_t>(std::min<uint64_t>(difficulty, PUZZLE_MAX_DIFFICULTY));
+    }
+
+    // Called for each client turned away at the puzzle
+    void note_rejection(const PuzzleRejection reason)
+    {
+        rejections_[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::string report() const
+    {
+        std::string out{"puzzle_rejections"};
+        for (size_t i{0}; i < static_cast<size_t>(PuzzleRejection::Count); ++i)
+        {
+            out += std::string(" ") + PUZZLE_REJECTION_NAMES[i] + "=" +
+                   std::to_string(rejections_[i].load(std::memory_order_relaxed));
+        }
+        return out;
+    }
+
+    void reset()
+    {
+        for (auto &count : rejections_)
+        {
+            count.store(0, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    static uint64_t now_seconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                         std::chrono::steady_clock::now().time_since_epoch())
+                                         .count());
+    }
+
+    std::atomic<uint64_t> window_{0};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> last_rate_{0};
+    std::atomic<uint64_t> queueing_ewma_ns_{0};
+    std::atomic<uint64_t> rejections_[static_cast<size_t>(PuzzleRejection::Count)]{};
+};
+
+// === FUNCTION: Access the process-wide overload controller ===
+OverloadController &overload_controller()
+{
+    static OverloadController instance{};
+    return instance;
+}
+
+// === FUNCTION: Check a puzzle solution with a single hash ===
+bool verify_puzzle(const std::string &seed, const std::string &nonce, uint8_t difficulty)
+{
+    if (nonce.length() != PUZZLE_NONCE_SIZE)
+    {
+        return false;
+    }
+
+    std::string input{seed + nonce};
+    unsigned char digest[EVP_MAX_MD_SIZE]{};
+    unsigned int digest_len{0};
+    if (!EVP_Digest(input.data(), input.length(), digest, &digest_len, sha256_md(), nullptr))
+    {
+        throw std::runtime_error("Puzzle verification failed");
+    }
+
+    // Count leading zero bits
+    for (unsigned int i{0}; i < digest_len && difficulty > 0; ++i)
+    {
+        if (difficulty >= 8)
+        {
+            if (digest[i] != 0)
+            {
+                return false;
+            }
+            difficulty -= 8;
+        }
+        else
+        {
+            return (digest[i] >> (8 - difficulty)) == 0;
+        }
+    }
+    return difficulty == 0;
+}
+
+// === FUNCTION: How long to wait for a puzzle solution ===
+std::chrono::microseconds puzzle_answer_window(const uint8_t difficulty)
+{
+    auto solving{std::chrono::microseconds(2 * (uint64_t{1} << difficulty) * 1'000'000 / PUZZLE_CLIENT_HASH_RATE)};
+    return std::min<std::chrono::microseconds>(PUZZLE_ANSWER_SLACK + solving, PUZZLE_MAX_ANSWER_WINDOW);
+}
+
+// === FUNCTION: Make the client pay before we do real work ===
+// Returns false if the client must be turned away. The solution is only
+// waited for within puzzle_answer_window(), so taking puzzles and never
+// answering can't pin the workers. A nonzero `deadline_left` (the client's
+// remaining budget) shortens the wait further; a read cut short by it is not
+// a puzzle rejection but a missed deadline, which the caller's deadline check
+// drops (last_read_timed_out stays set).
+bool admit_client(const int client_sock, const std::chrono::microseconds deadline_left)
+{
+    uint8_t difficulty{overload_controller().puzzle_difficulty()};
+    if (difficulty == 0)
+    {
+        return true;
+    }
+
+    std::string seed{generate_challenge(PUZZLE_SEED_SIZE)};
+    send_message(client_sock, std::string(PUZZLE_TAG) + static_cast<char>(difficulty) + seed);
+    std::chrono::microseconds window{puzzle_answer_window(difficulty)};
+    bool deadline_bound{deadline_left.count() != 0 && deadline_left < window};
+    set_receive_timeout(client_sock, deadline_bound ? deadline_left : window);
+    std::string nonce{read_message(client_sock)};
+    bool timed_out{last_read_timed_out};
+    set_receive_timeout(client_sock, {});
+
+    if (timed_out && deadline_bound)
+    {
+        return true;
+    }
+    if (timed_out || !verify_puzzle(seed, nonce, difficulty))
+    {
+        overload_controller().note_rejection(timed_out ? PuzzleRejection::TimedOut : PuzzleRejection::Wrong);
+        return false;
+    }
+    return true;
+}
+
+// === DEADLINES ===
+// A client may put its time budget in the hello ("deadline=<ms>"). The budget
+// starts when the kernel received the hello, so time spent queued before we
+// read it counts too. At each checkpoint below, a session past its deadline
+// gets "Deadline exceeded." instead of further work, since the client has
+// already given up; each drop is counted by the work it skipped. Reads after
+// the hello block for at most the time left (SO_RCVTIMEO), so a client that
+// goes silent frees its worker at the deadline rather than whenever it hangs
+// up; a read that times out counts as a drop at the next checkpoint.
+
+enum class DeadlineCheck : uint8_t
+{
+    Queueing,  // Hello read after the deadline: skipped everything
+    Challenge, // Passed while solving a puzzle: skipped the credential lookup, challenge and verification
+    Verify,    // Proof arrived too late: skipped hashing and the audit record
+    Count
+};
+
+constexpr const char *DEADLINE_CHECK_NAMES[]{"queueing", "challenge", "verify"};
+static_assert(sizeof(DEADLINE_CHECK_NAMES) / sizeof(DEADLINE_CHECK_NAMES[0]) == static_cast<size_t>(DeadlineCheck::Count));
+
+// Sessions dropped at each checkpoint
+std::atomic<uint64_t> deadline_drops[static_cast<size_t>(DeadlineCheck::Count)]{};
+
+// === FUNCTION: Report sessions dropped for missed deadlines ===
+std::string deadline_report()
+{
+    std::string out{"deadline_exceeded"};
+    for (size_t i{0}; i < static_cast<size_t>(DeadlineCheck::Count); ++i)
+    {
+        out += std::string(" ") + DEADLINE_CHECK_NAMES[i] + "=" +
+               std::to_string(deadline_drops[i].load(std::memory_order_relaxed));
+    }
+    return out;
+}
+
+// === FUNCTION: Handle One Client Session ===
+void handle_client(const int client_sock, const sockaddr_in &client_addr, const CredentialDatabase &credentials)
+{
+    auto started{std::chrono::steady_clock::now()};
+
+    // Step 1: Expect "hello <username> [<mode>] [deadline=<ms>]" from client
+    enter_stage(Stage::ReadHello);
+    std::string hello{read_message(client_sock)};
+    logger().log(LogFormat::ClientHello, hello);
+    overload_controller().note_hello();
+    overload_controller().note_queueing_delay(last_queueing_delay_ns);
+    hello_arrival = std::chrono::steady_clock::now() - std::chrono::nanoseconds(last_queueing_delay_ns);
+    auto [username, mode, deadline_ms]{parse_hello(hello)};
+
+    // Drops the session if the client's deadline has passed, or the last read
+    // gave up waiting for it; true if it did
+    auto deadline{hello_arrival + std::chrono::milliseconds(deadline_ms)};
+    auto expired{[&](DeadlineCheck check)
+                 {
+                     if (deadline_ms == 0 || (!last_read_timed_out && std::chrono::steady_clock::now() < deadline))
+                     {
+                         return false;
+                     }
+                     deadline_drops[static_cast<size_t>(check)].fetch_add(1, std::memory_order_relaxed);
+                     send_message(client_sock, "Deadline exceeded.");
+                     sample_tcp_info(client_sock);
+                     close(client_sock);
+                     tracer().end_session(TraceOutcome::Expired);
+                     flight_recorder().record(FlightEvent::DeadlineExceeded, client_addr.sin_addr.s_addr,
+                                              static_cast<uint64_t>(check));
+                     return true;
+                 }};
+
+    // Time left before the deadline, for bounding reads; 0 = no deadline
+    auto deadline_left{[&]
+                       {
+                           if (deadline_ms == 0)
+                           {
+                               return std::chrono::microseconds{0};
+                           }
+                           auto left{std::chrono::duration_cast<std::chrono::microseconds>(
+                               deadline - std::chrono::steady_clock::now())};
+                           return std::max(left, std::chrono::microseconds{1}); // 0 would mean no timeout
+                       }};
+    if (expired(DeadlineCheck::Queueing))
+    {
+        return;
+    }
+
+    // Step 1b: Under load, require a solved puzzle before doing any real work
+    enter_stage(Stage::Puzzle);
+    if (!admit_client(client_sock, deadline_left()))
+    {
+        send_message(client_sock, "Puzzle not solved.");
+        sample_tcp_info(client_sock);
+        close(client_sock);
+        tracer().end_session(TraceOutcome::Rejected);
+        flight_recorder().record(FlightEvent::Rejected, client_addr.sin_addr.s_addr);
+        return;
+    }
+    if (expired(DeadlineCheck::Challenge))
+    {
+        return;
+    }
+    auto user{credentials.find(username)};
+
+    // Step 2: Generate a random challenge and send it to the client
+    // In SCRAM mode it is preceded by the user's salt and iteration count:
+    //   salt (16 bytes) | iterations (4 bytes, big endian) | challenge (16 bytes)
+    // Unknown users get a decoy salt that is just as stable as a real one (see
+    // scram_decoy_salt()) and the default iteration count, so the challenge
+    // doesn't reveal whether the user exists.
+    enter_stage(Stage::Challenge);
+    std::string challenge{generate_challenge()};
+    if (mode == "scram")
+    {
+        bool known{user != credentials.end() && user->second.scram.iterations != 0};
+        std::string salt{known ? std::string(user->second.scram.salt.data(), SCRAM_SALT_SIZE) : scram_decoy_salt(username)};
+        uint32_t iterations{known ? user->second.scram.iterations : SCRAM_ITERATIONS};
+        std::string count{static_cast<char>(iterations >> 24), static_cast<char>(iterations >> 16),
+                          static_cast<char>(iterations >> 8), static_cast<char>(iterations)};
+        send_message(client_sock, salt + count + challenge);
+    }
+    else
+    {
+        send_message(client_sock, challenge);
+    }
+
+    // Step 3: Receive client’s proof (HMAC digest, Ed25519 signature or SCRAM proof)
+    enter_stage(Stage::ReadProof);
+    if (deadline_ms != 0)
+    {
+        set_receive_timeout(client_sock, deadline_left());
+    }
+    std::string client_proof{read_message(client_sock)};
+    if (expired(DeadlineCheck::Verify))
+    {
+        return;
+    }
+
+    // Step 4: Check the proof against the user's credentials
+    // Unknown users still get a challenge so they can't probe which names exist
+    enter_stage(Stage::Verify);
+    bool authenticated{false};
+    std::string server_signature{};
+    tracer().event(TraceEventType::CryptoBegin);
+    if (user != credentials.end())
+    {
+        if (mode == "scram")
+        {
+            authenticated = user->second.scram.iterations != 0 &&
+                            verify_scram(username + "," + challenge, client_proof, user->second.scram, server_signature);
+        }
+        else if (mode == "ed25519")
+        {
+            authenticated = user->second.ed25519_public &&
+                            ed25519_batcher().verify(challenge, client_proof, *user->second.ed25519_public);
+        }
+        else if (mode.empty())
+        {
+            // Compute our own digest using the same challenge + the user's key state
+            authenticated = user->second.hmac && client_proof == compute_hmac(challenge, user->second.hmac);
+        }
+    }
+
+    tracer().event(TraceEventType::CryptoEnd);
+
+    // Step 5: Decide the outcome
+    std::string response{};
+    AuditVerdict verdict{};
+    if (authenticated)
+    {
+        response = "Authentication successful. Welcome!";
+        verdict = AuditVerdict::Success;
+
+        // SCRAM: prove the server side too (hex of HMAC(ServerKey, AuthMessage))
+        if (!server_signature.empty())
+        {
+            static constexpr char HEX[]{"0123456789abcdef"};
+            response += " v=";
+            for (unsigned char b : server_signature)
+            {
+                response += HEX[b >> 4];
+                response += HEX[b & 15];
+            }
+        }
+    }
+    else
+    {
+        response = "Authentication failed.";
+        verdict = AuditVerdict::Failure;
+    }
+
+    // Persist the verdict before telling the client (see AuditAck)
+    enter_stage(Stage::Audit);
+    audit_log().append(verdict, username, client_addr.sin_addr.s_addr);
+
+    // Step 6: Send result back to client
+    enter_stage(Stage::Reply);
+    send_message(client_sock, response);
+
+    // Step 7: Close client connection
+    sample_tcp_info(client_sock);
+    close(client_sock);
+    tracer().end_session(authenticated ? TraceOutcome::Success : TraceOutcome::Failure);
+    flight_recorder().record(FlightEvent::Verdict, client_addr.sin_addr.s_addr, static_cast<uint64_t>(verdict),
+                             static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                       std::chrono::steady_clock::now() - started)
+                                                       .count()));
+}
+
+// === FUNCTION: Touch a thread's stack ahead of time ===
+// Fresh thread stacks are mapped lazily; writing to them now moves the page
+// faults out of the first handshakes.
+void prefault_stack()
+{
+    volatile char probe[STACK_PREFAULT_BYTES];
+    for (size_t i{0}; i < sizeof(probe); i += 4096)
     {
-        throw std::runtime_error("Failed to generate random challenge");
+        probe[i] = 0;
     }
-    // reinterpret_cast is used to treat raw bytes as char* for std::string construction
-    // This is safe because we're specifying the exact length and OpenSSL guarantees buffer is filled
-    return std::string(reinterpret_cast<char *>(buffer), length);
 }
 
-// === FUNCTION: Compute HMAC using SHA1 ===
-// Parameters:
-// - data: the challenge string to hash
-// - key: the shared secret (known to both client and server)
-//
-// Returns:
-// - A binary string (raw bytes) that represents the HMAC result
-std::string compute_hmac(const std::string &data, const std::string &key)
+// === FUNCTION: Warm up the calling worker thread ===
+// Runs each per-thread lazy initialisation once (SHA code paths, DRBG
+// and challenge pool, log ring, audit buffer, stack pages) so
+// the first real handshake on this thread pays none of it.
+void warm_up_thread(const CredentialDatabase &credentials)
+{
+    prefault_stack();
+
+    std::string challenge{generate_challenge()};
+    for (const auto &[username, record] : credentials)
+    {
+        if (record.hmac)
+        {
+            compute_hmac(challenge, record.hmac);
+            compute_hmac(challenge, record.scram.stored_key_hmac);
+        }
+        if (record.ed25519_public)
+        {
+            ed25519_batch::verify_single(challenge, std::string(ED25519_SIGNATURE_SIZE, '\0'), *record.ed25519_public);
+        }
+    }
+    compute_hmac(challenge, hmac_midstate::make_key_state(hmac_midstate::Digest::Sha1, "warm-up"));
+    verify_puzzle(challenge, std::string(PUZZLE_NONCE_SIZE, '\0'), 1);
+
+    logger().register_thread();
+    audit_log().register_thread();
+    stage_meter().charge(Stage::Background); // Registers this thread's totals
+    tracer().end_session(TraceOutcome::Error); // Registers this thread's trace buffers
+    flight_recorder().register_thread("worker");
+}
+
+// === WORKER IDLE STRATEGIES ===
+// How a worker waits for its next connection on the (non-blocking) listener:
+//   park      sleep in poll() until a connection arrives (lowest CPU)
+//   spin      retry accept() in a tight loop (lowest wake-up latency, a full core)
+//   adaptive  spin for a window, then sched_yield() for IDLE_YIELD_NS, then
+//             park. The window doubles when connections arrive while
+//             spinning, halves (down to IDLE_SPIN_MIN_NS) when the worker had
+//             to park, and drops to zero (park at once: power saving) after a
+//             wait of IDLE_QUIET_NS. The next connection restarts it.
+// Each worker can be switched at runtime ("idle <strategy> [worker]"), and
+// "idle" reports CPU use and handshake p99 for every strategy that ran.
+
+enum class IdleStrategy : uint8_t
+{
+    Park,
+    Spin,
+    Adaptive,
+    Count
+};
+
+constexpr const char *IDLE_STRATEGY_NAMES[]{"park", "spin", "adaptive"};
+static_assert(sizeof(IDLE_STRATEGY_NAMES) / sizeof(IDLE_STRATEGY_NAMES[0]) == static_cast<size_t>(IdleStrategy::Count));
+
+// Strategy every worker starts with, and the adaptive strategy's limits: spin
+// window bounds, yield phase after spinning, and the silence after which a
+// worker stops spinning altogether
+constexpr IdleStrategy DEFAULT_IDLE_STRATEGY{IdleStrategy::Adaptive};
+constexpr int64_t IDLE_SPIN_MIN_NS{5'000};
+constexpr int64_t IDLE_SPIN_MAX_NS{100'000};
+constexpr int64_t IDLE_YIELD_NS{50'000};
+constexpr int64_t IDLE_QUIET_NS{1'000'000'000};
+
+// What one strategy has cost and delivered, summed over the workers using it
+struct IdleStats
+{
+    std::atomic<uint64_t> cpu_ns{0};  // Worker thread CPU time
+    std::atomic<uint64_t> wall_ns{0}; // Wall time over the same iterations
+    std::atomic<uint64_t> spins{0};   // accept() attempts that found nothing
+    std::atomic<uint64_t> yields{0};
+    std::atomic<uint64_t> parks{0};
+    Histogram latency_ns{}; // Hello arrival in the kernel to verdict sent
+};
+
+class IdleController
 {
-    // HMAC() is an OpenSSL-provided function that calculates a keyed hash
-    // using a specified algorithm (here, SHA1)
+public:
+    IdleController()
+    {
+        for (auto &strategy : strategies_)
+        {
+            strategy.store(DEFAULT_IDLE_STRATEGY, std::memory_order_relaxed);
+        }
+    }
 
-    // SHA1 produces a 160-bit (20 byte) result
-    unsigned int len{20};
+    IdleStrategy strategy(const size_t worker) const
+    {
+        return strategies_[worker].load(std::memory_order_relaxed);
+    }
+
+    void set_strategy(const size_t worker, const IdleStrategy strategy)
+    {
+        strategies_[worker].store(strategy, std::memory_order_relaxed);
+    }
+
+    IdleStats &stats(const IdleStrategy strategy)
+    {
+        return stats_[static_cast<size_t>(strategy)];
+    }
 
-    // This is a pointer to a static internal buffer managed by OpenSSL.
-    // We do NOT free this memory, and we SHOULD copy the contents out immediately.
-    unsigned char *raw_result = HMAC(
-        EVP_sha1(),                                                           // Use SHA1 as the hash function
-        key.c_str(), static_cast<int>(key.length()),                          // The key (shared secret)
-        reinterpret_cast<const unsigned char *>(data.c_str()), data.length(), // Message
-        nullptr, nullptr                                                      // Output buffer (NULL = use internal)
-    );
+    void reset()
+    {
+        for (IdleStats &stats : stats_)
+        {
+            for (auto *counter : {&stats.cpu_ns, &stats.wall_ns, &stats.spins, &stats.yields, &stats.parks})
+            {
+                counter->store(0, std::memory_order_relaxed);
+            }
+            stats.latency_ns.reset();
+        }
+    }
 
-    if (!raw_result)
+    std::string report() const
     {
-        throw std::runtime_error("HMAC computation failed");
+        std::string out{"workers:"};
+        for (size_t i{0}; i < WORKER_COUNT; ++i)
+        {
+            out += " " + std::to_string(i) + "=" + IDLE_STRATEGY_NAMES[static_cast<size_t>(strategy(i))];
+        }
+        char line[160]{};
+        std::snprintf(line, sizeof(line), "\n%-9s %10s %8s %12s %12s %10s %10s", "strategy", "handshakes", "cpu%",
+                      "p99_us", "spins", "yields", "parks");
+        out += line;
+        for (size_t s{0}; s < static_cast<size_t>(IdleStrategy::Count); ++s)
+        {
+            const IdleStats &stats{stats_[s]};
+            uint64_t wall{stats.wall_ns.load(std::memory_order_relaxed)};
+            if (wall == 0)
+            {
+                continue;
+            }
+            std::snprintf(line, sizeof(line), "\n%-9s %10lu %8.1f %12.1f %12lu %10lu %10lu", IDLE_STRATEGY_NAMES[s],
+                          static_cast<unsigned long>(stats.latency_ns.count()),
+                          100.0 * static_cast<double>(stats.cpu_ns.load(std::memory_order_relaxed)) / static_cast<double>(wall),
+                          static_cast<double>(stats.latency_ns.percentile(0.99)) / 1000.0,
+                          static_cast<unsigned long>(stats.spins.load(std::memory_order_relaxed)),
+                          static_cast<unsigned long>(stats.yields.load(std::memory_order_relaxed)),
+                          static_cast<unsigned long>(stats.parks.load(std::memory_order_relaxed)));
+            out += line;
+        }
+        return out;
     }
 
-    // Explanation:
-    // Even though HMAC returns a raw pointer, we do NOT use smart pointers here because:
-    // - The memory is not heap-allocated (no malloc/free involved)
-    // - OpenSSL manages its own internal buffers
-    // - Wrapping in smart pointers would give a false sense of ownership
+private:
+    std::atomic<IdleStrategy> strategies_[WORKER_COUNT]{};
+    IdleStats stats_[static_cast<size_t>(IdleStrategy::Count)]{};
+};
 
-    // Convert the raw binary result into a C++ string
-    // Note: This string may contain null bytes (\0), which is safe as we specify length
-    // reinterpret_cast is used here to convert raw bytes into a char* for constructing a std::string
-    // The resulting std::string may contain null bytes, but that's okay since we specify the length
-    return std::string(reinterpret_cast<char *>(raw_result), len);
+// === FUNCTION: Access the process-wide idle controller ===
+IdleController &idle_controller()
+{
+    static IdleController instance{};
+    return instance;
 }
 
-// === FUNCTION: Create and Prepare the Server Socket ===
-int create_server_socket()
+// === FUNCTION: Wait for and accept the next connection ===
+// Returns the accepted socket, or -1 with errno set on a real accept failure.
+// Empty polls are idle time, not part of any handshake's syscall budget.
+int idle_accept(const int server_sock, sockaddr_in &client_addr, const size_t worker, const IdleStrategy strategy,
+                IdleStats &stats)
 {
-    // Create a socket: AF_INET = IPv4, SOCK_STREAM = TCP
-    int sockfd{socket(AF_INET, SOCK_STREAM, 0)};
-    if (sockfd < 0)
+    using Clock = std::chrono::steady_clock;
+    thread_local int64_t spin_window_ns{IDLE_SPIN_MAX_NS};
+
+    auto try_accept{[&]
+                    {
+                        socklen_t addr_len{sizeof(client_addr)};
+                        return accept(server_sock, reinterpret_cast<sockaddr *>(&client_addr), &addr_len);
+                    }};
+    auto found{[](int sock)
+               { return sock >= 0 || (errno != EAGAIN && errno != EWOULDBLOCK); }};
+
+    // The worker goes idle now; the adaptive window is tuned by how long it stays idle
+    auto idle_since{Clock::now()};
+    bool parked{false};
+    int sock{try_accept()};
+    if (strategy == IdleStrategy::Spin)
     {
-        throw std::runtime_error("Socket creation failed");
+        // Re-check the strategy so "idle park" takes effect without a connection
+        while (!found(sock) && idle_controller().strategy(worker) == IdleStrategy::Spin)
+        {
+            stats.spins.fetch_add(1, std::memory_order_relaxed);
+            sock = try_accept();
+        }
+    }
+    if (strategy == IdleStrategy::Adaptive && !found(sock))
+    {
+        // Busy-poll, then yield, within the current window
+        auto spin_until{idle_since + std::chrono::nanoseconds(spin_window_ns)};
+        auto yield_until{spin_until + std::chrono::nanoseconds(spin_window_ns > 0 ? IDLE_YIELD_NS : 0)};
+        for (auto now{Clock::now()}; !found(sock) && now < yield_until; now = Clock::now())
+        {
+            if (now >= spin_until)
+            {
+                sched_yield();
+                stats.yields.fetch_add(1, std::memory_order_relaxed);
+            }
+            else
+            {
+                stats.spins.fetch_add(1, std::memory_order_relaxed);
+            }
+            sock = try_accept();
+        }
+    }
+    while (!found(sock))
+    {
+        // Park; other parked workers may win the race for the connection
+        parked = true;
+        stats.parks.fetch_add(1, std::memory_order_relaxed);
+        pollfd listener{server_sock, POLLIN, 0};
+        poll(&listener, 1, -1);
+        sock = try_accept();
     }
 
-    // Prepare address structure
-    sockaddr_in address{};
-    address.sin_family = AF_INET;         // IPv4
-    address.sin_addr.s_addr = INADDR_ANY; // Accept connections on any interface
-    address.sin_port = htons(PORT);       // Convert port number to network byte order (big endian)
+    if (strategy == IdleStrategy::Adaptive && sock >= 0)
+    {
+        auto now{Clock::now()};
+        auto gap{std::chrono::duration_cast<std::chrono::nanoseconds>(now - idle_since).count()};
+        if (gap >= IDLE_QUIET_NS)
+        {
+            spin_window_ns = 0; // Quiet period: stop burning CPU until load returns
+        }
+        else if (!parked || gap <= IDLE_SPIN_MAX_NS)
+        {
+            spin_window_ns = std::clamp<int64_t>(spin_window_ns * 2, IDLE_SPIN_MIN_NS, IDLE_SPIN_MAX_NS);
+        }
+        else
+        {
+            // Traffic is back (or never stopped), just too sparse to catch by spinning
+            spin_window_ns = std::max<int64_t>(spin_window_ns / 2, IDLE_SPIN_MIN_NS);
+        }
+    }
+    return sock;
+}
 
-    // Bind the socket to the port/IP
-    if (bind(sockfd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
+// === FUNCTION: Mark the end of a worker's idle/serve iteration ===
+// Charges the worker's CPU and wall time since the last call to `stats`
+void charge_idle_iteration(IdleStats &stats)
+{
+    thread_local uint64_t last_cpu_ns{0};
+    thread_local auto last_wall{std::chrono::steady_clock::now()};
+
+    timespec cpu{};
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu);
+    uint64_t cpu_ns{static_cast<uint64_t>(cpu.tv_sec) * 1'000'000'000 + static_cast<uint64_t>(cpu.tv_nsec)};
+    auto now{std::chrono::steady_clock::now()};
+    if (last_cpu_ns != 0)
     {
-        throw std::runtime_error("Bind failed");
+        stats.cpu_ns.fetch_add(cpu_ns - last_cpu_ns, std::memory_order_relaxed);
+        stats.wall_ns.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last_wall).count()),
+                                std::memory_order_relaxed);
     }
+    last_cpu_ns = cpu_ns;
+    last_wall = now;
+}
+
+// Lets main() wait until every worker has warmed up, and workers wait until
+// the listener is open
+struct StartupGate
+{
+    std::mutex mutex{};
+    std::condition_variable changed{};
+    size_t warmed{0};
+    bool listening{false};
+};
 
-    // Start listening for incoming TCP connections
-    if (listen(sockfd, 1) < 0)
+// === FUNCTION: Record the accept queue's depth, at most once per interval ===
+// On a listening socket, TCP_INFO reports the accept queue length in
+// tcpi_unacked and the backlog limit in tcpi_sacked. The first worker to
+// accept after the interval has passed takes the sample.
+void sample_accept_queue(const int server_sock)
+{
+    static std::atomic<int64_t> next_sample_ns{0};
+    int64_t now{std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()};
+    int64_t due{next_sample_ns.load(std::memory_order_relaxed)};
+    if (now < due ||
+        !next_sample_ns.compare_exchange_strong(due, now + std::chrono::nanoseconds(FLIGHT_QUEUE_SAMPLE_INTERVAL).count(),
+                                                std::memory_order_relaxed))
     {
-        throw std::runtime_error("Listen failed");
+        return;
+    }
+    tcp_info info{};
+    socklen_t length{sizeof(info)};
+    if (getsockopt(server_sock, IPPROTO_TCP, TCP_INFO, &info, &length) == 0)
+    {
+        flight_recorder().record(FlightEvent::QueueDepth, static_cast<uint32_t>(FlightQueue::Accept),
+                                 info.tcpi_unacked, info.tcpi_sacked);
     }
+}
 
-    return sockfd;
+// === FUNCTION: Worker thread body ===
+void worker_loop(const size_t worker, const int server_sock, const CredentialDatabase &credentials, StartupGate &gate)
+{
+    warm_up_thread(credentials);
+    {
+        std::unique_lock<std::mutex> lock{gate.mutex};
+        gate.warmed++;
+        gate.changed.notify_all();
+        gate.changed.wait(lock, [&]
+                          { return gate.listening; });
+    }
+
+    // Serve clients until the process is stopped
+    while (true)
+    {
+        enter_stage(Stage::Accept);
+        IdleStrategy strategy{idle_controller().strategy(worker)};
+        IdleStats &idle_stats{idle_controller().stats(strategy)};
+        sockaddr_in client_addr{};
+        int client_sock{idle_accept(server_sock, client_addr, worker, strategy, idle_stats)};
+
+        if (client_sock < 0)
+        {
+            // Transient failures (e.g. EMFILE, ECONNABORTED) must not stop the server
+            flight_recorder().record(FlightEvent::AcceptFailed, static_cast<uint32_t>(errno));
+            logger().log(LogFormat::AcceptFailed, {}, static_cast<uint64_t>(errno));
+            charge_idle_iteration(idle_stats);
+            continue;
+        }
+
+        // Handle the connected client session; one bad session must not stop the worker
+        flight_recorder().record(FlightEvent::Accept, client_addr.sin_addr.s_addr);
+        sample_accept_queue(server_sock);
+        tracer().begin_session(client_addr.sin_addr.s_addr);
+        hello_arrival = {};
+        try
+        {
+            handle_client(client_sock, client_addr, credentials);
+        }
+        catch (const std::exception &e)
+        {
+            logger().log(LogFormat::ClientError, e.what());
+            close(client_sock);
+            tracer().event(TraceEventType::Error);
+            tracer().end_session(TraceOutcome::Error);
+            flight_recorder().record(FlightEvent::SessionError, client_addr.sin_addr.s_addr);
+        }
+
+        if (hello_arrival != std::chrono::steady_clock::time_point{})
+        {
+            idle_stats.latency_ns.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                                   std::chrono::steady_clock::now() - hello_arrival)
+                                                                   .count()));
+        }
+        charge_idle_iteration(idle_stats);
+    }
 }
 
-// === FUNCTION: Read data from socket ===
-std::string read_message(const int sock)
+// === SAMPLING PROFILER ===
+// On request, ITIMER_PROF delivers SIGPROF PROFILE_SAMPLE_HZ times per second
+// of process CPU time to whichever thread is running. The handler copies that
+// thread's stack (backtrace()) and handshake stage into a preallocated buffer;
+// nothing is named or aggregated until sampling has stopped. Results are
+// written as folded stacks ("stage;outer;...;inner count"), the input format of
+// flamegraph.pl and speedscope. Link with -rdynamic so frames in this binary
+// get names instead of addresses.
+class Profiler
 {
-    char buffer[1024]{};                                    // Temporary buffer for incoming message
-    ssize_t bytes_read{read(sock, buffer, sizeof(buffer))}; // POSIX read()
+public:
+    // Samples for the given number of seconds (blocking the caller) and writes
+    // PROFILE_OUTPUT_PATH. Returns a one-line summary for the operator.
+    std::string run(int seconds)
+    {
+        seconds = std::clamp(seconds, 1, PROFILE_MAX_SECONDS);
 
-    // Use explicit if-else for clarity instead of ternary
-    if (bytes_read > 0)
+        // backtrace() loads the unwinder on first use, which is not safe inside
+        // a signal handler; do it here once
+        void *warm_up[1]{};
+        backtrace(warm_up, 1);
+
+        samples_.assign(PROFILE_MAX_SAMPLES, Sample{});
+        next_.store(0, std::memory_order_relaxed);
+        install_handler();
+        enabled_.store(true, std::memory_order_release);
+
+        itimerval timer{};
+        timer.it_interval.tv_usec = 1000000 / PROFILE_SAMPLE_HZ;
+        timer.it_value = timer.it_interval;
+        setitimer(ITIMER_PROF, &timer, nullptr);
+
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+
+        // Stop the clock, then wait out handlers that are still writing
+        timer = {};
+        setitimer(ITIMER_PROF, &timer, nullptr);
+        enabled_.store(false, std::memory_order_release);
+        while (in_handler_.load(std::memory_order_acquire) != 0)
+        {
+            std::this_thread::yield();
+        }
+
+        size_t taken{next_.load(std::memory_order_relaxed)};
+        size_t kept{std::min(taken, PROFILE_MAX_SAMPLES)};
+        size_t stacks{write_folded(kept)};
+        samples_.clear();
+        samples_.shrink_to_fit();
+
+        return "profiled " + std::to_string(seconds) + "s: " + std::to_string(kept) + " samples (" +
+               std::to_string(taken - kept) + " dropped), " + std::to_string(stacks) + " stacks written to " +
+               PROFILE_OUTPUT_PATH;
+    }
+
+private:
+    struct Sample
     {
-        return std::string(buffer, bytes_read);
+        Stage stage{Stage::Background};
+        uint8_t depth{0};
+        void *frames[PROFILE_MAX_DEPTH]{};
+    };
+
+    // Frames belonging to the profiler itself: on_sigprof() and the kernel's
+    // signal return trampoline
+    static constexpr int HANDLER_FRAMES{2};
+
+    void install_handler()
+    {
+        struct sigaction action{};
+        action.sa_handler = on_sigprof;
+        action.sa_flags = SA_RESTART; // Workers' blocking reads and accepts must not see EINTR
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGPROF, &action, nullptr);
     }
-    else
+
+    static void on_sigprof(int);
+
+    // Async-signal-safe: atomics, TLS reads and an already-loaded unwinder only
+    void record()
     {
-        return std::string();
+        in_handler_.fetch_add(1, std::memory_order_acq_rel);
+        if (enabled_.load(std::memory_order_acquire))
+        {
+            size_t slot{next_.fetch_add(1, std::memory_order_relaxed)};
+            if (slot < PROFILE_MAX_SAMPLES)
+            {
+                Sample &sample{samples_[slot]};
+                sample.stage = current_stage;
+                sample.depth = static_cast<uint8_t>(backtrace(sample.frames, PROFILE_MAX_DEPTH));
+            }
+        }
+        in_handler_.fetch_sub(1, std::memory_order_acq_rel);
     }
-}
 
-// === FUNCTION: Send message to socket ===
-void send_message(const int sock, const std::string &msg)
+    // Name for one return address: demangled symbol if exported, else module+offset
+    static std::string frame_name(void *address)
+    {
+        Dl_info info{};
+        if (dladdr(address, &info) == 0)
+        {
+            return "[unknown]";
+        }
+        if (info.dli_sname != nullptr)
+        {
+            int status{0};
+            char *demangled{abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status)};
+            std::string name{status == 0 ? demangled : info.dli_sname};
+            std::free(demangled);
+            return name;
+        }
+        const char *module{info.dli_fname != nullptr ? info.dli_fname : "?"};
+        char name[256]{};
+        std::snprintf(name, sizeof(name), "%s+0x%lx", module,
+                      static_cast<unsigned long>(static_cast<char *>(address) - static_cast<char *>(info.dli_fbase)));
+        return name;
+    }
+
+    // Folds identical (stage, stack) pairs and writes them root-first
+    size_t write_folded(size_t count)
+    {
+        std::unordered_map<void *, std::string> names{};
+        std::map<std::string, uint64_t> folded{};
+        for (size_t i{0}; i < count; ++i)
+        {
+            const Sample &sample{samples_[i]};
+            std::string line{STAGE_NAMES[static_cast<size_t>(sample.stage)]};
+            for (int f{sample.depth - 1}; f >= HANDLER_FRAMES; --f)
+            {
+                auto [it, inserted]{names.try_emplace(sample.frames[f])};
+                if (inserted)
+                {
+                    it->second = frame_name(sample.frames[f]);
+                }
+                line += ';';
+                line += it->second;
+            }
+            folded[line]++;
+        }
+
+        std::ofstream out{PROFILE_OUTPUT_PATH, std::ios::trunc};
+        if (!out)
+        {
+            throw std::runtime_error("Cannot write " + PROFILE_OUTPUT_PATH);
+        }
+        for (const auto &[stack, samples] : folded)
+        {
+            out << stack << ' ' << samples << '\n';
+        }
+        return folded.size();
+    }
+
+    std::vector<Sample> samples_{};
+    std::atomic<size_t> next_{0};
+    std::atomic<bool> enabled_{false};
+    std::atomic<int> in_handler_{0};
+};
+
+// === FUNCTION: Access the process-wide profiler ===
+Profiler &profiler()
 {
-    // Write the entire message over the TCP connection
-    send(sock, msg.c_str(), msg.length(), 0);
+    static Profiler instance{};
+    return instance;
 }
 
-// === FUNCTION: Handle One Client Session ===
-void handle_client(const int client_sock)
+void Profiler::on_sigprof(int)
 {
-    // Step 1: Expect "hello" from client
-    std::string hello{read_message(client_sock)};
-    std::cout << "Client: " << hello << "\n";
+    int saved_errno{errno};
+    profiler().record();
+    errno = saved_errno;
+}
 
-    // Step 2: Generate a random challenge and send it to the client
-    std::string challenge{generate_challenge()};
-    send_message(client_sock, challenge);
+// === CONTROL CHANNEL ===
+// Operators connect to 127.0.0.1:CONTROL_PORT (the server port + 1) and send
+// one command per connection; the reply is a line of text. Commands:
+//   profile [seconds]   sample all threads and write folded stacks
+//   counters [on|off|reset]
+//                       per-stage wall time and hardware counter averages
+//   trace [reset]       export kept session traces as Chrome trace JSON
+//   stats [reset]       histograms (kernel-to-read queueing delay, TCP_INFO)
+//                       and sessions dropped past their deadline
+//   locks [on|off|reset]
+//                       most contended locks by call site
+//   idle [reset | park|spin|adaptive [worker]]
+//                       worker idle strategies; CPU use and p99 per strategy
+//   dump                write the flight recorder (same as SIGUSR2)
 
-    // Step 3: Receive client’s HMAC digest
-    std::string client_digest{read_message(client_sock)};
+// === FUNCTION: Open the loopback control listener ===
+int create_control_socket(const int port)
+{
+    int sockfd{socket(AF_INET, SOCK_STREAM, 0)};
+    if (sockfd < 0)
+    {
+        throw std::runtime_error("Control socket creation failed");
+    }
 
-    // Step 4: Compute our own digest using the same challenge + secret
-    std::string expected_digest{compute_hmac(challenge, SHARED_SECRET)};
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never reachable from other hosts
+    address.sin_port = htons(port);
 
-    // Step 5: Compare the two HMAC results
-    std::string response{};
-    if (client_digest == expected_digest)
+    int reuse{1};
+    setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    if (bind(sockfd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0)
     {
-        response = "Authentication successful. Welcome!";
+        throw std::runtime_error("Control bind failed");
     }
-    else
+    if (listen(sockfd, 4) < 0)
     {
-        response = "Authentication failed.";
+        throw std::runtime_error("Control listen failed");
     }
+    return sockfd;
+}
 
-    // Step 6: Send result back to client
-    send_message(client_sock, response);
+// === FUNCTION: Run one control command ===
+std::string run_control_command(const std::string &raw_line)
+{
+    // "echo ... | nc" sends a trailing newline (and telnet a CR); drop it, and
+    // any other trailing whitespace, before splitting into command and argument
+    std::string line{raw_line.substr(0, raw_line.find_last_not_of(" \t\r\n") + 1)};
+    std::string command{line.substr(0, line.find(' '))};
+    std::string argument{};
+    if (size_t space{line.find(' ')}; space != std::string::npos)
+    {
+        argument = line.substr(line.find_first_not_of(' ', space));
+    }
 
-    // Step 7: Close client connection
-    close(client_sock);
+    if (command == "profile")
+    {
+        int seconds{argument.empty() ? PROFILE_DEFAULT_SECONDS : std::atoi(argument.c_str())};
+        return profiler().run(seconds);
+    }
+    if (command == "counters")
+    {
+        if (argument == "on" || argument == "off")
+        {
+            stage_meter().set_hw_enabled(argument == "on");
+        }
+        else if (argument == "reset")
+        {
+            stage_meter().reset();
+        }
+        return stage_meter().report();
+    }
+    if (command == "trace")
+    {
+        if (argument == "reset")
+        {
+            tracer().reset();
+            return "trace buffers cleared";
+        }
+        return tracer().export_chrome();
+    }
+    if (command == "stats")
+    {
+        if (argument == "reset")
+        {
+            queueing_delay().reset();
+            tcp_info_histograms().reset();
+            for (auto &drops : deadline_drops)
+            {
+                drops.store(0, std::memory_order_relaxed);
+            }
+            ed25519_batcher().reset();
+            overload_controller().reset();
+        }
+        return queueing_delay().report("queueing_us", 1000) + "\n" + tcp_info_histograms().report() + "\n" +
+               deadline_report() + "\n" + overload_controller().report() + "\n" + ed25519_batcher().report();
+    }
+    if (command == "locks")
+    {
+        if (argument == "on" || argument == "off")
+        {
+            lock_profiler().set_enabled(argument == "on");
+        }
+        else if (argument == "reset")
+        {
+            lock_profiler().reset();
+        }
+        return lock_profiler().report();
+    }
+    if (command == "idle")
+    {
+        // "idle", "idle reset", or "idle <strategy> [worker]"
+        std::string name{argument.substr(0, argument.find(' '))};
+        auto chosen{std::find_if(std::begin(IDLE_STRATEGY_NAMES), std::end(IDLE_STRATEGY_NAMES),
+                                 [&](const char *strategy)
+                                 { return name == strategy; })};
+        if (name == "reset")
+        {
+            idle_controller().reset();
+        }
+        else if (chosen != std::end(IDLE_STRATEGY_NAMES))
+        {
+            auto strategy{static_cast<IdleStrategy>(chosen - std::begin(IDLE_STRATEGY_NAMES))};
+            size_t space{argument.find(' ')};
+            for (size_t i{0}; i < WORKER_COUNT; ++i)
+            {
+                if (space == std::string::npos || std::to_string(i) == argument.substr(space + 1))
+                {
+                    idle_controller().set_strategy(i, strategy);
+                }
+            }
+        }
+        else if (!name.empty())
+        {
+            return "unknown idle strategy (park, spin, adaptive)";
+        }
+        return idle_controller().report();
+    }
+    if (command == "audit")
+    {
+        // "audit" or "audit <ack mode>"
+        auto chosen{std::find(std::begin(AUDIT_ACK_NAMES), std::end(AUDIT_ACK_NAMES), argument)};
+        if (chosen != std::end(AUDIT_ACK_NAMES))
+        {
+            audit_log().set_ack_mode(static_cast<AuditAck>(chosen - std::begin(AUDIT_ACK_NAMES)));
+        }
+        else if (!argument.empty())
+        {
+            return "unknown audit ack mode (buffered, written, durable)";
+        }
+        return std::string("audit ack: ") + AUDIT_ACK_NAMES[static_cast<size_t>(audit_log().ack_mode())];
+    }
+    if (command == "arena")
+    {
+        return credential_arena_report();
+    }
+    if (command == "dump")
+    {
+        flight_recorder().record(FlightEvent::Dump);
+        flight_recorder().dump(0);
+        return std::string("flight recorder written to ") + FLIGHT_DUMP_PATH;
+    }
+    return "unknown command (try: profile [seconds], counters [on|off|reset], trace [reset], stats [reset], locks [on|off|reset], idle [reset|<strategy> [worker]], audit [buffered|written|durable], arena, dump)";
+}
+
+// === FUNCTION: Control thread body ===
+// Serves one operator at a time; a long command (e.g. profiling) simply
+// delays the next one.
+void control_loop(const int control_sock)
+{
+    flight_recorder().register_thread("control");
+    while (true)
+    {
+        int sock{accept(control_sock, nullptr, nullptr)};
+        if (sock < 0)
+        {
+            continue;
+        }
+        try
+        {
+            send_message(sock, run_control_command(read_message(sock)) + "\n");
+        }
+        catch (const std::exception &e)
+        {
+            send_message(sock, std::string("error: ") + e.what() + "\n");
+        }
+        close(sock);
+    }
 }
 
 // === MAIN ===
-int main()
+// Usage: ./server2 [port]
+// Replicas on one host need their own port and working directory (audit log,
+// credentials and dump files are relative paths).
+int main(int argc, char *argv[])
 {
     try
     {
-        // Create server socket and begin listening
-        int server_sock = create_server_socket();
-        std::cout << "Server listening on port " << PORT << "...\n";
+        auto start{std::chrono::steady_clock::now()};
+        int port{argc > 1 ? std::stoi(argv[1]) : PORT};
+        int control_port{port + (CONTROL_PORT - PORT)};
+        install_flight_recorder();
+        flight_recorder().record(FlightEvent::Start);
 
-        // Wait for a single client connection
-        sockaddr_in client_addr{};
-        socklen_t addr_len{sizeof(client_addr)};
-        int client_sock = accept(server_sock, reinterpret_cast<sockaddr *>(&client_addr), &addr_len);
+        // Provision per-user HMAC states before accepting anyone
+        const CredentialDatabase credentials{load_credentials()};
+        logger().log(LogFormat::CredentialTable,
+                     std::string(huge_page_arena::BACKING_NAMES[static_cast<size_t>(credential_arena().backing())]) + ", ",
+                     credential_arena().huge_page_coverage_percent());
 
-        if (client_sock < 0)
+        // Open the audit log up front so a bad path fails at startup
+        audit_log();
+
+        // Bind the port, but don't accept connections until the workers are warm
+        int server_sock = create_server_socket(port);
+
+        StartupGate gate{};
+        std::vector<std::thread> workers{};
+        for (size_t i{0}; i < WORKER_COUNT; ++i)
+        {
+            workers.emplace_back(worker_loop, i, server_sock, std::cref(credentials), std::ref(gate));
+        }
+        {
+            std::unique_lock<std::mutex> lock{gate.mutex};
+            gate.changed.wait(lock, [&]
+                              { return gate.warmed == WORKER_COUNT; });
+        }
+
+        // Pin everything touched so far (and later) in RAM if requested
+        if (LOCK_MEMORY && mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+        {
+            logger().log(LogFormat::MlockFailed, {}, static_cast<uint64_t>(errno));
+        }
+
+        // Open the listener and release the workers
+        start_listening(server_sock);
         {
-            throw std::runtime_error("Accept failed");
+            std::lock_guard<std::mutex> lock{gate.mutex};
+            gate.listening = true;
         }
+        gate.changed.notify_all();
+
+        // Operator commands on loopback only
+        int control_sock{create_control_socket(control_port)};
+        std::thread control{control_loop, control_sock};
+        control.detach();
+        logger().log(LogFormat::ControlListening, {}, static_cast<uint64_t>(control_port));
 
-        // Handle the connected client session
-        handle_client(client_sock);
+        auto ready_us{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count()};
+        flight_recorder().record(FlightEvent::Listening, static_cast<uint32_t>(port));
+        logger().log(LogFormat::ServerListening, {}, static_cast<uint64_t>(port));
+        logger().log(LogFormat::ServerReady, {}, static_cast<uint64_t>(ready_us));
 
-        // Close the server socket after handling the client
-        close(server_sock);
+        // Workers run until the process is stopped
+        for (std::thread &worker : workers)
+        {
+            worker.join();
+        }
     }
     catch (const std::exception &e)
     {
@@ -0,0 +1,469 @@
+#include <iostream>       // For std::cout, std::cerr
+#include <iomanip>        // For std::setw, std::fixed, std::setprecision
+#include <string>         // For std::string
+#include <vector>         // For std::vector
+#include <map>            // For per-syscall counts
+#include <set>            // For the traced threads
+#include <thread>         // For the client thread
+#include <atomic>         // For the measurement phase shared with the client thread
+#include <chrono>         // For connect retries
+#include <memory>         // For std::unique_ptr (OpenSSL object ownership)
+#include <stdexcept>      // For std::runtime_error
+#include <cerrno>         // For errno
+#include <climits>        // For PATH_MAX
+#include <cstdio>         // For fopen() – the server log
+#include <cstdlib>        // For mkdtemp(), realpath()
+#include <csignal>        // For SIGSTOP, SIGTRAP, kill()
+#include <sys/ptrace.h>   // For ptrace() – counting the server's syscalls
+#include <sys/user.h>     // For user_regs_struct (orig_rax = syscall number)
+#include <sys/wait.h>     // For waitpid(), __WALL
+#include <sys/syscall.h>  // For SYS_* numbers
+#include <sys/socket.h>   // For socket(), connect()
+#include <netinet/in.h>   // For sockaddr_in
+#include <arpa/inet.h>    // For inet_pton()
+#include <unistd.h>       // For fork(), execv(), chdir(), pipe(), read(), write(), close()
+#include <openssl/evp.h>  // For EVP_Q_mac() – the client's HMAC proof
+
+// Syscall-budget regression harness for server2's handshake.
+//
+// Starts server2 under ptrace (following every thread it creates), drives N
+// handshakes against it over loopback with the same flow as "./client2"
+// (hello, challenge, HMAC-SHA1 proof, verdict), one at a time, and counts
+// every syscall the server makes meanwhile, on every thread: worker I/O, idle
+// polling, lock hand-offs, the logger and the audit writer, EINTR restarts.
+// Counts are divided by N and checked against SYSCALL_BUDGET below; the exit
+// status is 1 if any syscall, or the total, is over budget.
+//
+// Build: g++ -std=c++17 -O2 syscall_harness.cpp -o syscall_harness -lcrypto -pthread
+// Usage: ./syscall_harness [--server ./server2] [--handshakes 200] [--port 23456] [--idle park]
+//
+// server2 runs in a fresh temporary directory, so it starts from a clean
+// audit log and credential files; its output goes to server2.log there.
+// Workers are switched to the --idle strategy over the control port before
+// measuring: "park" (the default) gives repeatable counts, while "adaptive"
+// and "spin" add a timing-dependent number of empty accept() and
+// sched_yield() calls. x86-64 Linux only (reads orig_rax).
+
+// Allowed syscalls per handshake, averaged over the run. Anything not listed
+// counts against the total only.
+struct SyscallBudget
+{
+    long number;
+    const char *name;
+    double per_handshake;
+};
+
+const SyscallBudget SYSCALL_BUDGET[]{
+    {SYS_accept, "accept", 3.0},         // the connection, and parked workers that lost the race for it
+    {SYS_accept4, "accept4", 3.0},
+    {SYS_poll, "poll", 3.0},             // parked workers waking on the listener
+    {SYS_recvmsg, "recvmsg", 2.0},       // hello and proof
+    {SYS_sendto, "sendto", 2.0},         // challenge and verdict
+    {SYS_getsockopt, "getsockopt", 1.0}, // TCP_INFO sample, accept queue sample
+    {SYS_setsockopt, "setsockopt", 0.0}, // nothing is set per connection
+    {SYS_close, "close", 1.0},
+    {SYS_futex, "futex", 8.0},           // audit group-commit hand-off, logger and batcher wake-ups
+    {SYS_pwritev, "pwritev", 1.0},       // audit record
+    {SYS_fdatasync, "fdatasync", 1.0},
+    {SYS_write, "write", 0.5},           // async logger flushes
+    {SYS_clock_gettime, "clock_gettime", 1.0}, // worker CPU time for the idle report (no vDSO path)
+};
+constexpr double TOTAL_BUDGET_PER_HANDSHAKE{20.0};
+
+constexpr int DEFAULT_PORT{23456};
+constexpr int DEFAULT_HANDSHAKES{200};
+constexpr int WARM_UP_HANDSHAKES{20};
+// Lets the server finish the previous handshake's audit write and close
+// before the counting window opens, and the last one's before it shuts
+constexpr auto SETTLE_TIME{std::chrono::milliseconds(200)};
+const std::string USERNAME{"admin"};
+const std::string SHARED_SECRET{"pass123"}; // Provisioned on server2's first start, then used by the client
+
+// Where the measurement is; counted only while Measuring
+enum class Phase
+{
+    WarmingUp,
+    Measuring,
+    Done,
+    Failed
+};
+
+// === Function: Name a syscall number ===
+std::string syscall_name(long number)
+{
+    for (const SyscallBudget &budget : SYSCALL_BUDGET)
+    {
+        if (budget.number == number)
+        {
+            return budget.name;
+        }
+    }
+    switch (number)
+    {
+    case SYS_read:
+        return "read";
+    case SYS_recvfrom:
+        return "recvfrom";
+    case SYS_sendmsg:
+        return "sendmsg";
+    case SYS_ppoll:
+        return "ppoll";
+    case SYS_sched_yield:
+        return "sched_yield";
+    case SYS_clock_nanosleep:
+        return "clock_nanosleep";
+    case SYS_nanosleep:
+        return "nanosleep";
+    case SYS_getrandom:
+        return "getrandom";
+    case SYS_mmap:
+        return "mmap";
+    case SYS_munmap:
+        return "munmap";
+    case SYS_madvise:
+        return "madvise";
+    case SYS_rt_sigprocmask:
+        return "rt_sigprocmask";
+    case SYS_openat:
+        return "openat";
+    case SYS_fsync:
+        return "fsync";
+    case SYS_pwrite64:
+        return "pwrite64";
+    default:
+        return "syscall_" + std::to_string(number);
+    }
+}
+
+// === Function: One handshake, as client2 does it in the default (HMAC) mode ===
+bool handshake(const int port)
+{
+    int sock{socket(AF_INET, SOCK_STREAM, 0)};
+    if (sock < 0)
+    {
+        return false;
+    }
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+
+    auto exchange{[&](const std::string &message)
+                  {
+                      if (!message.empty() && send(sock, message.data(), message.length(), MSG_NOSIGNAL) < 0)
+                      {
+                          return std::string{};
+                      }
+                      char buffer[1024];
+                      ssize_t n{read(sock, buffer, sizeof(buffer))};
+                      return n > 0 ? std::string(buffer, static_cast<size_t>(n)) : std::string{};
+                  }};
+
+    bool ok{false};
+    if (connect(sock, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0)
+    {
+        std::string challenge{exchange("hello " + USERNAME)};
+        unsigned char proof[EVP_MAX_MD_SIZE];
+        size_t proof_len{0};
+        if (challenge.length() == 16 &&
+            EVP_Q_mac(nullptr, "HMAC", nullptr, "SHA1", nullptr, SHARED_SECRET.data(), SHARED_SECRET.length(),
+                      reinterpret_cast<const unsigned char *>(challenge.data()), challenge.length(),
+                      proof, sizeof(proof), &proof_len))
+        {
+            std::string verdict{exchange(std::string(reinterpret_cast<char *>(proof), proof_len))};
+            ok = verdict.rfind("Authentication successful", 0) == 0;
+        }
+    }
+    close(sock);
+    return ok;
+}
+
+// === Function: Send one control command to server2 (port + 1); returns the reply ===
+std::string control(const int port, const std::string &command)
+{
+    int sock{socket(AF_INET, SOCK_STREAM, 0)};
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port + 1));
+    inet_pton(AF_INET, "127.0.0.1", &address.sin_addr);
+    std::string reply{};
+    if (sock >= 0 && connect(sock, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0 &&
+        send(sock, command.data(), command.length(), MSG_NOSIGNAL) == static_cast<ssize_t>(command.length()))
+    {
+        char buffer[1024];
+        for (ssize_t n{read(sock, buffer, sizeof(buffer))}; n > 0; n = read(sock, buffer, sizeof(buffer)))
+        {
+            reply.append(buffer, static_cast<size_t>(n));
+        }
+    }
+    if (sock >= 0)
+    {
+        close(sock);
+    }
+    return reply;
+}
+
+// === Function: Client thread: wait for the server, warm up, then measure ===
+void drive_handshakes(const int port, const int handshakes, const std::string &idle, std::atomic<Phase> &phase,
+                      int &failures)
+{
+    auto give_up{std::chrono::steady_clock::now() + std::chrono::seconds(30)};
+    while (!handshake(port))
+    {
+        if (std::chrono::steady_clock::now() > give_up)
+        {
+            phase = Phase::Failed;
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+    if (control(port, "idle " + idle).empty())
+    {
+        phase = Phase::Failed;
+        return;
+    }
+    for (int i{0}; i < WARM_UP_HANDSHAKES; ++i)
+    {
+        handshake(port);
+    }
+
+    std::this_thread::sleep_for(SETTLE_TIME);
+    phase = Phase::Measuring;
+    for (int i{0}; i < handshakes; ++i)
+    {
+        failures += handshake(port) ? 0 : 1;
+    }
+    std::this_thread::sleep_for(SETTLE_TIME);
+    phase = Phase::Done;
+}
+
+// === Function: Start server2 in `directory` as a traced child ===
+// The directory is new, so server2 provisions its credentials from the
+// password it reads on stdin.
+pid_t start_traced_server(const std::string &server, const std::string &directory, const int port)
+{
+    int password_pipe[2]{-1, -1};
+    if (pipe(password_pipe) != 0)
+    {
+        throw std::runtime_error("pipe failed");
+    }
+    pid_t child{fork()};
+    if (child < 0)
+    {
+        throw std::runtime_error("fork failed");
+    }
+    if (child == 0)
+    {
+        std::string port_text{std::to_string(port)};
+        FILE *log{nullptr};
+        if (chdir(directory.c_str()) != 0 || !(log = fopen("server2.log", "w")) ||
+            dup2(fileno(log), STDOUT_FILENO) < 0 || dup2(fileno(log), STDERR_FILENO) < 0 ||
+            dup2(password_pipe[0], STDIN_FILENO) < 0 || ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0)
+        {
+            _exit(127);
+        }
+        close(password_pipe[0]);
+        close(password_pipe[1]);
+        kill(getpid(), SIGSTOP); // Let the parent set options before anything runs
+        execl(server.c_str(), server.c_str(), port_text.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+
+    // A few bytes never fill the pipe, so this doesn't wait for the child
+    std::string password_line{SHARED_SECRET + "\n"};
+    bool sent{write(password_pipe[1], password_line.data(), password_line.length()) ==
+              static_cast<ssize_t>(password_line.length())};
+    close(password_pipe[0]);
+    close(password_pipe[1]);
+    if (!sent)
+    {
+        kill(child, SIGKILL);
+        throw std::runtime_error("Cannot pass the password to " + server);
+    }
+
+    int status{0};
+    if (waitpid(child, &status, 0) != child || !WIFSTOPPED(status) ||
+        ptrace(PTRACE_SETOPTIONS, child, nullptr,
+               PTRACE_O_TRACESYSGOOD | PTRACE_O_TRACECLONE | PTRACE_O_TRACEEXEC | PTRACE_O_EXITKILL) != 0 ||
+        ptrace(PTRACE_SYSCALL, child, nullptr, nullptr) != 0)
+    {
+        kill(child, SIGKILL);
+        throw std::runtime_error("Cannot trace " + server + " (ptrace not permitted?)");
+    }
+    return child;
+}
+
+// === Function: Trace until the client thread is done; returns counts by syscall number ===
+// Each thread alternates between syscall-entry and syscall-exit stops; only
+// entries are counted, so a syscall restarted after EINTR counts twice, as it costs.
+std::map<long, uint64_t> trace_server(const pid_t server, std::atomic<Phase> &phase)
+{
+    std::map<long, uint64_t> counts{};
+    std::set<pid_t> in_syscall{};
+    while (true)
+    {
+        Phase now{phase.load()};
+        if (now == Phase::Done || now == Phase::Failed)
+        {
+            break;
+        }
+        int status{0};
+        pid_t tid{waitpid(-1, &status, __WALL)};
+        if (tid < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            phase = Phase::Failed; // The server is gone
+            break;
+        }
+        if (WIFEXITED(status) || WIFSIGNALED(status))
+        {
+            in_syscall.erase(tid);
+            if (tid == server)
+            {
+                phase = Phase::Failed;
+                break;
+            }
+            continue;
+        }
+        if (!WIFSTOPPED(status))
+        {
+            continue;
+        }
+
+        int signal{WSTOPSIG(status)};
+        int deliver{0};
+        if (signal == (SIGTRAP | 0x80))
+        {
+            if (in_syscall.erase(tid) == 0)
+            {
+                in_syscall.insert(tid);
+                user_regs_struct registers{};
+                if (phase.load() == Phase::Measuring && ptrace(PTRACE_GETREGS, tid, nullptr, &registers) == 0)
+                {
+                    counts[static_cast<long>(registers.orig_rax)]++;
+                }
+            }
+        }
+        else if (signal == SIGTRAP && (status >> 16) != 0)
+        {
+            // Clone/exec events; a new thread reports its own SIGSTOP next
+        }
+        else if (signal != SIGSTOP)
+        {
+            deliver = signal; // e.g. the profiler's SIGPROF
+        }
+        ptrace(PTRACE_SYSCALL, tid, nullptr, reinterpret_cast<void *>(static_cast<long>(deliver)));
+    }
+    return counts;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string server{"./server2"};
+    int handshakes{DEFAULT_HANDSHAKES};
+    int port{DEFAULT_PORT};
+    std::string idle{"park"};
+    for (int i{1}; i + 1 < argc; i += 2)
+    {
+        std::string option{argv[i]};
+        if (option == "--server")
+        {
+            server = argv[i + 1];
+        }
+        else if (option == "--handshakes")
+        {
+            handshakes = std::stoi(argv[i + 1]);
+        }
+        else if (option == "--port")
+        {
+            port = std::stoi(argv[i + 1]);
+        }
+        else if (option == "--idle")
+        {
+            idle = argv[i + 1];
+        }
+    }
+    if (argc % 2 == 0 || handshakes <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--server ./server2] [--handshakes N] [--port P] [--idle park|adaptive|spin]\n";
+        return 2;
+    }
+
+    try
+    {
+        char resolved[PATH_MAX];
+        if (!realpath(server.c_str(), resolved))
+        {
+            throw std::runtime_error("Cannot find " + server);
+        }
+        char directory[]{"/tmp/syscall_harness.XXXXXX"};
+        if (!mkdtemp(directory))
+        {
+            throw std::runtime_error("Cannot create a working directory");
+        }
+
+        pid_t child{start_traced_server(resolved, directory, port)};
+        std::atomic<Phase> phase{Phase::WarmingUp};
+        int failures{0};
+        std::thread client{drive_handshakes, port, handshakes, std::cref(idle), std::ref(phase), std::ref(failures)};
+        std::map<long, uint64_t> counts{trace_server(child, phase)};
+        client.join();
+        kill(child, SIGKILL);
+        while (waitpid(-1, nullptr, __WALL) > 0)
+        {
+        }
+        std::cout << "server2 working directory: " << directory << "\n";
+
+        if (phase == Phase::Failed)
+        {
+            throw std::runtime_error("server2 did not serve handshakes (see its working directory)");
+        }
+        if (failures > 0)
+        {
+            throw std::runtime_error(std::to_string(failures) + " of " + std::to_string(handshakes) + " handshakes failed");
+        }
+
+        // Report every syscall seen, then check the budget
+        bool over{false};
+        uint64_t total{0};
+        std::cout << handshakes << " handshakes; syscalls per handshake, all server threads:\n";
+        for (const auto &[number, count] : counts)
+        {
+            total += count;
+            double average{static_cast<double>(count) / handshakes};
+            const SyscallBudget *budget{nullptr};
+            for (const SyscallBudget &entry : SYSCALL_BUDGET)
+            {
+                budget = entry.number == number ? &entry : budget;
+            }
+            bool exceeded{budget != nullptr && average > budget->per_handshake};
+            over = over || exceeded;
+            std::cout << "  " << std::left << std::setw(16) << syscall_name(number) << std::right << std::fixed
+                      << std::setprecision(2) << std::setw(8) << average;
+            if (budget != nullptr)
+            {
+                std::cout << "  budget " << std::setw(5) << budget->per_handshake << (exceeded ? "  OVER" : "");
+            }
+            std::cout << "\n";
+        }
+        double total_average{static_cast<double>(total) / handshakes};
+        bool total_over{total_average > TOTAL_BUDGET_PER_HANDSHAKE};
+        std::cout << "  " << std::left << std::setw(16) << "total" << std::right << std::setw(8) << total_average
+                  << "  budget " << std::setw(5) << TOTAL_BUDGET_PER_HANDSHAKE << (total_over ? "  OVER" : "") << "\n";
+        if (over || total_over)
+        {
+            std::cout << "FAIL: over the syscall budget\n";
+            return 1;
+        }
+        std::cout << "PASS\n";
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Harness error: " << e.what() << "\n";
+        return 2;
+    }
+    return 0;
+}